@@ -28,6 +28,7 @@
 #include "common/Common.h"
 #include "common/Point.h"
 #include "common/RawImage.h"
+#include "common/Trace.h"
 #include "decoders/RawDecoder.h"
 #include "io/Buffer.h"
 #include "io/FileReader.h"
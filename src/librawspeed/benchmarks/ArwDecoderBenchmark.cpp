@@ -0,0 +1,67 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"     // for benchmarkDimensions, ...
+#include "common/Common.h"                 // for uchar8, uint32
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage
+#include "decoders/RawDecoder.h"           // for RawDecoder
+#include "io/Buffer.h"                     // for Buffer
+#include "parsers/RawParser.h"             // for RawParser
+#include "test/encoders/ImageGenerator.h"  // for generateImage
+#include "test/encoders/SonyArw2Encoder.h" // for encodeArw2
+#include "test/encoders/TiffBuilder.h"     // for TiffBuilder
+#include "tiff/TiffTag.h"                  // for TiffTag::MAKE, ...
+#include <benchmark/benchmark.h>           // for State, BENCHMARK
+#include <memory>                          // for unique_ptr
+#include <vector>                          // for vector
+
+using namespace RawSpeed;
+
+// The whole decodeRaw() of a compressed 8 bit ARW2, with the default (linear)
+// curve. state.range(1) is the bits of noise.
+static void BM_ArwDecoder(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const RawImage img = generateImage(dim, 1, 12, state.range(1), benchmarkSeed);
+  const std::vector<uchar8> data = encodeArw2(img);
+
+  TiffBuilder tiff;
+  tiff.addString(MAKE, "SONY");
+  tiff.addString(MODEL, "synthetic");
+  tiff.addLongs(IMAGEWIDTH, {(uint32)dim.x});
+  tiff.addLongs(IMAGELENGTH, {(uint32)dim.y});
+  tiff.addShorts(BITSPERSAMPLE, {8});
+  tiff.addShorts(COMPRESSION, {32767});
+  tiff.addLongs(STRIPBYTECOUNTS, {(uint32)data.size()});
+  tiff.addShorts(SONY_CURVE, {0, 0, 0, 0});
+  const std::vector<uchar8> file = tiff.build(STRIPOFFSETS, data);
+  Buffer input(file.data(), file.size());
+
+  for (auto _ : state) {
+    RawParser parser(&input);
+    std::unique_ptr<RawDecoder> decoder(parser.getDecoder());
+    decoder->decodeRaw();
+  }
+
+  setThroughput(state, data.size(), dim.area());
+}
+
+BENCHMARK(BM_ArwDecoder)
+    ->ArgNames({"MP", "noise"})
+    ->ArgsProduct({benchmarkSizes(), {2, 8}})
+    ->Unit(benchmark::kMillisecond);
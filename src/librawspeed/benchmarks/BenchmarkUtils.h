@@ -0,0 +1,99 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h"       // for uchar8, uint32, uint64
+#include "common/Point.h"        // for iPoint2D
+#include "io/Buffer.h"           // for Buffer
+#include <benchmark/benchmark.h> // for State, Counter, Benchmark
+#include <cmath>                 // for sqrt
+#include <cstdint>               // for int64_t
+#include <memory>                // for unique_ptr
+#include <random>                // for mt19937, uniform_int_distribution
+#include <utility>               // for move
+#include <vector>                // for vector
+
+namespace RawSpeed {
+
+// All the input is generated from a fixed seed, so each run of a benchmark
+// sees exactly the same data.
+static constexpr uint32 benchmarkSeed = 0x52617753;
+
+// The random number generator of the benchmarks, seeded with benchmarkSeed on
+// each call. It is shared, as its state is too large for the stack (~5 KiB).
+inline std::mt19937& benchmarkGenerator() {
+  static std::mt19937 gen;
+  gen.seed(benchmarkSeed);
+  return gen;
+}
+
+// A buffer of uniformly distributed random bytes, i.e. data with maximal
+// entropy. If jpegStuffing is set, each 0xFF is followed by a 0x00 byte, like
+// in the entropy coded segment of a JPEG, so the stream contains no markers.
+inline Buffer randomBuffer(uint32 size, bool jpegStuffing = false) {
+  auto data = Buffer::Create(size);
+  std::mt19937& gen = benchmarkGenerator();
+  std::uniform_int_distribution<int> dist(0, 255);
+
+  uchar8* p = data.get();
+  for (uint32 i = 0; i < size; i++) {
+    p[i] = (uchar8)dist(gen);
+    if (jpegStuffing && p[i] == 0xFF && i + 1 < size)
+      p[++i] = 0x00;
+  }
+
+  return Buffer(std::move(data), size);
+}
+
+// The benchmarks that work on whole images take the size of the image in
+// megapixels as their first argument. This returns an image of about that
+// size with a 3:2 aspect ratio. The width is a multiple of 160, which is a
+// multiple of the pixel group size of all the formats that are benchmarked.
+inline iPoint2D benchmarkDimensions(const benchmark::State& state) {
+  const double pixels = state.range(0) * 1000.0 * 1000.0;
+  int w = (int)(std::sqrt(pixels * 3 / 2) / 160 + 0.5) * 160;
+  if (w < 160)
+    w = 160;
+  int h = (int)(pixels / w);
+  if (h < 2)
+    h = 2;
+  return {w, h & ~1};
+}
+
+// The image sizes in megapixels, from small sensors up to medium format.
+inline std::vector<int64_t> benchmarkSizes() { return {1, 24, 150}; }
+
+// For the benchmarks that only take the image size as argument.
+inline void imageSizes(benchmark::internal::Benchmark* b) {
+  b->ArgName("MP")->Unit(benchmark::kMillisecond);
+  for (int64_t size : benchmarkSizes())
+    b->Arg(size);
+}
+
+// Reports the throughput, given the amount of input bytes and output pixels
+// handled in one iteration. Must be called after the benchmark loop.
+inline void setThroughput(benchmark::State& state, uint64 bytes,
+                          uint64 pixels) {
+  state.SetBytesProcessed((int64_t)(state.iterations() * bytes));
+  if (pixels)
+    state.counters["pixels"] = benchmark::Counter(
+        (double)pixels, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+} // namespace RawSpeed
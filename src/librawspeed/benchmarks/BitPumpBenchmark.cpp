@@ -0,0 +1,70 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h" // for randomBuffer, setThroughput
+#include "common/Common.h"             // for uint32, uint64
+#include "io/BitPumpJPEG.h"            // for BitPumpJPEG
+#include "io/BitPumpMSB.h"             // for BitPumpMSB
+#include "io/BitPumpMSB16.h"           // for BitPumpMSB16
+#include "io/BitPumpMSB32.h"           // for BitPumpMSB32
+#include "io/BitPumpPlain.h"           // for BitPumpPlain
+#include "io/Buffer.h"                 // for Buffer
+#include "io/ByteStream.h"             // for ByteStream
+#include <benchmark/benchmark.h>       // for State, DoNotOptimize, BENCHMARK
+#include <type_traits>                 // for is_same
+
+using namespace RawSpeed;
+
+static constexpr uint32 streamSize = 16 << 20;
+
+// Reads the whole stream, state.range(0) bits at a time
+template <typename Pump> static void BM_BitPump(benchmark::State& state) {
+  const uint32 bits = state.range(0);
+  const bool isJPEG = std::is_same<Pump, BitPumpJPEG>::value;
+  const Buffer input = randomBuffer(streamSize, isJPEG);
+
+  // the 0x00 stuffed after each 0xFF carries no bits
+  uint32 payload = streamSize;
+  for (uint32 i = 1; isJPEG && i < streamSize; i++)
+    payload -= input[i - 1] == 0xFF && input[i] == 0x00 ? 1 : 0;
+  // stay clear of the end, the pumps may read a few bytes ahead
+  const uint64 reads = ((uint64)payload - 8) * 8 / bits;
+
+  for (auto _ : state) {
+    ByteStream bs(input, 0);
+    Pump pump(bs);
+    uint32 sum = 0;
+    for (uint64 i = 0; i < reads; i++)
+      sum += pump.getBits(bits);
+    benchmark::DoNotOptimize(sum);
+  }
+
+  setThroughput(state, reads * bits / 8, 0);
+}
+
+static void bitCounts(benchmark::internal::Benchmark* b) {
+  for (int bits : {1, 8, 12, 14, 16, 24, 32})
+    b->Arg(bits);
+  b->ArgName("bits")->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_BitPump, BitPumpJPEG)->Apply(bitCounts);
+BENCHMARK_TEMPLATE(BM_BitPump, BitPumpMSB)->Apply(bitCounts);
+BENCHMARK_TEMPLATE(BM_BitPump, BitPumpMSB16)->Apply(bitCounts);
+BENCHMARK_TEMPLATE(BM_BitPump, BitPumpMSB32)->Apply(bitCounts);
+BENCHMARK_TEMPLATE(BM_BitPump, BitPumpPlain)->Apply(bitCounts);
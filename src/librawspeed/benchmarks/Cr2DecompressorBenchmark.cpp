@@ -0,0 +1,81 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"     // for benchmarkDimensions, ...
+#include "common/Common.h"                 // for uchar8, uint32
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "decompressors/Cr2Decompressor.h" // for Cr2Decompressor
+#include "io/Buffer.h"                     // for Buffer
+#include "test/encoders/ImageGenerator.h"  // for generateImage
+#include "test/encoders/LJpegEncoder.h"    // for encodeCr2, encodeCr2sRaw
+#include <benchmark/benchmark.h>           // for State, BENCHMARK_TEMPLATE
+#include <vector>                          // for vector
+
+using namespace RawSpeed;
+
+static void decompress(benchmark::State& state, const RawImage& img,
+                       const std::vector<uchar8>& data,
+                       const std::vector<int>& slicesWidths) {
+  const Buffer input(data.data(), data.size());
+  RawImage mRaw = RawImage::create(img->dim, TYPE_USHORT16, img->getCpp());
+  mRaw->isCFA = img->isCFA;
+
+  for (auto _ : state) {
+    Cr2Decompressor d(input, 0, mRaw);
+    d.decode(slicesWidths);
+  }
+
+  setThroughput(state, data.size(), img->dim.area());
+}
+
+// A 14 bit raw with nComp components, in 3 slices like the Canon cameras
+// write them. state.range(1) is the bits of noise.
+template <uint32 nComp>
+static void BM_Cr2Decompressor(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const RawImage img = generateImage(dim, 1, 14, state.range(1), benchmarkSeed);
+  const std::vector<int> slicesWidths = {dim.x * 3 / 8, dim.x * 3 / 8,
+                                         dim.x / 4};
+
+  decompress(state, img, encodeCr2(img, 14, nComp, slicesWidths),
+             slicesWidths);
+}
+
+// sRaw2 (superV == 1) and sRaw1/mRaw (superV == 2) images, in one slice
+template <uint32 superV> static void BM_Cr2sRaw(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  RawImage img = generateImage(dim, 3, 15, state.range(1), benchmarkSeed);
+  img->isCFA = false;
+  // the decompressor scales the slice widths of sRaw2 by 3/2
+  const std::vector<int> slicesWidths = {superV == 1 ? dim.x * 2 : dim.x * 3};
+
+  decompress(state, img, encodeCr2sRaw(img, 15, superV, slicesWidths),
+             slicesWidths);
+}
+
+static void arguments(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"MP", "noise"})
+      ->ArgsProduct({benchmarkSizes(), {2, 8}})
+      ->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_TEMPLATE(BM_Cr2Decompressor, 2)->Apply(arguments);
+BENCHMARK_TEMPLATE(BM_Cr2Decompressor, 4)->Apply(arguments);
+BENCHMARK_TEMPLATE(BM_Cr2sRaw, 1)->Apply(arguments);
+BENCHMARK_TEMPLATE(BM_Cr2sRaw, 2)->Apply(arguments);
@@ -0,0 +1,148 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"      // for benchmarkGenerator, set...
+#include "common/Common.h"                  // for uchar8, uint32, uint64
+#include "decompressors/HuffmanTable.h"     // for HuffmanTable
+#include "io/BitPumpMSB.h"                  // for BitPumpMSB
+#include "io/Buffer.h"                      // for Buffer
+#include "io/ByteStream.h"                  // for ByteStream
+#include <benchmark/benchmark.h>            // for State, DoNotOptimize
+#include <cstring>                          // for memcpy
+#include <random>                           // for mt19937, uniform_int_d...
+#include <utility>                          // for move
+#include <vector>                           // for vector
+
+using namespace RawSpeed;
+
+namespace {
+
+// The tables, in DHT layout: the number of codes of each length 1..16, and
+// the code values (the diff lengths).
+struct TableSpec {
+  uchar8 nCodesPerLength[16];
+  std::vector<uchar8> codeValues;
+};
+
+const TableSpec tables[] = {
+    // the example DC luminance table of the JPEG spec, all codes are short
+    {{0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0},
+     {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}},
+    // codes of all lengths up to 16 bits, half of them do not fit into the
+    // lookup table and are decoded bit by bit
+    {{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2},
+     {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 15}},
+};
+
+constexpr uint32 symbolCount = 4 << 20;
+
+HuffmanTable createTable(const TableSpec& spec, bool fullDecode) {
+  HuffmanTable ht;
+  ht.setNCodesPerLength(Buffer(spec.nCodesPerLength, 16));
+  ht.setCodeValues(
+      Buffer(spec.codeValues.data(), (uint32)spec.codeValues.size()));
+  ht.setup(fullDecode, false);
+  return ht;
+}
+
+// Encodes symbolCount uniformly distributed symbols of the table, each
+// followed by its diff bits if withDiffs is set.
+Buffer encode(const TableSpec& spec, bool withDiffs) {
+  // Figure C.2 of the JPEG spec: generate the codes
+  std::vector<uint32> codes;
+  std::vector<uint32> lengths;
+  uint32 code = 0;
+  for (uint32 l = 1; l <= 16; l++) {
+    for (uint32 i = 0; i < spec.nCodesPerLength[l - 1]; i++) {
+      codes.push_back(code++);
+      lengths.push_back(l);
+    }
+    code <<= 1;
+  }
+
+  std::mt19937& gen = benchmarkGenerator();
+  std::uniform_int_distribution<uint32> symbolDist(0, codes.size() - 1);
+
+  std::vector<uchar8> out;
+  uint64 cache = 0;
+  uint32 fill = 0;
+  auto put = [&](uint32 value, uint32 nbits) {
+    cache = cache << nbits | (value & ((1ULL << nbits) - 1));
+    fill += nbits;
+    while (fill >= 8) {
+      fill -= 8;
+      out.push_back((uchar8)(cache >> fill));
+    }
+  };
+
+  for (uint32 i = 0; i < symbolCount; i++) {
+    const uint32 s = symbolDist(gen);
+    put(codes[s], lengths[s]);
+    const uint32 diffLen = spec.codeValues[s];
+    if (withDiffs && diffLen > 0 && diffLen < 16)
+      put(gen(), diffLen);
+  }
+  // flush, and leave some room for the bit pump to read ahead
+  put(0, 7);
+  out.resize(out.size() + 8);
+
+  auto data = Buffer::Create(out.size());
+  memcpy(data.get(), out.data(), out.size());
+  return Buffer(std::move(data), out.size());
+}
+
+template <bool FullDecode>
+void BM_HuffmanTable(benchmark::State& state) {
+  const TableSpec& spec = tables[state.range(0)];
+  const HuffmanTable ht = createTable(spec, FullDecode);
+  const Buffer input = encode(spec, FullDecode);
+
+  for (auto _ : state) {
+    ByteStream bs(input, 0);
+    BitPumpMSB pump(bs);
+    int sum = 0;
+    for (uint32 i = 0; i < symbolCount; i++)
+      sum += FullDecode ? ht.decodeNext(pump) : ht.decodeLength(pump);
+    benchmark::DoNotOptimize(sum);
+  }
+
+  setThroughput(state, input.getSize(), 0);
+  state.counters["symbols"] = benchmark::Counter(
+      symbolCount, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_HuffmanTable_decodeNext(benchmark::State& state) {
+  BM_HuffmanTable<true>(state);
+}
+
+void BM_HuffmanTable_decodeLength(benchmark::State& state) {
+  BM_HuffmanTable<false>(state);
+}
+
+} // namespace
+
+BENCHMARK(BM_HuffmanTable_decodeNext)
+    ->ArgName("longCodes")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_HuffmanTable_decodeLength)
+    ->ArgName("longCodes")
+    ->Arg(0)
+    ->Arg(1)
+    ->Unit(benchmark::kMillisecond);
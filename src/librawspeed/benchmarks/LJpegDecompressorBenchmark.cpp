@@ -0,0 +1,52 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"       // for benchmarkDimensions, ...
+#include "common/Common.h"                   // for uchar8
+#include "common/Point.h"                    // for iPoint2D
+#include "common/RawImage.h"                 // for RawImage
+#include "decompressors/LJpegDecompressor.h" // for LJpegDecompressor
+#include "io/Buffer.h"                       // for Buffer
+#include "test/encoders/ImageGenerator.h"    // for generateImage
+#include "test/encoders/LJpegEncoder.h"      // for encodeLJpeg
+#include <benchmark/benchmark.h>             // for State, BENCHMARK
+#include <vector>                            // for vector
+
+using namespace RawSpeed;
+
+// A 14 bit image with 2 components, like in DNGs. state.range(1) is the bits
+// of noise, i.e. the length of the typical difference.
+static void BM_LJpegDecompressor(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const RawImage img = generateImage(dim, 1, 14, state.range(1), benchmarkSeed);
+  const std::vector<uchar8> data = encodeLJpeg(img, 14, 2);
+  const Buffer input(data.data(), data.size());
+  RawImage mRaw = RawImage::create(dim);
+
+  for (auto _ : state) {
+    LJpegDecompressor d(input, 0, mRaw);
+    d.decode(0, 0, false);
+  }
+
+  setThroughput(state, data.size(), dim.area());
+}
+
+BENCHMARK(BM_LJpegDecompressor)
+    ->ArgNames({"MP", "noise"})
+    ->ArgsProduct({benchmarkSizes(), {2, 8}})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,56 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"       // for benchmarkDimensions, ...
+#include "common/Common.h"                   // for uchar8, uint32
+#include "common/Point.h"                    // for iPoint2D
+#include "common/RawImage.h"                 // for RawImage
+#include "decompressors/NikonDecompressor.h" // for decompressNikon
+#include "io/Buffer.h"                       // for Buffer
+#include "io/ByteStream.h"                   // for ByteStream
+#include "test/encoders/ImageGenerator.h"    // for generateImage
+#include "test/encoders/NikonEncoder.h"      // for encodeNikon
+#include <benchmark/benchmark.h>             // for State, BENCHMARK
+#include <vector>                            // for vector
+
+using namespace RawSpeed;
+
+// state.range(1) is the bit depth, 12 or 14, state.range(2) the bits of noise
+static void BM_decompressNikon(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const uint32 bitsPS = state.range(1);
+  const RawImage img =
+      generateImage(dim, 1, bitsPS, state.range(2), benchmarkSeed);
+  std::vector<uchar8> meta;
+  const std::vector<uchar8> data = encodeNikon(img, bitsPS, &meta);
+  const Buffer input(data.data(), data.size());
+  const Buffer metaData(meta.data(), meta.size());
+  RawImage mRaw = RawImage::create(dim);
+
+  for (auto _ : state) {
+    decompressNikon(mRaw, ByteStream(input, 0), ByteStream(metaData, 0), dim,
+                    bitsPS, false);
+  }
+
+  setThroughput(state, data.size(), dim.area());
+}
+
+BENCHMARK(BM_decompressNikon)
+    ->ArgNames({"MP", "bits", "noise"})
+    ->ArgsProduct({benchmarkSizes(), {12, 14}, {2, 8}})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,66 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#include "benchmarks/BenchmarkUtils.h"    // for benchmarkDimensions, ...
+#include "common/Common.h"                // for uchar8, uint32
+#include "common/Point.h"                 // for iPoint2D
+#include "common/RawImage.h"              // for RawImage
+#include "decoders/RawDecoder.h"          // for RawDecoder
+#include "io/Buffer.h"                    // for Buffer
+#include "parsers/RawParser.h"            // for RawParser
+#include "test/encoders/ImageGenerator.h" // for generateImage
+#include "test/encoders/OlympusEncoder.h" // for encodeOlympus
+#include "test/encoders/TiffBuilder.h"    // for TiffBuilder
+#include "tiff/TiffTag.h"                 // for TiffTag::MAKE, TiffTag...
+#include <benchmark/benchmark.h>          // for State, BENCHMARK
+#include <memory>                         // for unique_ptr
+#include <vector>                         // for vector
+
+using namespace RawSpeed;
+
+// The whole decodeRaw() of a compressed ORF, which is decoded in a single
+// thread. state.range(1) is the bits of noise.
+static void BM_OrfDecoder(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const RawImage img = generateImage(dim, 1, 12, state.range(1), benchmarkSeed);
+  const std::vector<uchar8> data = encodeOlympus(img);
+
+  TiffBuilder tiff(0x4f52);
+  tiff.addString(MAKE, "OLYMPUS IMAGING CORP.");
+  tiff.addString(MODEL, "synthetic");
+  tiff.addLongs(IMAGEWIDTH, {(uint32)dim.x});
+  tiff.addLongs(IMAGELENGTH, {(uint32)dim.y});
+  tiff.addShorts(COMPRESSION, {1});
+  tiff.addLongs(STRIPBYTECOUNTS, {(uint32)data.size()});
+  const std::vector<uchar8> file = tiff.build(STRIPOFFSETS, data);
+  Buffer input(file.data(), file.size());
+
+  for (auto _ : state) {
+    RawParser parser(&input);
+    std::unique_ptr<RawDecoder> decoder(parser.getDecoder());
+    decoder->decodeRaw();
+  }
+
+  setThroughput(state, data.size(), dim.area());
+}
+
+BENCHMARK(BM_OrfDecoder)
+    ->ArgNames({"MP", "noise"})
+    ->ArgsProduct({benchmarkSizes(), {2, 8}})
+    ->Unit(benchmark::kMillisecond);
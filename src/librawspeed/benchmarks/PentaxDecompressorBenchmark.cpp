@@ -0,0 +1,54 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"        // for benchmarkDimensions, ...
+#include "common/Common.h"                    // for uchar8
+#include "common/Point.h"                     // for iPoint2D
+#include "common/RawImage.h"                  // for RawImage
+#include "decompressors/PentaxDecompressor.h" // for decodePentax
+#include "io/Buffer.h"                        // for Buffer
+#include "io/ByteStream.h"                    // for ByteStream
+#include "test/encoders/ImageGenerator.h"     // for generateImage
+#include "test/encoders/PentaxEncoder.h"      // for encodePentax
+#include "tiff/TiffEntry.h"                   // for TiffEntry
+#include "tiff/TiffIFD.h"                     // for TiffIFD
+#include <benchmark/benchmark.h>              // for State, BENCHMARK
+#include <vector>                             // for vector
+
+using namespace RawSpeed;
+
+// The legacy Huffman table, so 12 bit values. state.range(1) is the bits of
+// noise.
+static void BM_decodePentax(benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const RawImage img = generateImage(dim, 1, 12, state.range(1), benchmarkSeed);
+  const std::vector<uchar8> data = encodePentax(img);
+  const Buffer input(data.data(), data.size());
+  RawImage mRaw = RawImage::create(dim);
+  TiffIFD root;
+
+  for (auto _ : state)
+    decodePentax(mRaw, ByteStream(input, 0), &root);
+
+  setThroughput(state, data.size(), dim.area());
+}
+
+BENCHMARK(BM_decodePentax)
+    ->ArgNames({"MP", "noise"})
+    ->ArgsProduct({benchmarkSizes(), {2, 8}})
+    ->Unit(benchmark::kMillisecond);
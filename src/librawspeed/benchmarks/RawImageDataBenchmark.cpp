@@ -0,0 +1,120 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h" // for benchmarkDimensions, benchm...
+#include "common/Common.h"             // for ushort16, uint32
+#include "common/Point.h"              // for iPoint2D
+#include "common/RawImage.h"           // for RawImage, RawImageData
+#include "metadata/BlackArea.h"        // for BlackArea
+#include <benchmark/benchmark.h>       // for State, BENCHMARK, Benchmark
+#include <random>                      // for mt19937, uniform_int_distri...
+#include <vector>                      // for vector
+
+using namespace RawSpeed;
+
+// The post-passes run on the decoded image, which is 2 bytes per pixel
+static constexpr uint32 bytesPerPixel = 2;
+
+// A 14 bit image with a black level of about 512, plus 32 columns of black
+// on the left for calculateBlackAreas().
+static RawImage createImage(const benchmark::State& state) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  RawImage mRaw = RawImage::create(dim);
+
+  std::mt19937& gen = benchmarkGenerator();
+  std::uniform_int_distribution<int> black(480, 544);
+  std::uniform_int_distribution<int> light(480, 16383);
+  for (int y = 0; y < dim.y; y++) {
+    auto* row = (ushort16*)mRaw->getData(0, y);
+    for (int x = 0; x < dim.x; x++)
+      row[x] = x < 32 ? black(gen) : light(gen);
+  }
+
+  mRaw->blackLevel = 512;
+  mRaw->whitePoint = 16383;
+  return mRaw;
+}
+
+static void BM_scaleBlackWhite(benchmark::State& state) {
+  RawImage mRaw = createImage(state);
+
+  for (auto _ : state)
+    mRaw->scaleBlackWhite();
+
+  setThroughput(state, (uint64)mRaw->dim.area() * bytesPerPixel,
+                mRaw->dim.area());
+}
+
+static void BM_calculateBlackAreas(benchmark::State& state) {
+  RawImage mRaw = createImage(state);
+  mRaw->blackAreas.emplace_back(0, 32, true);
+
+  for (auto _ : state)
+    mRaw->calculateBlackAreas();
+
+  // only the black area is read
+  setThroughput(state, (uint64)mRaw->dim.y * 32 * bytesPerPixel,
+                (uint64)mRaw->dim.y * 32);
+}
+
+// state.range(1) selects dithering
+static void BM_sixteenBitLookup(benchmark::State& state) {
+  RawImage mRaw = createImage(state);
+
+  // a gamma-like curve, like the ones the decoders use
+  std::vector<ushort16> curve(65536);
+  for (uint32 i = 0; i < curve.size(); i++)
+    curve[i] = (ushort16)(i * i / 65536 + i / 2);
+  mRaw->setTable(&curve[0], curve.size(), state.range(1));
+
+  for (auto _ : state)
+    mRaw->sixteenBitLookup();
+
+  setThroughput(state, (uint64)mRaw->dim.area() * bytesPerPixel,
+                mRaw->dim.area());
+}
+
+// state.range(1) is the number of bad pixels per million
+static void BM_fixBadPixels(benchmark::State& state) {
+  RawImage mRaw = createImage(state);
+  const iPoint2D dim = mRaw->dim;
+
+  mRaw->createBadPixelMap();
+  std::mt19937& gen = benchmarkGenerator();
+  std::uniform_int_distribution<int> xDist(0, dim.x - 1);
+  std::uniform_int_distribution<int> yDist(0, dim.y - 1);
+  const uint64 badPixels = (uint64)dim.area() * state.range(1) / 1000000;
+  for (uint64 i = 0; i < badPixels; i++)
+    mRaw->markBadPixel(xDist(gen), yDist(gen));
+
+  for (auto _ : state)
+    mRaw->fixBadPixels();
+
+  setThroughput(state, (uint64)dim.area() * bytesPerPixel, dim.area());
+}
+
+BENCHMARK(BM_scaleBlackWhite)->Apply(imageSizes);
+BENCHMARK(BM_calculateBlackAreas)->Apply(imageSizes);
+BENCHMARK(BM_sixteenBitLookup)
+    ->ArgNames({"MP", "dither"})
+    ->ArgsProduct({benchmarkSizes(), {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_fixBadPixels)
+    ->ArgNames({"MP", "perMillion"})
+    ->ArgsProduct({benchmarkSizes(), {10, 1000}})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,105 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "benchmarks/BenchmarkUtils.h"              // for benchmarkDimensions
+#include "common/Common.h"                          // for uint32, uint64
+#include "common/Point.h"                           // for iPoint2D
+#include "common/RawImage.h"                        // for RawImage
+#include "decompressors/UncompressedDecompressor.h" // for Uncompressed...
+#include "io/Buffer.h"                              // for Buffer
+#include <benchmark/benchmark.h>                    // for State, BENCHMARK...
+
+using namespace RawSpeed;
+
+using Unpacker = void (UncompressedDecompressor::*)(uint32 w, uint32 h);
+
+// The input is sized for the largest format (16 bit), plus the alignment gap
+// of decode12BitRawBEInterlaced().
+static Buffer createInput(const iPoint2D& dim) {
+  return randomBuffer((uint32)dim.area() * 2 + 4096);
+}
+
+// bitsPerPixel is the size of a pixel in the input, including any padding
+// or control bytes, it is only used to report the throughput.
+static void BM_Unpacker(benchmark::State& state, Unpacker unpack,
+                        double bitsPerPixel) {
+  const iPoint2D dim = benchmarkDimensions(state);
+  const Buffer input = createInput(dim);
+  RawImage mRaw = RawImage::create(dim);
+
+  for (auto _ : state) {
+    UncompressedDecompressor u(input, 0, mRaw, false);
+    (u.*unpack)(dim.x, dim.y);
+  }
+
+  setThroughput(state, (uint64)(dim.area() * bitsPerPixel / 8), dim.area());
+}
+
+static void BM_readUncompressedRaw(benchmark::State& state, BitOrder order,
+                                   int bitsPerPixel) {
+  iPoint2D dim = benchmarkDimensions(state);
+  const Buffer input = createInput(dim);
+  RawImage mRaw = RawImage::create(dim);
+  const int inputPitch = dim.x * bitsPerPixel / 8;
+
+  for (auto _ : state) {
+    UncompressedDecompressor u(input, 0, mRaw, false);
+    iPoint2D pos(0, 0);
+    u.readUncompressedRaw(dim, pos, inputPitch, bitsPerPixel, order);
+  }
+
+  setThroughput(state, (uint64)inputPitch * dim.y, dim.area());
+}
+
+#define UNPACKER(name, bits)                                                   \
+  BENCHMARK_CAPTURE(BM_Unpacker, name, &UncompressedDecompressor::name, bits) \
+      ->Apply(imageSizes)
+
+UNPACKER(decode8BitRaw, 8);
+UNPACKER(decode12BitRaw, 12);
+UNPACKER(decode12BitRawWithControl, 12.8);
+UNPACKER(decode12BitRawBEWithControl, 12.8);
+UNPACKER(decode12BitRawBE, 12);
+UNPACKER(decode12BitRawBEInterlaced, 12);
+UNPACKER(decode12BitRawBEunpacked, 16);
+UNPACKER(decode12BitRawBEunpackedLeftAligned, 16);
+UNPACKER(decode14BitRawBEunpacked, 16);
+UNPACKER(decode16BitRawUnpacked, 16);
+UNPACKER(decode16BitRawBEunpacked, 16);
+UNPACKER(decode12BitRawUnpacked, 16);
+
+#undef UNPACKER
+
+#define READ_UNCOMPRESSED(order, bits)                                         \
+  BENCHMARK_CAPTURE(BM_readUncompressedRaw, order##_##bits, BitOrder_##order,  \
+                    bits)                                                      \
+      ->Apply(imageSizes)
+
+READ_UNCOMPRESSED(Plain, 10);
+READ_UNCOMPRESSED(Plain, 12);
+READ_UNCOMPRESSED(Plain, 14);
+READ_UNCOMPRESSED(Plain, 16);
+READ_UNCOMPRESSED(Jpeg, 10);
+READ_UNCOMPRESSED(Jpeg, 12);
+READ_UNCOMPRESSED(Jpeg, 14);
+READ_UNCOMPRESSED(Jpeg16, 12);
+READ_UNCOMPRESSED(Jpeg16, 14);
+READ_UNCOMPRESSED(Jpeg32, 12);
+READ_UNCOMPRESSED(Jpeg32, 14);
+
+#undef READ_UNCOMPRESSED
@@ -19,11 +19,143 @@
 */
 
 #include "common/Common.h"
-#include <cstdarg> // for va_end, va_list, va_start
-#include <cstdio>  // for printf, vprintf
+#include "common/Trace.h" // for traceTasks
+#include <algorithm> // for max, min
+#include <cstdarg>   // for va_end, va_list, va_start
+#include <cstdio>    // for printf, vprintf, fopen, fgets, sscanf, FILE
+#include <cstdlib>   // for atoll
+#include <cstring>   // for strcmp
+#include <string>    // for string
+#include <thread>    // for thread
+
+#ifdef __linux__
+#include <sched.h>   // for sched_getaffinity, CPU_COUNT, cpu_set_t
+#endif
+
+using namespace std;
 
 namespace RawSpeed {
 
+#ifdef __linux__
+// Returns the first line of a file, or an empty string if it can't be read.
+static string readFirstLine(const string& path) {
+  string line;
+  FILE* file = fopen(path.c_str(), "r");
+  if (!file)
+    return line;
+
+  char buf[512];
+  if (fgets(buf, sizeof(buf), file))
+    line = buf;
+  fclose(file);
+
+  if (!line.empty() && line.back() == '\n')
+    line.pop_back();
+  return line;
+}
+
+// Returns the number of CPUs the cgroup of this process is allowed to use,
+// rounded up, or 0 if there is no CPU quota.
+static uint32 getCgroupCpuLimit() {
+  auto cpus = [](int64 quota, int64 period) -> uint32 {
+    if (quota <= 0 || period <= 0)
+      return 0;
+    return (uint32)((quota + period - 1) / period);
+  };
+
+  // Find the cgroup of this process: "0::/path" is the cgroup v2 one,
+  // "N:cpu,cpuacct:/path" the v1 one of the cpu controller.
+  string v2Path;
+  string v1Path;
+  FILE* file = fopen("/proc/self/cgroup", "r");
+  if (file) {
+    char buf[512];
+    while (fgets(buf, sizeof(buf), file)) {
+      string line(buf);
+      if (!line.empty() && line.back() == '\n')
+        line.pop_back();
+
+      size_t first = line.find(':');
+      size_t second = line.find(':', first + 1);
+      if (first == string::npos || second == string::npos)
+        continue;
+
+      string path = line.substr(second + 1);
+      if (second == first + 1) {
+        v2Path = path;
+        continue;
+      }
+      for (const string& c :
+           splitString(line.substr(first + 1, second - first - 1), ',')) {
+        if (c == "cpu")
+          v1Path = path;
+      }
+    }
+    fclose(file);
+  }
+
+  // Inside of a container the cgroup of the process usually is the root of
+  // the mounted hierarchy, so also look there.
+  for (const string& dir : {"/sys/fs/cgroup" + v2Path, string("/sys/fs/cgroup")}) {
+    string max = readFirstLine(dir + "/cpu.max");
+    char quota[32];
+    long long period;
+    if (sscanf(max.c_str(), "%31s %lld", quota, &period) == 2)
+      return strcmp(quota, "max") ? cpus(atoll(quota), period) : 0;
+  }
+
+  for (const string& dir :
+       {"/sys/fs/cgroup/cpu,cpuacct" + v1Path, "/sys/fs/cgroup/cpu" + v1Path,
+        string("/sys/fs/cgroup/cpu,cpuacct"), string("/sys/fs/cgroup/cpu")}) {
+    string quota = readFirstLine(dir + "/cpu.cfs_quota_us");
+    string period = readFirstLine(dir + "/cpu.cfs_period_us");
+    if (!quota.empty() && !period.empty())
+      return cpus(atoll(quota.c_str()), atoll(period.c_str()));
+  }
+
+  return 0;
+}
+#endif
+
+static uint32 getDefaultThreadCount() {
+  uint32 cpus = thread::hardware_concurrency();
+
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+    cpus = CPU_COUNT(&set);
+
+  uint32 limit = getCgroupCpuLimit();
+  if (limit > 0 && limit < cpus)
+    cpus = limit;
+#endif
+
+  return cpus > 0 ? cpus : 1;
+}
+
+// The work a thread should at least get, in ns. Starting and joining a
+// thread takes some 10 to 50 us, this keeps that to a few percent.
+static const uint64 minWorkPerThread = 1000000;
+
+WorkSplit splitWork(const char* stage, uint32 items, uint64 itemCost,
+                    uint32 maxThreads) {
+  uint64 threads = itemCost ? (uint64)items * itemCost / minWorkPerThread : 1;
+  threads = max<uint64>(1, min<uint64>({threads, maxThreads, items}));
+
+  WorkSplit split;
+  split.itemsPerThread = (uint32)((items + threads - 1) / threads);
+  // rounding up the grain may leave the last threads without work
+  split.threads = 1;
+  if (split.itemsPerThread > 0)
+    split.threads = (items + split.itemsPerThread - 1) / split.itemsPerThread;
+
+  writeLog(DEBUG_PRIO_EXTRA,
+           "%s: %u items of ~%llu ns, %u threads of %u items\n", stage, items,
+           itemCost, split.threads, split.itemsPerThread);
+  traceTasks(stage, split.threads);
+  return split;
+}
+
 void writeLog(int priority, const char *format, ...)
 {
 #ifndef _DEBUG
@@ -43,3 +175,11 @@ void writeLog(int priority, const char *format, ...)
 }
 
 } // Namespace RawSpeed
+
+#ifndef WIN32
+// Only used if the host does not define its own, see Common.h
+int __attribute__((weak)) rawspeed_get_number_of_processor_cores() {
+  static const int cores = RawSpeed::getDefaultThreadCount();
+  return cores;
+}
+#endif
@@ -30,6 +30,9 @@
 #include <vector>           // for vector
 #include <cassert>          // for assert
 
+// The number of threads RawSpeed uses per image. Hosts may define this
+// themselves, otherwise the default is the number of CPUs this process may
+// run on, limited by the CPU quota of its cgroup (e.g. in containers).
 int rawspeed_get_number_of_processor_cores();
 
 
@@ -104,6 +107,29 @@ inline uint32 getThreadCount()
 #endif
 }
 
+// Same, but threadCount overrides it, unless it is 0.
+inline uint32 getThreadCount(uint32 threadCount)
+{
+#ifndef HAVE_PTHREAD
+  return 1;
+#else
+  return threadCount ? threadCount : getThreadCount();
+#endif
+}
+
+// How a parallel pass over a number of items (usually rows) is split
+struct WorkSplit {
+  uint32 threads;
+  uint32 itemsPerThread; // the last thread may get fewer
+};
+
+// Simple cost model for parallel passes. itemCost is the estimated time to
+// process one item, in ns. Uses at most maxThreads threads, but only as
+// many as get enough work each to be worth starting a thread for.
+// The decision is logged (DEBUG_PRIO_EXTRA) with the name of the stage.
+WorkSplit splitWork(const char* stage, uint32 items, uint64 itemCost,
+                    uint32 maxThreads);
+
 #ifdef _MSC_VER
 // See http://tinyurl.com/hqfuznc
 #if _MSC_VER >= 1900
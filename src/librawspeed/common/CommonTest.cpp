@@ -244,6 +244,32 @@ TEST(GetThreadCountTest, Test) {
   ASSERT_NO_THROW({ ASSERT_GE(getThreadCount(), 1); });
 }
 
+TEST(SplitWorkTest, CheapWorkIsNotSplit) {
+  const WorkSplit split = splitWork("test", 100, 1000, 16);
+  ASSERT_EQ(split.threads, 1);
+  ASSERT_EQ(split.itemsPerThread, 100);
+}
+
+TEST(SplitWorkTest, ExpensiveWorkUsesAllThreads) {
+  const WorkSplit split = splitWork("test", 4000, 100000, 16);
+  ASSERT_EQ(split.threads, 16);
+  ASSERT_EQ(split.itemsPerThread, 250);
+}
+
+TEST(SplitWorkTest, CoversAllItems) {
+  for (uint32 items : {0U, 1U, 7U, 10U, 1000U, 3333U}) {
+    for (uint32 threads : {1U, 3U, 4U, 6U, 64U}) {
+      const WorkSplit split = splitWork("test", items, 10000000, threads);
+      ASSERT_GE(split.threads, 1);
+      ASSERT_LE(split.threads, max(1U, min(items, threads)));
+      ASSERT_GE(split.threads * split.itemsPerThread, items);
+      if (split.threads > 1) {
+        ASSERT_LT((split.threads - 1) * split.itemsPerThread, items);
+      }
+    }
+  }
+}
+
 TEST(MakeUniqueTest, Test) {
   ASSERT_NO_THROW({
     auto s = make_unique<int>(0);
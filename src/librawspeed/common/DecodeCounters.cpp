@@ -0,0 +1,71 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "rawspeedconfig.h"
+#include "common/DecodeCounters.h"
+
+namespace RawSpeed {
+
+constexpr int DecodeCounters::count;
+
+uint64 DecodeCounters::*const DecodeCounters::fields[count] = {
+    &DecodeCounters::huffmanDecodes,     &DecodeCounters::huffmanSlowDecodes,
+    &DecodeCounters::bitStreamFills,     &DecodeCounters::bitStreamTailFills,
+    &DecodeCounters::jpegByteFills,      &DecodeCounters::jpegMarkers,
+};
+
+const char* const DecodeCounters::names[count] = {
+    "huffmanDecodes", "huffmanSlowDecodes", "bitStreamFills",
+    "bitStreamTailFills", "jpegByteFills", "jpegMarkers",
+};
+
+#ifdef WITH_COUNTERS
+
+#if defined(HAVE_THREAD_LOCAL)
+thread_local DecodeCounters threadDecodeCounters;
+static thread_local bool inScope = false;
+#elif defined(HAVE___THREAD)
+__thread DecodeCounters threadDecodeCounters;
+static __thread bool inScope = false;
+#else
+DecodeCounters threadDecodeCounters;
+static bool inScope = false;
+#endif
+
+DecodeCountersScope::DecodeCountersScope(DecodeCounters* target_)
+    : outer(!inScope), start(threadDecodeCounters), target(target_) {
+  inScope = true;
+}
+
+DecodeCountersScope::~DecodeCountersScope() {
+  if (!outer)
+    return;
+  inScope = false;
+  if (!target)
+    return;
+
+  for (auto field : DecodeCounters::fields) {
+    __atomic_fetch_add(&(target->*field),
+                       threadDecodeCounters.*field - start.*field,
+                       __ATOMIC_RELAXED);
+  }
+}
+
+#endif
+
+} // namespace RawSpeed
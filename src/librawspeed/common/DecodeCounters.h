@@ -0,0 +1,91 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "rawspeedconfig.h"
+#include "common/Common.h" // for uint64
+
+namespace RawSpeed {
+
+// How often the slow paths of the entropy decoding were taken while decoding
+// an image, see RawImageData::counters. Only counted if RawSpeed is built
+// with WITH_COUNTERS, otherwise they stay 0.
+struct DecodeCounters {
+  uint64 huffmanDecodes;     // HuffmanTable::decode() calls
+  uint64 huffmanSlowDecodes; // codes longer than HuffmanTable::LookupDepth
+  uint64 bitStreamFills;     // refills of the BitStream cache
+  uint64 bitStreamTailFills; // refills within 4 bytes of the end
+  uint64 jpegByteFills;      // BitPumpJPEG refills that went byte by byte
+  uint64 jpegMarkers;        // BitPumpJPEG refills that hit a marker
+
+  static constexpr int count = 6;
+  static uint64 DecodeCounters::*const fields[count];
+  static const char* const names[count];
+};
+
+#ifdef WITH_COUNTERS
+
+// The counters of the calling thread, never reset
+#if defined(HAVE_THREAD_LOCAL)
+extern thread_local DecodeCounters threadDecodeCounters;
+#elif defined(HAVE___THREAD)
+extern __thread DecodeCounters threadDecodeCounters;
+#else
+#pragma message                                                                \
+    "Don't have thread-local-storage! Decode counters will be mixed up if used multithreaded"
+extern DecodeCounters threadDecodeCounters;
+#endif
+
+inline void countDecode(uint64 DecodeCounters::*counter) {
+  ++(threadDecodeCounters.*counter);
+}
+
+// Adds what the calling thread counts during the lifetime of the outermost
+// scope of the thread to the target, if there is one by then. The target may
+// be shared by several threads.
+class DecodeCountersScope final {
+  bool outer;
+  DecodeCounters start;
+  DecodeCounters* target;
+
+public:
+  explicit DecodeCountersScope(DecodeCounters* target_ = nullptr);
+  ~DecodeCountersScope();
+  DecodeCountersScope(const DecodeCountersScope&) = delete;
+  DecodeCountersScope& operator=(const DecodeCountersScope&) = delete;
+
+  void setTarget(DecodeCounters* target_) { target = target_; }
+};
+
+#else
+
+inline void countDecode(uint64 DecodeCounters::* /*counter*/) {}
+
+class DecodeCountersScope final {
+public:
+  explicit DecodeCountersScope(DecodeCounters* /*target*/ = nullptr) {}
+  DecodeCountersScope(const DecodeCountersScope&) = delete;
+  DecodeCountersScope& operator=(const DecodeCountersScope&) = delete;
+
+  void setTarget(DecodeCounters* /*target*/) {}
+};
+
+#endif
+
+} // namespace RawSpeed
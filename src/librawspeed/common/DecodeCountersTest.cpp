@@ -0,0 +1,79 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "rawspeedconfig.h"
+#include "common/Common.h"                  // for uchar8, uint64
+#include "common/DecodeCounters.h"          // for DecodeCounters, DecodeC...
+#include "decompressors/HuffmanTable.h"     // for HuffmanTable
+#include "io/BitPumpJPEG.h"                 // for BitPumpJPEG
+#include "io/Buffer.h"                      // for Buffer
+#include "io/ByteStream.h"                  // for ByteStream
+#include "test/encoders/BitStreamWriter.h"  // for BitStreamWriter
+#include "test/encoders/HuffmanEncoder.h"   // for HuffmanEncoder
+#include <array>                            // for array
+#include <gtest/gtest.h>                    // for Test, EXPECT_EQ, TEST
+#include <vector>                           // for vector
+
+using namespace std;
+using namespace RawSpeed;
+
+// 100 differences with a 1 bit code and 10 with a 13 bit code, which is
+// longer than the lookup table of HuffmanTable
+TEST(DecodeCountersTest, HuffmanAndJPEG) {
+  const array<uchar8, 16> nCodesPerLength = {
+      {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0}};
+  const vector<uchar8> codeValues = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  const HuffmanEncoder encoder(nCodesPerLength, codeValues);
+
+  BitStreamWriter writer(BitOrder_Jpeg, true);
+  for (int i = 0; i < 110; i++)
+    encoder.encode(&writer, i < 100 ? 0 : 2048);
+  vector<uchar8> data = writer.finish();
+  data.push_back(0xFF);
+  data.push_back(0xD9);
+  const Buffer input(data.data(), data.size());
+
+  HuffmanTable ht;
+  ht.setNCodesPerLength(Buffer(nCodesPerLength.data(), 16));
+  ht.setCodeValues(Buffer(codeValues.data(), codeValues.size()));
+  ht.setup(true, false);
+
+  DecodeCounters counters = DecodeCounters();
+  {
+    DecodeCountersScope scope(&counters);
+    ByteStream bs(input, 0);
+    BitPumpJPEG pump(bs);
+    for (int i = 0; i < 110; i++)
+      EXPECT_EQ(i < 100 ? 0 : 2048, ht.decodeNext(pump));
+    // run into the end of the stream, past the padding of the last byte
+    for (int i = 0; i < 4; i++)
+      pump.getBits(32);
+  }
+
+#ifdef WITH_COUNTERS
+  EXPECT_EQ(110U, counters.huffmanDecodes);
+  EXPECT_EQ(10U, counters.huffmanSlowDecodes);
+  EXPECT_GT(counters.bitStreamFills, 4U);
+  EXPECT_GT(counters.bitStreamTailFills, 0U);
+  EXPECT_GT(counters.jpegMarkers, 0U);
+  EXPECT_GE(counters.jpegByteFills, counters.jpegMarkers);
+#else
+  for (auto field : DecodeCounters::fields)
+    EXPECT_EQ(0U, counters.*field);
+#endif
+}
@@ -19,16 +19,29 @@
     Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
 
+#include "rawspeedconfig.h"
 #include "common/DngOpcodes.h"
 #include "common/Common.h"                // for uint32, ushort16, make_unique
 #include "common/Point.h"                 // for iPoint2D, iRectangle2D
 #include "common/RawImage.h"              // for RawImage, RawImageData
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for RawDecoderException (ptr o...
 #include "io/ByteStream.h"                // for ByteStream
 #include "io/Endianness.h"                // for getHostEndianness, Endiann...
 #include "tiff/TiffEntry.h"               // for TiffEntry
-#include <algorithm>                      // for fill_n
-#include <cmath>                          // for pow
+#include <algorithm>                      // for fill_n, min, max
+#include <cmath>                          // for pow, sqrt
+#include <cstring>                        // for memcpy
+#include <functional>                     // for function
+#include <vector>                         // for vector
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // for __m128, _mm_mul_ps, _mm_packs_epi32
+#endif
 
 using namespace std;
 
@@ -48,6 +61,62 @@ public:
 
 // ****************************************************************************
 
+struct DngOpcodeBand {
+#ifdef HAVE_PTHREAD
+  pthread_t threadid;
+#endif
+  const function<void(uint32, uint32)>* work;
+  uint32 start;
+  uint32 end;
+};
+
+static void* applyOpcodeBand(void* arg) {
+  auto* band = (DngOpcodeBand*)arg;
+  TraceScope trace("DngOpcodes band");
+  (*band->work)(band->start, band->end);
+  return nullptr;
+}
+
+// Splits [0, rows) into contiguous bands and calls work(start, end) for each
+// of them, in parallel on the threads ri may use, as far as that is worth it
+// for rows that take about rowCost ns each. work must not throw.
+static void applyInBands(const RawImage& ri, uint32 rows, uint64 rowCost,
+                         const function<void(uint32, uint32)>& work) {
+  if (rows == 0)
+    return;
+
+#ifndef HAVE_PTHREAD
+  work(0, rows);
+#else
+  const WorkSplit split = splitWork("DngOpcodes", rows, rowCost,
+                                    getThreadCount(ri->threadCount));
+  const uint32 threads = split.threads;
+  const uint32 rowsPerThread = split.itemsPerThread;
+  if (threads == 1) {
+    work(0, rows);
+    return;
+  }
+
+  vector<DngOpcodeBand> bands(threads);
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+  for (uint32 i = 0; i < threads; i++) {
+    bands[i].work = &work;
+    bands[i].start = min(rows, i * rowsPerThread);
+    bands[i].end = min(rows, bands[i].start + rowsPerThread);
+    pthread_create(&bands[i].threadid, &attr, applyOpcodeBand, &bands[i]);
+  }
+  pthread_attr_destroy(&attr);
+
+  for (auto& band : bands)
+    pthread_join(band.threadid, nullptr);
+#endif
+}
+
+// ****************************************************************************
+
 class FixBadPixelsConstant final : public DngOpcode {
   uint32 value;
 
@@ -68,12 +137,11 @@ public:
 
   void apply(RawImage& ri) override {
     iPoint2D crop = ri->getCropOffset();
-    uint32 offset = crop.x | (crop.y << 16);
     for (auto y = 0; y < ri->dim.y; ++y) {
       auto* src = (ushort16*)ri->getData(0, y);
       for (auto x = 0; x < ri->dim.x; ++x) {
         if (src[x] == value)
-          ri->mBadPixelPositions.push_back(offset + (y << 16 | x));
+          ri->mBadPixelPositions.emplace_back(crop.x + x, crop.y + y);
       }
     }
   }
@@ -82,7 +150,7 @@ public:
 // ****************************************************************************
 
 class FixBadPixelsList final : public DngOpcode {
-  std::vector<uint32> badPixels;
+  std::vector<iPoint2D> badPixels;
 
 public:
   FixBadPixelsList(ByteStream& bs) {
@@ -94,7 +162,7 @@ public:
     for (auto i = 0u; i < badPointCount; ++i) {
       auto y = bs.getU32();
       auto x = bs.getU32();
-      badPixels.push_back(y << 16 | x);
+      badPixels.emplace_back(x, y);
     }
 
     // Read rects
@@ -105,7 +173,7 @@ public:
       auto right = bs.getU32();
       for (auto y = top; y <= bottom; ++y) {
         for (auto x = left; x <= right; ++x) {
-          badPixels.push_back(y << 16 | x);
+          badPixels.emplace_back(x, y);
         }
       }
     }
@@ -174,21 +242,52 @@ protected:
       ThrowRDE("Not that many planes in actual image");
   }
 
-  // traverses the current ROI and applies the operation OP to each pixel,
-  // i.e. each pixel value v is replaced by op(x, y, v), where x/y are the
-  // coordinates of the pixel value v.
-  template <typename T, typename OP> void applyOP(RawImage& ri, OP op) {
+  // traverses row y of the current ROI and applies the operation OP to each
+  // pixel, i.e. each pixel value v is replaced by op(x, y, v), where x/y are
+  // the coordinates of the pixel value v.
+  template <typename T, typename OP>
+  void applyOP(const RawImage& ri, uint32 y, OP op) {
     int cpp = ri->getCpp();
-    for (auto y = top; y < bottom; y += rowPitch) {
-      auto* src = (T*)ri->getData(0, y);
-      // Add offset, so this is always first plane
-      src += firstPlane;
-      for (auto x = left; x < right; x += colPitch) {
-        for (auto p = 0u; p < planes; ++p)
-          src[x * cpp + p] = op(x, y, src[x * cpp + p]);
-      }
+    auto* src = (T*)ri->getData(0, y);
+    // Add offset, so this is always first plane
+    src += firstPlane;
+    for (auto x = left; x < right; x += colPitch) {
+      for (auto p = 0u; p < planes; ++p)
+        src[x * cpp + p] = op(x, y, src[x * cpp + p]);
     }
   }
+
+public:
+  // Processes a single row of the ROI. Rows are independent of each other,
+  // so this may be called concurrently for different rows. The scratch
+  // buffer belongs to the calling thread and is reused for all of its rows.
+  virtual void applyRow(const RawImage& ri, uint32 y,
+                        vector<float>& scratch) = 0;
+
+  void apply(RawImage& ri) override {
+    vector<float> scratch;
+    for (auto y = top; y < bottom; y += rowPitch)
+      applyRow(ri, y, scratch);
+  }
+
+  // Number of ROI rows, and the image row of the i-th one
+  uint32 rowCount() const {
+    return bottom > top ? (bottom - top + rowPitch - 1) / rowPitch : 0;
+  }
+  uint32 rowAt(uint32 i) const { return top + i * rowPitch; }
+
+  // Number of pixel values processed per ROI row
+  uint32 valuesPerRow() const {
+    return right > left ? (right - left + colPitch - 1) / colPitch * planes : 0;
+  }
+
+  // Whether both opcodes touch exactly the same pixels
+  bool sameArea(const PixelOpcode& o) const {
+    return top == o.top && left == o.left && bottom == o.bottom &&
+           right == o.right && firstPlane == o.firstPlane &&
+           planes == o.planes && rowPitch == o.rowPitch &&
+           colPitch == o.colPitch;
+  }
 };
 
 // ****************************************************************************
@@ -205,9 +304,18 @@ protected:
       ThrowRDE("Only 16 bit images supported");
   }
 
-  void apply(RawImage& ri) override {
+public:
+  void applyRow(const RawImage& ri, uint32 y,
+                vector<float>& scratch) override {
     applyOP<ushort16>(
-        ri, [this](uint32 x, uint32 y, ushort16 v) { return lookup[v]; });
+        ri, y, [this](uint32 x, uint32 row, ushort16 v) { return lookup[v]; });
+  }
+
+  // Folds a following lookup over the same area into this one, so that
+  // both are done with a single table access.
+  void compose(const LookupOpcode& next) {
+    for (auto& v : lookup)
+      v = next.lookup[v];
   }
 };
 
@@ -288,14 +396,15 @@ template <typename S> class OffsetPerRowOrCol final : public DeltaRowOrColBase {
 public:
   OffsetPerRowOrCol(ByteStream& bs) : DeltaRowOrColBase(bs, 65535.0f) {}
 
-  void apply(RawImage& ri) override {
+  void applyRow(const RawImage& ri, uint32 y,
+                vector<float>& scratch) override {
     if (ri->getDataType() == TYPE_USHORT16) {
-      applyOP<ushort16>(ri, [this](uint32 x, uint32 y, ushort16 v) {
-        return clampBits(deltaI[S::select(x, y)] + v, 16);
+      applyOP<ushort16>(ri, y, [this](uint32 x, uint32 row, ushort16 v) {
+        return clampBits(deltaI[S::select(x, row)] + v, 16);
       });
     } else {
-      applyOP<float>(ri, [this](uint32 x, uint32 y, float v) {
-        return deltaF[S::select(x, y)] + v;
+      applyOP<float>(ri, y, [this](uint32 x, uint32 row, float v) {
+        return deltaF[S::select(x, row)] + v;
       });
     }
   }
@@ -308,14 +417,15 @@ template <typename S> class ScalePerRowOrCol final : public DeltaRowOrColBase {
 public:
   ScalePerRowOrCol(ByteStream& bs) : DeltaRowOrColBase(bs, 1024.0f) {}
 
-  void apply(RawImage& ri) override {
+  void applyRow(const RawImage& ri, uint32 y,
+                vector<float>& scratch) override {
     if (ri->getDataType() == TYPE_USHORT16) {
-      applyOP<ushort16>(ri, [this](uint32 x, uint32 y, ushort16 v) {
-        return clampBits((deltaI[S::select(x, y)] * v + 512) >> 10, 16);
+      applyOP<ushort16>(ri, y, [this](uint32 x, uint32 row, ushort16 v) {
+        return clampBits((deltaI[S::select(x, row)] * v + 512) >> 10, 16);
       });
     } else {
-      applyOP<float>(ri, [this](uint32 x, uint32 y, float v) {
-        return deltaF[S::select(x, y)] * v;
+      applyOP<float>(ri, y, [this](uint32 x, uint32 row, float v) {
+        return deltaF[S::select(x, row)] * v;
       });
     }
   }
@@ -326,6 +436,301 @@ using ScalePerCol = ScalePerRowOrCol<SelectX>;
 
 // ****************************************************************************
 
+class GainMap final : public PixelOpcode {
+  uint32 mapPointsV, mapPointsH;
+  double mapSpacingV, mapSpacingH;
+  double mapOriginV, mapOriginH;
+  uint32 mapPlanes;
+  vector<float> mapGains;
+
+  // For every ROI column: index of the map column left of it, and the weight
+  // of the map column right of it. Prepared in setup().
+  vector<uint32> colIndex;
+  vector<float> colWeight;
+
+  // Position of a pixel (relative to the image size) in map coordinates,
+  // as index of the preceding map point plus interpolation weight.
+  static void mapPosition(double pos, double origin, double spacing,
+                          uint32 points, uint32* index, float* weight) {
+    double f = (pos - origin) / spacing;
+    if (!(f > 0.0)) { // also catches NaN
+      *index = 0;
+      *weight = 0.0f;
+    } else if (f >= points - 1) {
+      *index = points - 1;
+      *weight = 0.0f;
+    } else {
+      *index = (uint32)f;
+      *weight = (float)(f - *index);
+    }
+  }
+
+public:
+  GainMap(ByteStream& bs) : PixelOpcode(bs) {
+    mapPointsV = bs.getU32();
+    mapPointsH = bs.getU32();
+    mapSpacingV = bs.get<double>();
+    mapSpacingH = bs.get<double>();
+    mapOriginV = bs.get<double>();
+    mapOriginH = bs.get<double>();
+    mapPlanes = bs.getU32();
+
+    if (mapPointsV == 0 || mapPointsH == 0 || mapPlanes == 0)
+      ThrowRDE("Empty gain map");
+    if ((mapPointsV > 1 && !(mapSpacingV > 0.0)) ||
+        (mapPointsH > 1 && !(mapSpacingH > 0.0)))
+      ThrowRDE("Invalid gain map spacing");
+
+    // check before allocating anything
+    const uint64 count = (uint64)mapPointsV * mapPointsH * mapPlanes;
+    if (count > bs.getRemainSize() / sizeof(float))
+      ThrowRDE("Gain map is larger than opcode");
+
+    mapGains.resize(count);
+    for (auto& g : mapGains)
+      g = bs.getFloat();
+  }
+
+  void setup(const RawImage& ri) override {
+    PixelOpcode::setup(ri);
+
+    colIndex.clear();
+    colWeight.clear();
+    for (auto x = left; x < right; x += colPitch) {
+      uint32 index;
+      float weight;
+      mapPosition((double)x / ri->dim.x, mapOriginH, mapSpacingH, mapPointsH,
+                  &index, &weight);
+      colIndex.push_back(index);
+      colWeight.push_back(weight);
+    }
+  }
+
+  void applyRow(const RawImage& ri, uint32 y,
+                vector<float>& scratch) override {
+    uint32 r0;
+    float wy;
+    mapPosition((double)y / ri->dim.y, mapOriginV, mapSpacingV, mapPointsV,
+                &r0, &wy);
+    const uint32 r1 = min(r0 + 1, mapPointsV - 1);
+
+    // Gain (and slope towards the next map column) along this row
+    scratch.resize(2 * mapPointsH);
+    float* gain = &scratch[0];
+    float* slope = &scratch[mapPointsH];
+
+    const int cpp = ri->getCpp();
+    for (auto p = 0u; p < planes; ++p) {
+      const uint32 mapPlane = min(p, mapPlanes - 1);
+      for (auto j = 0u; j < mapPointsH; ++j) {
+        const float g0 = mapGains[(r0 * mapPointsH + j) * mapPlanes + mapPlane];
+        const float g1 = mapGains[(r1 * mapPointsH + j) * mapPlanes + mapPlane];
+        gain[j] = g0 + wy * (g1 - g0);
+      }
+      for (auto j = 0u; j + 1 < mapPointsH; ++j)
+        slope[j] = gain[j + 1] - gain[j];
+      slope[mapPointsH - 1] = 0.0f;
+
+      if (ri->getDataType() == TYPE_USHORT16) {
+        auto* src = (ushort16*)ri->getData(left, y) + firstPlane + p;
+        applyGains(src, cpp * colPitch, gain, slope);
+      } else {
+        auto* src = (float*)ri->getData(left, y) + firstPlane + p;
+        for (auto i = 0u; i < colIndex.size(); ++i, src += cpp * colPitch) {
+          const uint32 j = colIndex[i];
+          *src *= gain[j] + colWeight[i] * slope[j];
+        }
+      }
+    }
+  }
+
+private:
+  void applyGains(ushort16* src, uint32 step, const float* gain,
+                  const float* slope) const {
+    const auto n = (uint32)colIndex.size();
+    uint32 i = 0;
+#if defined(__SSE2__)
+    if (step == 1) {
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 half = _mm_set1_ps(0.5f);
+      const __m128 maxValue = _mm_set1_ps(65535.0f);
+      const __m128i sign = _mm_set1_epi16((short)0x8000);
+      const __m128i bias = _mm_set1_epi32(32768);
+      for (; i + 8 <= n; i += 8) {
+        __m128 g[2];
+        for (int k = 0; k < 2; k++) {
+          const uint32* idx = &colIndex[i + 4 * k];
+          // bilinear gain for 4 pixels: g = gain[j] + weight * slope[j]
+          __m128 a = _mm_setr_ps(gain[idx[0]], gain[idx[1]], gain[idx[2]],
+                                 gain[idx[3]]);
+          __m128 s = _mm_setr_ps(slope[idx[0]], slope[idx[1]], slope[idx[2]],
+                                 slope[idx[3]]);
+          __m128 w = _mm_loadu_ps(&colWeight[i + 4 * k]);
+          g[k] = _mm_add_ps(a, _mm_mul_ps(w, s));
+        }
+
+        __m128i pix = _mm_loadu_si128((__m128i*)&src[i]);
+        __m128 lo = _mm_cvtepi32_ps(
+            _mm_unpacklo_epi16(pix, _mm_setzero_si128()));
+        __m128 hi = _mm_cvtepi32_ps(
+            _mm_unpackhi_epi16(pix, _mm_setzero_si128()));
+        lo = _mm_add_ps(_mm_mul_ps(lo, g[0]), half);
+        hi = _mm_add_ps(_mm_mul_ps(hi, g[1]), half);
+        lo = _mm_min_ps(_mm_max_ps(lo, zero), maxValue);
+        hi = _mm_min_ps(_mm_max_ps(hi, zero), maxValue);
+
+        // No unsigned saturating pack in SSE2: go through signed range
+        __m128i lo32 = _mm_sub_epi32(_mm_cvttps_epi32(lo), bias);
+        __m128i hi32 = _mm_sub_epi32(_mm_cvttps_epi32(hi), bias);
+        pix = _mm_xor_si128(_mm_packs_epi32(lo32, hi32), sign);
+        _mm_storeu_si128((__m128i*)&src[i], pix);
+      }
+    }
+#endif
+    for (; i < n; ++i) {
+      const uint32 j = colIndex[i];
+      const float g = gain[j] + colWeight[i] * slope[j];
+      const float v = src[i * step] * g + 0.5f;
+      src[i * step] = (ushort16)min(max(v, 0.0f), 65535.0f);
+    }
+  }
+};
+
+// ****************************************************************************
+
+class WarpRectilinear final : public DngOpcode {
+  struct Coefficients {
+    double kr[4]; // radial
+    double kt[2]; // tangential
+  };
+  vector<Coefficients> coeffs;
+  double centerX, centerY; // relative to the image size
+
+  template <typename T> void warp(RawImage& ri) {
+    const int w = ri->dim.x;
+    const int h = ri->dim.y;
+    const int cpp = ri->getCpp();
+
+    // The warp is not in-place, keep an untouched copy of the input
+    vector<T> input((size_t)w * h * cpp);
+    for (int y = 0; y < h; y++)
+      memcpy(&input[(size_t)y * w * cpp], ri->getData(0, y),
+             sizeof(T) * w * cpp);
+
+    const double cx = centerX * (w - 1);
+    const double cy = centerY * (h - 1);
+    // Normalize so that the farthest image corner has a distance of 1
+    const double mx = max(cx, w - 1 - cx);
+    const double my = max(cy, h - 1 - cy);
+    const double maxDist = sqrt(mx * mx + my * my);
+    if (maxDist == 0.0)
+      return;
+    const double norm = 1.0 / maxDist;
+
+    // bilinear sampling of every pixel, ~20 ns each
+    applyInBands(ri, h, (uint64)w * cpp * 20, [&](uint32 start, uint32 end) {
+      for (auto y = start; y < end; y++) {
+        auto* dst = (T*)ri->getData(0, y);
+        const double dy = (y - cy) * norm;
+        for (int x = 0; x < w; x++) {
+          const double dx = (x - cx) * norm;
+          const double r2 = dx * dx + dy * dy;
+          for (int p = 0; p < cpp; p++) {
+            const Coefficients& k = coeffs[coeffs.size() == 1 ? 0 : p];
+            const double radial =
+                k.kr[0] + r2 * (k.kr[1] + r2 * (k.kr[2] + r2 * k.kr[3]));
+            const double sx = dx * radial + k.kt[0] * 2 * dx * dy +
+                              k.kt[1] * (r2 + 2 * dx * dx);
+            const double sy = dy * radial + k.kt[1] * 2 * dx * dy +
+                              k.kt[0] * (r2 + 2 * dy * dy);
+            dst[x * cpp + p] = sample(input, w, h, cpp, p, cx + sx * maxDist,
+                                      cy + sy * maxDist);
+          }
+        }
+      }
+    });
+  }
+
+  // Bilinear interpolation, clamped at the image borders
+  template <typename T>
+  static T sample(const vector<T>& in, int w, int h, int cpp, int p, double x,
+                  double y) {
+    x = min(max(x, 0.0), (double)(w - 1));
+    y = min(max(y, 0.0), (double)(h - 1));
+    const int x0 = min((int)x, w - 2 < 0 ? 0 : w - 2);
+    const int y0 = min((int)y, h - 2 < 0 ? 0 : h - 2);
+    const int x1 = min(x0 + 1, w - 1);
+    const int y1 = min(y0 + 1, h - 1);
+    const double fx = x - x0;
+    const double fy = y - y0;
+
+    auto at = [&](int xx, int yy) {
+      return (double)in[((size_t)yy * w + xx) * cpp + p];
+    };
+    const double top = at(x0, y0) + fx * (at(x1, y0) - at(x0, y0));
+    const double bot = at(x0, y1) + fx * (at(x1, y1) - at(x0, y1));
+    return roundSample<T>(top + fy * (bot - top));
+  }
+
+  template <typename T> static T __attribute__((const)) roundSample(double v);
+
+  // Optional opcodes (flag bit 0) may be skipped by readers that cannot
+  // apply them, which is what we do for CFA images.
+  const bool optional;
+  bool skip = false;
+
+public:
+  WarpRectilinear(ByteStream& bs, uint32 flags) : optional(flags & 1) {
+    auto planes = bs.getU32();
+    if (planes == 0 || planes > 4)
+      ThrowRDE("Invalid number of warp planes: %u", planes);
+
+    coeffs.resize(planes);
+    for (auto& c : coeffs) {
+      for (auto& k : c.kr)
+        k = bs.get<double>();
+      for (auto& k : c.kt)
+        k = bs.get<double>();
+    }
+    centerX = bs.get<double>();
+    centerY = bs.get<double>();
+  }
+
+  void setup(const RawImage& ri) override {
+    // Resampling a mosaic would mix colors, the DNG SDK only warps after
+    // demosaicing as well.
+    skip = ri->isCFA && optional;
+    if (skip)
+      return;
+    if (ri->isCFA)
+      ThrowRDE("Warping CFA images is not supported");
+    if (coeffs.size() != 1 && coeffs.size() != ri->getCpp())
+      ThrowRDE("Number of warp planes does not match the image");
+  }
+
+  void apply(RawImage& ri) override {
+    if (skip)
+      return;
+    if (ri->getDataType() == TYPE_USHORT16)
+      warp<ushort16>(ri);
+    else
+      warp<float>(ri);
+  }
+};
+
+template <>
+ushort16 __attribute__((const))
+WarpRectilinear::roundSample<ushort16>(double v) {
+  return clampBits((int)(v + 0.5), 16);
+}
+
+template <>
+float __attribute__((const)) WarpRectilinear::roundSample<float>(double v) {
+  return (float)v;
+}
+
+// ****************************************************************************
+
 DngOpcodes::DngOpcodes(TiffEntry* entry) {
   ByteStream bs = entry->getData();
   // DNG opcodes seem to be always stored in big endian
@@ -339,6 +744,9 @@ DngOpcodes::DngOpcodes(TiffEntry* entry) {
     auto expected_pos = bs.getU32() + bs.getPosition();
 
     switch (code) {
+    case 1:
+      opcodes.push_back(make_unique<WarpRectilinear>(bs, flags));
+      break;
     case 4:
       opcodes.push_back(make_unique<FixBadPixelsConstant>(bs));
       break;
@@ -354,6 +762,9 @@ DngOpcodes::DngOpcodes(TiffEntry* entry) {
     case 8:
       opcodes.push_back(make_unique<PolynomialMap>(bs));
       break;
+    case 9:
+      opcodes.push_back(make_unique<GainMap>(bs));
+      break;
     case 10:
       opcodes.push_back(make_unique<OffsetPerRow>(bs));
       break;
@@ -374,16 +785,66 @@ DngOpcodes::DngOpcodes(TiffEntry* entry) {
     if (bs.getPosition() != expected_pos)
       ThrowRDE("Inconsistent length of opcode");
   }
+
+  // Chained lookups over the same area collapse into a single table
+  vector<unique_ptr<DngOpcode>> folded;
+  for (auto& code : opcodes) {
+    auto* lookup = dynamic_cast<LookupOpcode*>(code.get());
+    auto* prev = folded.empty()
+                     ? nullptr
+                     : dynamic_cast<LookupOpcode*>(folded.back().get());
+    if (lookup && prev && prev->sameArea(*lookup)) {
+      prev->compose(*lookup);
+      continue;
+    }
+    folded.push_back(move(code));
+  }
+  opcodes = move(folded);
 }
 
 // defined here as empty destrutor, otherwise we'd need a complete definition
 // of the the DngOpcode type in DngOpcodes.h
 DngOpcodes::~DngOpcodes() = default;
 
+// Applies pixel opcodes that all cover the same area in one pass over the
+// image, with the rows split into bands that are processed in parallel.
+static void applyFused(const RawImage& ri, const vector<PixelOpcode*>& ops) {
+  const PixelOpcode* first = ops.front();
+  // ~2 ns per pixel and opcode
+  const uint64 rowCost = (uint64)first->valuesPerRow() * ops.size() * 2;
+  applyInBands(ri, first->rowCount(), rowCost, [&](uint32 start, uint32 end) {
+    vector<float> scratch;
+    // Run the whole chain on a row while it is still in cache
+    for (auto i = start; i < end; ++i) {
+      const uint32 y = first->rowAt(i);
+      for (auto* op : ops)
+        op->applyRow(ri, y, scratch);
+    }
+  });
+}
+
 void DngOpcodes::applyOpCodes(RawImage& ri) {
-  for (const auto& code : opcodes) {
-    code->setup(ri);
-    code->apply(ri);
+  TraceScope trace("DngOpcodes::applyOpCodes");
+  trace.setPixels(ri->dim.area());
+  for (auto code = opcodes.begin(); code != opcodes.end();) {
+    auto* first = dynamic_cast<PixelOpcode*>(code->get());
+    if (!first) {
+      (*code)->setup(ri);
+      (*code)->apply(ri);
+      ++code;
+      continue;
+    }
+
+    // Consecutive pixel opcodes over the same area are fused into one chain
+    vector<PixelOpcode*> chain;
+    for (; code != opcodes.end(); ++code) {
+      auto* op = dynamic_cast<PixelOpcode*>(code->get());
+      if (!op || !op->sameArea(*first))
+        break;
+      (*code)->setup(ri);
+      chain.push_back(op);
+    }
+    applyFused(ri, chain);
   }
 }
 
@@ -22,14 +22,23 @@
 
 #include "common/RawImage.h"
 #include "common/Memory.h"                // for alignedFree, alignedMalloc...
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE, RawDecoderException
+#include "io/Endianness.h"                // for getLE
 #include "io/IOException.h"               // for IOException
+#include "metadata/BlackArea.h"           // for BlackArea
 #include "parsers/TiffParserException.h"  // for TiffParserException
-#include <algorithm>                      // for min
+#include <algorithm>                      // for max, min, copy_n
 #include <cassert>                        // for assert
 #include <cmath>                          // for NAN
+#include <cstdint>                        // for uintptr_t
 #include <cstdlib>                        // for free
 #include <cstring>                        // for memset, memcpy, strdup
+#include <type_traits>                    // for is_integral
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // for __m128i, _mm_load_si128, _mm_or_si128
+#endif
 
 using namespace std;
 
@@ -40,19 +49,18 @@ RawImageData::RawImageData() : cfa(iPoint2D(0, 0)) {
 #ifdef HAVE_PTHREAD
   pthread_mutex_init(&mymutex, nullptr);
   pthread_mutex_init(&errMutex, nullptr);
-  pthread_mutex_init(&mBadPixelMutex, nullptr);
 #endif
 }
 
-RawImageData::RawImageData(const iPoint2D& _dim, uint32 _bpc, uint32 _cpp)
-    : dim(_dim), isCFA(_cpp == 1), cfa(iPoint2D(0, 0)), cpp(_cpp),
-      bpp(_bpc * _cpp) {
+RawImageData::RawImageData(const iPoint2D& _dim, uint32 _bpc, uint32 _cpp,
+                           RawImageAllocator* a)
+    : dim(_dim), isCFA(_cpp == 1), cfa(iPoint2D(0, 0)), allocator(a),
+      cpp(_cpp), bpp(_bpc * _cpp) {
   fill_n(blackLevelSeparate, 4, -1);
   createData();
 #ifdef HAVE_PTHREAD
   pthread_mutex_init(&mymutex, nullptr);
   pthread_mutex_init(&errMutex, nullptr);
-  pthread_mutex_init(&mBadPixelMutex, nullptr);
 #endif
 }
 
@@ -70,7 +78,6 @@ RawImageData::~RawImageData() {
 #ifdef HAVE_PTHREAD
   pthread_mutex_destroy(&mymutex);
   pthread_mutex_destroy(&errMutex);
-  pthread_mutex_destroy(&mBadPixelMutex);
 #endif
 
   delete table;
@@ -87,20 +94,50 @@ void RawImageData::createData() {
     ThrowRDE("Dimension of one sides is less than 1 - cannot allocate image.");
   if (data)
     ThrowRDE("Duplicate data allocation in createData.");
-  pitch = roundUp((size_t)dim.x * bpp, 16);
-  data = (uchar8*)alignedMallocArray<16>(dim.y, pitch);
+  if (allocator) {
+    const uint32 rowBytes = (uint32)dim.x * bpp;
+    pitch = allocator->getPitch(dim, rowBytes);
+    if (pitch < rowBytes || pitch % 16)
+      ThrowRDE("Allocator returned invalid pitch %u for rows of %u bytes.",
+               pitch, rowBytes);
+    data = allocator->allocate(dim, pitch);
+    // The SSE2 paths use aligned loads and stores on whole rows
+    if ((uintptr_t)data % 16) {
+      allocator->release(data);
+      data = nullptr;
+      ThrowRDE("Allocator returned a buffer that is not 16 byte aligned.");
+    }
+  } else {
+    pitch = roundUp((size_t)dim.x * bpp, 16);
+    data = (uchar8*)alignedMallocArray<16>(dim.y, pitch);
+  }
   if (!data)
     ThrowRDE("Memory Allocation failed.");
   uncropped_dim = dim;
 }
 
-void RawImageData::destroyData() {
+void RawImageData::createWithoutData() {
+  if (dim.x > 65535 || dim.y > 65535)
+    ThrowRDE("Dimensions too large for allocation.");
+  if (dim.x <= 0 || dim.y <= 0)
+    ThrowRDE("Dimension of one sides is less than 1 - cannot allocate image.");
   if (data)
-    alignedFree(data);
+    ThrowRDE("Duplicate data allocation in createWithoutData.");
+  uncropped_dim = dim;
+}
+
+void RawImageData::destroyData() {
+  if (data) {
+    if (allocator)
+      allocator->release(data);
+    else
+      alignedFree(data);
+  }
   if (mBadPixelMap)
     alignedFree(mBadPixelMap);
   data = nullptr;
   mBadPixelMap = nullptr;
+  mBadPixelMapRows.clear();
 }
 
 void RawImageData::setCpp(uint32 val) {
@@ -117,6 +154,12 @@ void RawImageData::setCpp(uint32 val) {
   bpp *= val;
 }
 
+void RawImageData::setAllocator(RawImageAllocator* a) {
+  if (data)
+    ThrowRDE("Attempted to set allocator after data allocation");
+  allocator = a;
+}
+
 uchar8* RawImageData::getData() {
   if (!data)
     ThrowRDE("Data not yet allocated.");
@@ -161,7 +204,8 @@ iPoint2D __attribute__((pure)) RawImageData::getCropOffset() const {
 }
 
 void RawImageData::subFrame(iRectangle2D crop) {
-  if (!crop.dim.isThisInside(dim - crop.pos)) {
+  const iPoint2D cropDim = getFullCrop().dim;
+  if (!crop.dim.isThisInside(cropDim - crop.pos)) {
     writeLog(DEBUG_PRIO_WARNING, "WARNING: RawImageData::subFrame - Attempted to create new subframe larger than original size. Crop skipped.\n");
     return;
   }
@@ -170,10 +214,302 @@ void RawImageData::subFrame(iRectangle2D crop) {
     return;
   }
 
+  if (binning > 1 && mWindowCrop.hasPositiveArea()) {
+    mWindowCrop.pos += crop.pos;
+    mWindowCrop.dim = crop.dim;
+    const iRectangle2D binned = binnedRect(mWindowCrop);
+    if (!binned.hasPositiveArea())
+      ThrowRDE("Crop is too small for binning.");
+    mOffset = binned.pos;
+    dim = binned.dim;
+    return;
+  }
+
+  if (mWindow.hasPositiveArea()) {
+    mWindowCrop.pos += crop.pos;
+    mWindowCrop.dim = crop.dim;
+    iRectangle2D visible = mWindowCrop.getOverlap(mWindow);
+    if (!visible.hasPositiveArea())
+      ThrowRDE("Region of interest is outside of the image crop.");
+    mOffset = visible.pos - mWindow.pos;
+    dim = visible.dim;
+    return;
+  }
+
   mOffset += crop.pos;
   dim = crop.dim;
 }
 
+void RawImageData::setWindow(const iRectangle2D& window,
+                             const iPoint2D& fullDim) {
+  if (window.dim != uncropped_dim)
+    ThrowRDE("Window does not match the image data.");
+  if (window.pos == iPoint2D(0, 0) && window.dim == fullDim)
+    return;
+
+  mWindow = window;
+  mWindowCrop = iRectangle2D(iPoint2D(0, 0), fullDim);
+  windowPos = window.pos;
+}
+
+void RawImageData::applyWindow() {
+  if (binning > 1 && mWindowCrop.hasPositiveArea()) {
+    applyBinning();
+    return;
+  }
+  if (!mWindow.hasPositiveArea())
+    return;
+
+  // The CFA is given for the origin of the crop, not of the visible part
+  if (isCFA && cfa.getSize().area() > 0) {
+    const iPoint2D shift = mWindow.pos + mOffset - mWindowCrop.pos;
+    cfa.shiftLeft(shift.x);
+    cfa.shiftDown(shift.y);
+  }
+
+  // Only the part of the black areas inside the window is left
+  vector<BlackArea> areas;
+  for (const auto& area : blackAreas) {
+    const int start = area.isVertical ? mWindow.pos.x : mWindow.pos.y;
+    const int end = start + (area.isVertical ? mWindow.dim.x : mWindow.dim.y);
+    const int first = max((int)area.offset, start);
+    const int last = min((int)(area.offset + area.size), end);
+    if (first < last)
+      areas.emplace_back(first - start, last - first, area.isVertical);
+  }
+  blackAreas = areas;
+
+  mWindow = iRectangle2D();
+  mWindowCrop = iRectangle2D();
+}
+
+iRectangle2D RawImageData::getBlackAreasRect() const {
+  iRectangle2D rect;
+  if (!mWindow.hasPositiveArea())
+    return rect;
+
+  // Horizontal areas are read over the width of the crop, vertical ones
+  // over its height
+  for (const auto& area : blackAreas) {
+    iRectangle2D r(mWindowCrop.pos.x, area.offset, mWindowCrop.dim.x,
+                   area.size);
+    if (area.isVertical)
+      r = iRectangle2D(area.offset, mWindowCrop.pos.y, area.size,
+                       mWindowCrop.dim.y);
+    rect = rect.hasPositiveArea() ? rect.combine(r) : r;
+  }
+  return rect;
+}
+
+void RawImageData::calculateBlackAreasFrom(RawImageData* black) {
+  iRectangle2D window = black->mWindow;
+  if (!window.hasPositiveArea())
+    window = iRectangle2D(iPoint2D(0, 0), black->uncropped_dim);
+  if (!getBlackAreasRect().isThisInside(window))
+    ThrowRDE("(internal) The black areas were not decoded.");
+
+  // Window coordinates of black. The window starts at an even position,
+  // so the CFA phase of every pixel is kept.
+  black->mOffset = mWindowCrop.pos - window.pos;
+  black->dim = mWindowCrop.dim;
+  black->blackAreas = blackAreas;
+  for (auto& area : black->blackAreas)
+    area.offset -= area.isVertical ? window.pos.x : window.pos.y;
+  black->blackLevel = blackLevel;
+  black->isCFA = isCFA;
+
+  black->calculateBlackAreas();
+  copy_n(black->blackLevelSeparate, 4, blackLevelSeparate);
+}
+
+// Each output pixel is the average of factor x factor input pixels. For CFA
+// images they are taken from a block of (2 * factor)^2 pixels, in steps of
+// 2, so the 2x2 CFA is kept.
+template <typename T, typename Sum>
+static void binPixels(const uchar8* src, uint32 srcPitch, uchar8* dst,
+                      uint32 dstPitch, const iPoint2D& out, uint32 cpp,
+                      uint32 factor, bool isCFA) {
+  const uint32 step = isCFA ? 2 : 1;
+  const uint32 n = factor * factor;
+  vector<const T*> rows(factor);
+
+  for (int y = 0; y < out.y; y++) {
+    const uint32 by = isCFA ? (y >> 1) * 2 * factor + (y & 1) : y * factor;
+    for (uint32 j = 0; j < factor; j++)
+      rows[j] = (const T*)&src[(size_t)(by + j * step) * srcPitch];
+    auto* dest = (T*)&dst[(size_t)y * dstPitch];
+
+    for (int x = 0; x < out.x; x++) {
+      const uint32 bx = isCFA ? (x >> 1) * 2 * factor + (x & 1) : x * factor;
+      for (uint32 c = 0; c < cpp; c++) {
+        Sum sum = 0;
+        for (uint32 j = 0; j < factor; j++)
+          for (uint32 i = 0; i < factor; i++)
+            sum += rows[j][(bx + i * step) * cpp + c];
+        dest[x * cpp + c] = std::is_integral<T>::value ? (sum + n / 2) / n
+                                                       : sum / n;
+      }
+    }
+  }
+}
+
+// Size of the image binned by factor, only whole blocks are kept
+static iPoint2D binnedDim(const iPoint2D& full, uint32 factor, bool isCFA) {
+  const uint32 block = isCFA ? 2 * factor : factor;
+  return {(int)((full.x / block) * (block / factor)),
+          (int)((full.y / block) * (block / factor))};
+}
+
+void RawImageData::setBinning(uint32 factor) {
+  if (factor != 2 && factor != 4)
+    ThrowRDE("Unsupported binning factor %u", factor);
+  if (data)
+    ThrowRDE("(internal) Binning must be set before the data is allocated.");
+
+  const iPoint2D out = binnedDim(dim, factor, isCFA);
+  if (out.area() <= 0)
+    ThrowRDE("Image too small for binning");
+
+  binning = factor;
+  unbinnedDim = dim;
+  mWindowCrop = iRectangle2D(iPoint2D(0, 0), dim);
+  dim = out;
+}
+
+uint32 RawImageData::getBinningBlock() const {
+  if (binning == 1)
+    return 1;
+  return isCFA ? 2 * binning : binning;
+}
+
+iPoint2D RawImageData::getUnbinnedDim() const {
+  return binning > 1 ? unbinnedDim : uncropped_dim;
+}
+
+void RawImageData::binRows(const uchar8* src, uint32 srcPitch, uint32 y,
+                           uint32 rows) {
+  if (binning == 1)
+    ThrowRDE("(internal) Image is not binned.");
+  if ((uint64)y + rows > (uint64)uncropped_dim.y)
+    ThrowRDE("Binned rows %u to %u are outside of the image", y, y + rows);
+
+  const iPoint2D out(uncropped_dim.x, rows);
+  uchar8* dst = getDataUncropped(0, y);
+  if (dataType == TYPE_USHORT16)
+    binPixels<ushort16, uint32>(src, srcPitch, dst, pitch, out, cpp, binning,
+                                isCFA);
+  else
+    binPixels<float, float>(src, srcPitch, dst, pitch, out, cpp, binning,
+                            isCFA);
+}
+
+// The binned pixels of the blocks that are inside of rect, which is given in
+// full resolution coordinates
+iRectangle2D RawImageData::binnedRect(const iRectangle2D& rect) const {
+  const int block = getBinningBlock();
+  const int perBlock = block / binning;
+  const iPoint2D br = rect.getBottomRight();
+  iRectangle2D binned;
+  binned.setAbsolute((rect.pos.x + block - 1) / block * perBlock,
+                     (rect.pos.y + block - 1) / block * perBlock,
+                     br.x / block * perBlock, br.y / block * perBlock);
+  return binned;
+}
+
+void RawImageData::applyBinning() {
+  const int block = getBinningBlock();
+  const int perBlock = block / binning;
+
+  if (isCFA) {
+    if (cfa.getSize() != iPoint2D(2, 2))
+      ThrowRDE("Binning is only possible with a 2x2 CFA");
+    // The CFA is given for the origin of the crop, the binned crop starts
+    // at the next block. Binning keeps the parity of the positions.
+    const iPoint2D start(mOffset.x / perBlock * block,
+                         mOffset.y / perBlock * block);
+    const iPoint2D shift = start - mWindowCrop.pos;
+    cfa.shiftLeft(shift.x);
+    cfa.shiftDown(shift.y);
+  }
+
+  // Every block touching a black area is kept, so areas narrower than a
+  // block or not aligned to one are not lost. A partial block also averages
+  // some pixels next to the area, the median of the areas mostly hides that.
+  vector<BlackArea> areas;
+  for (const auto& area : blackAreas) {
+    const int offset = area.offset;
+    const int end = area.isVertical ? uncropped_dim.x : uncropped_dim.y;
+    const int first = offset / block * perBlock;
+    const int last = min(
+        (offset + (int)area.size + block - 1) / block * perBlock, end);
+    if (area.size > 0 && first < last)
+      areas.emplace_back(first, last - first, area.isVertical);
+  }
+  blackAreas = areas;
+
+  // Positions in the full resolution image have no meaning anymore
+  mBadPixelPositions.clear();
+
+  mWindowCrop = iRectangle2D();
+}
+
+void RawImageData::bin(uint32 factor) {
+  TraceScope trace("RawImageData::bin");
+  if (factor != 2 && factor != 4)
+    ThrowRDE("Unsupported binning factor %u", factor);
+  if (isCFA && cfa.getSize() != iPoint2D(2, 2))
+    ThrowRDE("Binning is only possible with a 2x2 CFA");
+
+  const iPoint2D out = binnedDim(dim, factor, isCFA);
+  if (out.area() <= 0)
+    ThrowRDE("Image too small for binning");
+
+  // Keep the old data, until the new image is filled from it
+  uchar8* src = getData(0, 0);
+  uchar8* oldData = data;
+  const uint32 srcPitch = pitch;
+  const iPoint2D oldDim = dim;
+  data = nullptr;
+  try {
+    dim = out;
+    createData();
+  } catch (...) {
+    data = oldData;
+    pitch = srcPitch;
+    dim = oldDim;
+    throw;
+  }
+
+  if (dataType == TYPE_USHORT16)
+    binPixels<ushort16, uint32>(src, srcPitch, data, pitch, out, cpp, factor,
+                                isCFA);
+  else
+    binPixels<float, float>(src, srcPitch, data, pitch, out, cpp, factor,
+                            isCFA);
+  trace.setPixels(out.area());
+
+  if (allocator)
+    allocator->release(oldData);
+  else
+    alignedFree(oldData);
+
+  // Positions in the old image have no meaning anymore
+  mOffset = iPoint2D(0, 0);
+  windowPos = iPoint2D(0, 0);
+  blackAreas.clear();
+  mBadPixelPositions.clear();
+  if (mBadPixelMap)
+    alignedFree(mBadPixelMap);
+  mBadPixelMap = nullptr;
+  mBadPixelMapRows.clear();
+}
+
+iRectangle2D RawImageData::getFullCrop() const {
+  if (mWindow.hasPositiveArea() || (binning > 1 && mWindowCrop.hasPositiveArea()))
+    return mWindowCrop;
+  return iRectangle2D(mOffset, dim);
+}
+
 void RawImageData::setError(const string& err) {
 #ifdef HAVE_PTHREAD
   pthread_mutex_lock(&errMutex);
@@ -188,11 +524,14 @@ void RawImageData::createBadPixelMap()
 {
   if (!isAllocated())
     ThrowRDE("(internal) Bad pixel map cannot be allocated before image.");
-  mBadPixelMapPitch = roundUp(uncropped_dim.x / 8, 16);
+  if (mBadPixelMap)
+    return;
+  mBadPixelMapPitch = roundUp((uncropped_dim.x + 7) / 8, 16);
   mBadPixelMap = (uchar8*)alignedMallocArray<16>(uncropped_dim.y, mBadPixelMapPitch);
-  memset(mBadPixelMap, 0, (size_t)mBadPixelMapPitch * uncropped_dim.y);
   if (!mBadPixelMap)
     ThrowRDE("Memory Allocation failed.");
+  memset(mBadPixelMap, 0, (size_t)mBadPixelMapPitch * uncropped_dim.y);
+  mBadPixelMapRows.assign(uncropped_dim.y, 0);
 }
 
 RawImage::RawImage(RawImageData* p) : p_(p) {
@@ -245,16 +584,20 @@ void RawImageData::transferBadPixelsToMap()
   if (!mBadPixelMap)
     createBadPixelMap();
 
-  for (unsigned int pos : mBadPixelPositions) {
-    uint32 pos_x = pos&0xffff;
-    uint32 pos_y = pos>>16;
-    mBadPixelMap[mBadPixelMapPitch * pos_y + (pos_x >> 3)] |= 1 << (pos_x&7);
+  for (const auto& pos : mBadPixelPositions) {
+    // positions may come straight from the file (DNG opcodes)
+    if (!(pos >= iPoint2D(0, 0) && pos < uncropped_dim))
+      continue;
+    mBadPixelMap[(size_t)mBadPixelMapPitch * pos.y + (pos.x >> 3)] |=
+        1 << (pos.x & 7);
+    mBadPixelMapRows[pos.y] = 1;
   }
   mBadPixelPositions.clear();
 }
 
 void RawImageData::fixBadPixels()
 {
+  TraceScope trace("RawImageData::fixBadPixels");
 #if !defined (EMULATE_DCRAW_BAD_PIXELS)
 
   /* Transfer if not already done */
@@ -267,6 +610,7 @@ void RawImageData::fixBadPixels()
     for (int x = 1200; x < 1700; x++) {
       mBadPixelMap[mBadPixelMapPitch * y + (x >> 3)] |= 1 << (x&7);
     }
+    mBadPixelMapRows[y] = 1;
   }
 #endif
 
@@ -276,10 +620,9 @@ void RawImageData::fixBadPixels()
 
 #else  // EMULATE_DCRAW_BAD_PIXELS - not recommended, testing purposes only
 
-  for (vector<uint32>::iterator i=mBadPixelPositions.begin(); i != mBadPixelPositions.end(); ++i) {
-    uint32 pos = *i;
-    uint32 pos_x = pos&0xffff;
-    uint32 pos_y = pos>>16;
+  for (vector<iPoint2D>::iterator i=mBadPixelPositions.begin(); i != mBadPixelPositions.end(); ++i) {
+    uint32 pos_x = i->x;
+    uint32 pos_y = i->y;
     uint32 total = 0;
     uint32 div = 0;
     // 0 side covered by unsignedness.
@@ -308,7 +651,20 @@ void RawImageData::startWorker(RawImageWorker::RawImageWorkerTask task, bool cro
     height = uncropped_dim.y;
   }
 
-  int threads = getThreadCount();
+  // Rough cost of the tasks per pixel (component), in ns
+  uint32 pixelCost = 1;
+  if (task == RawImageWorker::SCALE_VALUES)
+    pixelCost = 4;
+  else if (task == RawImageWorker::APPLY_LOOKUP)
+    pixelCost = 3;
+  const int width = (cropped && !(task & RawImageWorker::FULL_IMAGE))
+                        ? dim.x
+                        : uncropped_dim.x;
+
+  const WorkSplit split =
+      splitWork("RawImageData::startWorker", height,
+                (uint64)width * cpp * pixelCost, getThreadCount(threadCount));
+  int threads = split.threads;
   if (threads <= 1) {
     RawImageWorker worker(this, task, 0, height);
     worker.performTask();
@@ -318,7 +674,7 @@ void RawImageData::startWorker(RawImageWorker::RawImageWorkerTask task, bool cro
 #ifdef HAVE_PTHREAD
   auto **workers = new RawImageWorker *[threads];
   int y_offset = 0;
-  int y_per_thread = (height + threads - 1) / threads;
+  int y_per_thread = split.itemsPerThread;
 
   for (int i = 0; i < threads; i++) {
     int y_end = min(y_offset + y_per_thread, height);
@@ -336,31 +692,59 @@ void RawImageData::startWorker(RawImageWorker::RawImageWorkerTask task, bool cro
 #endif
 }
 
+#if defined(__SSE2__)
+// Whether 'blocks' consecutive (aligned) 128 bit blocks are all zero
+static inline bool isZero_SSE2(const uchar8* p, int blocks) {
+  __m128i v = _mm_load_si128((const __m128i*)p);
+  for (int i = 1; i < blocks; i++)
+    v = _mm_or_si128(v, _mm_load_si128((const __m128i*)p + i));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) == 0xFFFF;
+}
+#endif
+
 void RawImageData::fixBadPixelsThread( int start_y, int end_y )
 {
-  int gw = (uncropped_dim.x + 15) / 32;
+  // Bytes of a map row that cover the image, the rest is padding up to pitch
+  const uint32 rowBytes = (uncropped_dim.x + 7) / 8;
 #ifdef __AFL_COMPILER
   int bad_count = 0;
 #endif
   for (int y = start_y; y < end_y; y++) {
-    auto *bad_map = (uint32 *)&mBadPixelMap[y * mBadPixelMapPitch];
-    for (int x = 0 ; x < gw; x++) {
-      // Test if there is a bad pixel within these 32 pixels
-      if (bad_map[x] != 0) {
-        auto *bad = (uchar8 *)&bad_map[x];
-        // Go through each pixel
-        for (int i = 0; i < 4; i++) {
-          for (int j = 0; j < 8; j++) {
-            if (1 == ((bad[i]>>j) & 1)) {
+    // Nothing was ever marked in this row
+    if (!mBadPixelMapRows[y])
+      continue;
+
+    const uchar8* bad_map = &mBadPixelMap[(size_t)y * mBadPixelMapPitch];
+    uint32 pos = 0;
+    while (pos < rowBytes) {
+#if defined(__SSE2__)
+      // Skip runs of 512, or else 128 pixels without any bad one. The map
+      // and its pitch are 16 byte aligned, so these loads stay inside it.
+      if (pos % 16 == 0) {
+        if (pos + 64 <= mBadPixelMapPitch && isZero_SSE2(&bad_map[pos], 4)) {
+          pos += 64;
+          continue;
+        }
+        if (isZero_SSE2(&bad_map[pos], 1)) {
+          pos += 16;
+          continue;
+        }
+      }
+#endif
+      // Go through each bad pixel of these 64
+      uint64 bits = getLE<uint64>(&bad_map[pos]);
+      while (bits) {
+        const uint32 x = pos * 8 + __builtin_ctzll(bits);
+        bits &= bits - 1;
+        if ((int)x >= uncropped_dim.x)
+          break;
 #ifdef __AFL_COMPILER
-              if (bad_count++ > 100)
-                ThrowRDE("The bad pixels are too damn high!");
+        if (bad_count++ > 100)
+          ThrowRDE("The bad pixels are too damn high!");
 #endif
-              fixBadPixel(x*32+i*8+j, y, 0);
-            }
-          }
-        }
+        fixBadPixel(x, y, 0);
       }
+      pos += 8;
     }
   }
 }
@@ -508,6 +892,7 @@ void RawImageWorker::waitForThread()
 
 void RawImageWorker::performTask()
 {
+  TraceScope trace("RawImageWorker::performTask");
   try {
     switch(task)
     {
@@ -520,6 +905,12 @@ void RawImageWorker::performTask()
     case APPLY_LOOKUP:
       data->doLookup(start_y, end_y);
       break;
+    case HISTOGRAM_BLACK_AREAS:
+      data->histogramBlackAreas(start_y, end_y);
+      break;
+    case FIND_MIN_MAX:
+      data->findMinMax(start_y, end_y);
+      break;
     default:
       assert(false);
     }
@@ -536,6 +927,8 @@ void RawImageData::sixteenBitLookup() {
   if (table == nullptr) {
     return;
   }
+  TraceScope trace("RawImageData::sixteenBitLookup");
+  trace.setPixels(dim.area());
   startWorker(RawImageWorker::APPLY_LOOKUP, true);
 }
 
@@ -23,6 +23,7 @@
 #include "rawspeedconfig.h"
 
 #include "common/Common.h"             // for uint32, uchar8, ushort16, wri...
+#include "common/DecodeCounters.h"     // for DecodeCounters
 #include "common/Point.h"              // for iPoint2D, iRectangle2D (ptr o...
 #include "metadata/BlackArea.h"        // for BlackArea
 #include "metadata/ColorFilterArray.h" // for ColorFilterArray
@@ -41,10 +42,33 @@ class RawImageData;
 
 enum RawImageType { TYPE_USHORT16, TYPE_FLOAT32 };
 
+// Lets the host application provide the memory the image data is decoded
+// into, e.g. its own pinned or shared memory buffers, so no copy is needed
+// afterwards. The allocator must outlive all images using it.
+class RawImageAllocator {
+public:
+  virtual ~RawImageAllocator() = default;
+
+  // Returns the pitch (bytes between the start of two rows) to use for an
+  // image of dim pixels and rowBytes bytes per row.
+  // Must be at least rowBytes and a multiple of 16.
+  virtual uint32 getPitch(const iPoint2D& dim, uint32 rowBytes) {
+    return roundUp(rowBytes, 16);
+  }
+
+  // Returns a buffer of dim.y rows of pitch bytes, aligned to (at least)
+  // 16 bytes, or nullptr if it can not be provided.
+  virtual uchar8* allocate(const iPoint2D& dim, uint32 pitch) = 0;
+
+  // Called when the image no longer uses a buffer returned by allocate().
+  virtual void release(uchar8* data) = 0;
+};
+
 class RawImageWorker {
 public:
   enum RawImageWorkerTask {
-    SCALE_VALUES = 1, FIX_BAD_PIXELS = 2, APPLY_LOOKUP = 3 | 0x1000, FULL_IMAGE = 0x1000
+    SCALE_VALUES = 1, FIX_BAD_PIXELS = 2, APPLY_LOOKUP = 3 | 0x1000,
+    HISTOGRAM_BLACK_AREAS = 4 | 0x1000, FIND_MIN_MAX = 5, FULL_IMAGE = 0x1000
   };
 
   RawImageWorker(RawImageData *img, RawImageWorkerTask task, int start_y, int end_y);
@@ -117,7 +141,12 @@ public:
   uint32 getCpp() const { return cpp; }
   uint32 getBpp() const { return bpp; }
   void setCpp(uint32 val);
+  // Image data will be allocated through a, if not nullptr.
+  void setAllocator(RawImageAllocator* a);
   void createData();
+  // Sets the image up like createData(), but without allocating any data,
+  // for images that only carry metadata (see RawDecoder::probeMetadata()).
+  void createWithoutData();
   void destroyData();
   void blitFrom(const RawImage& src, const iPoint2D& srcPos,
                 const iPoint2D& size, const iPoint2D& destPos);
@@ -126,9 +155,50 @@ public:
   uchar8* getData(uint32 x, uint32 y);    // Not super fast, but safe. Don't use per pixel.
   uchar8* getDataUncropped(uint32 x, uint32 y);
   void subFrame(iRectangle2D cropped);
+  // Tells the image that its data only holds window of an image of size
+  // fullDim (see RawDecoder::roi). Until applyWindow(), crops are given
+  // in full image coordinates, and are intersected with the window.
+  void setWindow(const iRectangle2D& window, const iPoint2D& fullDim);
+  // Moves the CFA and black areas, given for the full image, to the window.
+  // For an image binned while decoding, maps them to the binned image.
+  void applyWindow();
+  // The part of the full image calculateBlackAreas() would read for the
+  // current crop, if only a window of the image is held. Empty otherwise,
+  // or if there are no black areas.
+  iRectangle2D __attribute__((pure)) getBlackAreasRect() const;
+  // Sets the black levels of a window image from its black areas, read
+  // from black, a window of the same image covering getBlackAreasRect().
+  void calculateBlackAreasFrom(RawImageData* black);
+  // Makes createData() allocate the image binned by factor (see bin()), to
+  // be filled through RowBinner while decoding. Until applyWindow(), crops
+  // are given in full resolution coordinates, only the binned blocks inside
+  // of the crop are kept.
+  void setBinning(uint32 factor);
+  // 1 unless the image has been binned while decoding
+  uint32 getBinning() const { return binning; }
+  // Rows (and columns) of the full resolution image binned into one block,
+  // 2 * binning for CFA images. 1 if the image is not binned.
+  uint32 __attribute__((pure)) getBinningBlock() const;
+  // The uncropped size of the image before binning
+  iPoint2D __attribute__((pure)) getUnbinnedDim() const;
+  // Bins the full resolution rows at src into the (uncropped) rows
+  // [y, y + rows) of an image binned while decoding, see RowBinner.
+  void binRows(const uchar8* src, uint32 srcPitch, uint32 y, uint32 rows);
+  // Replaces the (cropped) image by one with factor times less pixels
+  // in each direction, by averaging same colored sites. Bad pixels must
+  // have been fixed before, black areas are gone afterwards.
+  void bin(uint32 factor);
+  // The current crop in full image coordinates. Unless only a window of
+  // the image has been decoded, or it is binned while decoding, that is
+  // the same as cropOffset and dim.
+  iRectangle2D __attribute__((pure)) getFullCrop() const;
   void clearArea(iRectangle2D area, uchar8 value = 0);
   iPoint2D __attribute__((pure)) getUncroppedDim() const;
   iPoint2D __attribute__((pure)) getCropOffset() const;
+  // Position of the uncropped data in the full image, not (0, 0) if only a
+  // region of interest was decoded (see RawDecoder::roi). The crop then
+  // starts at getWindowPos() + getCropOffset() of the full image.
+  iPoint2D getWindowPos() const { return windowPos; }
   virtual void scaleBlackWhite() = 0;
   virtual void calculateBlackAreas() = 0;
   virtual void setWithLookUp(ushort16 value, uchar8* dst, uint32* random) = 0;
@@ -142,6 +212,16 @@ public:
 
   bool isAllocated() {return !!data;}
   void createBadPixelMap();
+
+  // Marks the pixel at the (uncropped) position x, y as bad, straight in
+  // mBadPixelMap. This is lock-free, so decoder threads may call it
+  // concurrently, but the map must have been created beforehand.
+  void markBadPixel(uint32 x, uint32 y) {
+    uchar8* group = &mBadPixelMap[(size_t)y * mBadPixelMapPitch + (x >> 3)];
+    __atomic_fetch_or(group, (uchar8)(1 << (x & 7)), __ATOMIC_RELAXED);
+    __atomic_store_n(&mBadPixelMapRows[y], (uchar8)1, __ATOMIC_RELAXED);
+  }
+
   iPoint2D dim;
   uint32 pitch = 0;
   bool isCFA{true};
@@ -154,36 +234,49 @@ public:
   /* an incomplete image. */
   std::vector<std::string> errors;
   void setError(const std::string& err);
-  /* Vector containing the positions of bad pixels */
-  /* Format is x | (y << 16), so maximum pixel position is 65535 */
-  std::vector<uint32> mBadPixelPositions;    // Positions of zeroes that must be interpolated
+  /* Vector containing the (uncropped) positions of bad pixels */
+  /* Single threaded producers only, decoder threads use markBadPixel() */
+  std::vector<iPoint2D> mBadPixelPositions;  // Positions of zeroes that must be interpolated
   uchar8* mBadPixelMap = nullptr;
   uint32 mBadPixelMapPitch = 0;
+  std::vector<uchar8> mBadPixelMapRows; // non-zero if the row has bad pixels
   bool mDitherScale =
       true; // Should upscaling be done with dither to minimize banding?
+  uint32 threadCount = 0; // Threads used to process the image, 0 = automatic
   ImageMetaData metadata;
+  DecodeCounters counters = DecodeCounters(); // of RawDecoder::decodeRaw()
 
 #ifdef HAVE_PTHREAD
   pthread_mutex_t errMutex;   // Mutex for 'errors'
-  pthread_mutex_t mBadPixelMutex;   // Mutex for 'mBadPixelPositions, must be used if more than 1 thread is accessing vector
 #endif
 
 protected:
   RawImageType dataType;
   RawImageData();
-  RawImageData(const iPoint2D &dim, uint32 bpp, uint32 cpp = 1);
+  RawImageData(const iPoint2D &dim, uint32 bpp, uint32 cpp = 1,
+               RawImageAllocator* a = nullptr);
   virtual void scaleValues(int start_y, int end_y) = 0;
   virtual void doLookup(int start_y, int end_y) = 0;
   virtual void fixBadPixel( uint32 x, uint32 y, int component = 0) = 0;
+  virtual void histogramBlackAreas(int start_y, int end_y) = 0;
+  virtual void findMinMax(int start_y, int end_y) = 0;
   void fixBadPixelsThread(int start_y, int end_y);
+  iRectangle2D __attribute__((pure)) binnedRect(const iRectangle2D& rect) const;
+  void applyBinning();
   void startWorker(RawImageWorker::RawImageWorkerTask task, bool cropped );
   uint32 dataRefCount = 0;
   uchar8* data = nullptr;
+  RawImageAllocator* allocator = nullptr;
   uint32 cpp = 1; // Components per pixel
   uint32 bpp = 0; // Bytes per pixel.
   friend class RawImage;
   iPoint2D mOffset;
   iPoint2D uncropped_dim;
+  iRectangle2D mWindow;     // Part of the full image the data holds
+  iRectangle2D mWindowCrop; // Crop in full image coordinates
+  iPoint2D windowPos;       // mWindow.pos, kept after applyWindow()
+  uint32 binning = 1;       // Factor the data is binned by, see setBinning()
+  iPoint2D unbinnedDim;     // Uncropped size before binning
   TableLookUp* table = nullptr;
 #ifdef HAVE_PTHREAD
   pthread_mutex_t mymutex;
@@ -204,9 +297,18 @@ protected:
   void scaleValues(int start_y, int end_y) override;
   void fixBadPixel(uint32 x, uint32 y, int component = 0) override;
   void doLookup(int start_y, int end_y) override;
+  void histogramBlackAreas(int start_y, int end_y) override;
+  void findMinMax(int start_y, int end_y) override;
+
+  // Shared results of the histogramBlackAreas()/findMinMax() workers,
+  // each worker merges its part under mymutex.
+  std::vector<uint32> mBlackHistogram;
+  int mMinValue = 65536;
+  int mMaxValue = 0;
 
   RawImageDataU16();
-  RawImageDataU16(const iPoint2D &dim, uint32 cpp = 1);
+  RawImageDataU16(const iPoint2D &dim, uint32 cpp = 1,
+                  RawImageAllocator* a = nullptr);
   friend class RawImage;
 };
 
@@ -220,6 +322,8 @@ protected:
   void scaleValues(int start_y, int end_y) override;
   void fixBadPixel(uint32 x, uint32 y, int component = 0) override;
   [[noreturn]] void doLookup(int start_y, int end_y) override;
+  [[noreturn]] void histogramBlackAreas(int start_y, int end_y) override;
+  [[noreturn]] void findMinMax(int start_y, int end_y) override;
   RawImageDataFloat();
   RawImageDataFloat(const iPoint2D &dim, uint32 cpp = 1);
   friend class RawImage;
@@ -230,7 +334,8 @@ protected:
    static RawImage create(RawImageType type = TYPE_USHORT16);
    static RawImage create(const iPoint2D &dim,
                           RawImageType type = TYPE_USHORT16,
-                          uint32 componentsPerPixel = 1);
+                          uint32 componentsPerPixel = 1,
+                          RawImageAllocator* allocator = nullptr);
    RawImageData* operator->() const { return p_; }
    RawImageData& operator*() const { return *p_; }
    RawImage(RawImageData* p);  // p must not be NULL
@@ -258,10 +363,11 @@ inline RawImage RawImage::create(RawImageType type)  {
 }
 
 inline RawImage RawImage::create(const iPoint2D &dim, RawImageType type,
-                                 uint32 componentsPerPixel) {
+                                 uint32 componentsPerPixel,
+                                 RawImageAllocator* allocator) {
   switch (type) {
     case TYPE_USHORT16:
-      return new RawImageDataU16(dim, componentsPerPixel);
+      return new RawImageDataU16(dim, componentsPerPixel, allocator);
     default:
       writeLog(DEBUG_PRIO_ERROR, "RawImage::create: Unknown Image type!\n");
   }
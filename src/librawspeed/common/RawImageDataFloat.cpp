@@ -21,6 +21,7 @@
 #include "common/Common.h"                // for uchar8, uint32, writeLog
 #include "common/Point.h"                 // for iPoint2D
 #include "common/RawImage.h"              // for RawImageDataFloat, RawImag...
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "metadata/BlackArea.h"           // for BlackArea
 #include <algorithm>                      // for max, min
@@ -42,6 +43,7 @@ RawImageDataFloat::RawImageDataFloat() {
 
 
   void RawImageDataFloat::calculateBlackAreas() {
+    TraceScope trace("RawImageData::calculateBlackAreas");
     float accPixels[4] = {0,0,0,0};
     int totalpixels = 0;
 
@@ -102,6 +104,7 @@ RawImageDataFloat::RawImageDataFloat() {
   }
 
   void RawImageDataFloat::scaleBlackWhite() {
+    TraceScope trace("RawImageData::scaleBlackWhite");
     const int skipBorder = 150;
     int gw = (dim.x - skipBorder) * cpp;
     if ((blackAreas.empty() && blackLevelSeparate[0] < 0 && blackLevel < 0) || whitePoint == 65536) {  // Estimate
@@ -126,6 +129,7 @@ RawImageDataFloat::RawImageDataFloat() {
     if (blackLevelSeparate[0] < 0)
       calculateBlackAreas();
 
+    trace.setPixels(dim.area());
     startWorker(RawImageWorker::SCALE_VALUES, true);
 }
 
@@ -366,6 +370,14 @@ void RawImageDataFloat::doLookup( int start_y, int end_y ) {
   ThrowRDE("Float point lookup tables not implemented");
 }
 
+void RawImageDataFloat::histogramBlackAreas(int start_y, int end_y) {
+  ThrowRDE("Float point black area histogram not implemented");
+}
+
+void RawImageDataFloat::findMinMax(int start_y, int end_y) {
+  ThrowRDE("Float point min/max scan not implemented");
+}
+
 void RawImageDataFloat::setWithLookUp(ushort16 value, uchar8* dst, uint32* random) {
   auto *dest = (float *)dst;
   if (table == nullptr) {
@@ -22,6 +22,7 @@
 #include "common/Common.h"                // for ushort16, uint32, uchar8
 #include "common/Memory.h"                // for alignedFree, alignedMalloc...
 #include "common/Point.h"                 // for iPoint2D
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "metadata/BlackArea.h"           // for BlackArea
 #include <algorithm>                      // for fill, max, min
@@ -42,16 +43,18 @@ RawImageDataU16::RawImageDataU16() {
   bpp = 2;
 }
 
-RawImageDataU16::RawImageDataU16(const iPoint2D &_dim, uint32 _cpp)
-    : RawImageData(_dim, 2, _cpp) {
+RawImageDataU16::RawImageDataU16(const iPoint2D &_dim, uint32 _cpp,
+                                 RawImageAllocator* a)
+    : RawImageData(_dim, 2, _cpp, a) {
   dataType = TYPE_USHORT16;
 }
 
 
-void RawImageDataU16::calculateBlackAreas() {
-  vector<unsigned int> histogram(4 * 65536);
-  fill(histogram.begin(), histogram.end(), 0);
+// Border that is left out when estimating black and white from the image
+static const int skipBorder = 250;
 
+void RawImageDataU16::calculateBlackAreas() {
+  TraceScope trace("RawImageData::calculateBlackAreas");
   int totalpixels = 0;
 
   for (auto area : blackAreas) {
@@ -63,13 +66,6 @@ void RawImageDataU16::calculateBlackAreas() {
     if (!area.isVertical) {
       if ((int)area.offset+(int)area.size > uncropped_dim.y)
         ThrowRDE("Offset + size is larger than height of image");
-      for (uint32 y = area.offset; y < area.offset+area.size; y++) {
-        auto *pixel = (ushort16 *)getDataUncropped(mOffset.x, y);
-        auto* localhist = &histogram[(y & 1) * (65536UL * 2UL)];
-        for (int x = mOffset.x; x < dim.x+mOffset.x; x++) {
-          localhist[((x&1)<<16) + *pixel]++;
-        }
-      }
       totalpixels += area.size * dim.x;
     }
 
@@ -77,13 +73,6 @@ void RawImageDataU16::calculateBlackAreas() {
     if (area.isVertical) {
       if ((int)area.offset+(int)area.size > uncropped_dim.x)
         ThrowRDE("Offset + size is larger than width of image");
-      for (int y = mOffset.y; y < dim.y+mOffset.y; y++) {
-        auto *pixel = (ushort16 *)getDataUncropped(area.offset, y);
-        auto* localhist = &histogram[(y & 1) * (65536UL * 2UL)];
-        for (uint32 x = area.offset; x < area.size+area.offset; x++) {
-          localhist[((x&1)<<16) + *pixel]++;
-        }
-      }
       totalpixels += area.size * dim.y;
     }
   }
@@ -94,6 +83,15 @@ void RawImageDataU16::calculateBlackAreas() {
     return;
   }
 
+  mBlackHistogram.assign(4 * 65536, 0);
+  // Each thread needs its own 1MB histogram, only worth it for large areas
+  if (totalpixels >= (1 << 20))
+    startWorker(RawImageWorker::HISTOGRAM_BLACK_AREAS, false);
+  else
+    histogramBlackAreas(0, uncropped_dim.y);
+  vector<uint32> histogram;
+  histogram.swap(mBlackHistogram);
+
   /* Calculate median value of black areas for each component */
   /* Adjust the number of total pixels so it is the same as the median of each histogram */
   totalpixels /= 4*2;
@@ -119,20 +117,120 @@ void RawImageDataU16::calculateBlackAreas() {
   }
 }
 
-void RawImageDataU16::scaleBlackWhite() {
-  const int skipBorder = 250;
-  int gw = (dim.x - skipBorder) * cpp;
-  if ((blackAreas.empty() && blackLevelSeparate[0] < 0 && blackLevel < 0) || whitePoint >= 65536) {  // Estimate
-    int b = 65536;
-    int m = 0;
-    for (int row = skipBorder; row < (dim.y - skipBorder);row++) {
-      auto *pixel = (ushort16 *)getData(skipBorder, row);
-      for (int col = skipBorder ; col < gw ; col++) {
-        b = min((int)*pixel, b);
-        m = max((int)*pixel, m);
-        pixel++;
+// Adds a row of pixels, starting at (uncropped) column x, to the histograms
+// of a row phase. The channel only depends on the column phase, so instead
+// of computing it per pixel, the pixels are taken in pairs.
+static inline void histogramRow(uint32* hist, const ushort16* pixel, int x,
+                                int width) {
+  uint32* first = &hist[(x & 1) << 16];
+  uint32* second = &hist[((x + 1) & 1) << 16];
+  int i = 0;
+  for (; i + 2 <= width; i += 2) {
+    first[pixel[i]]++;
+    second[pixel[i + 1]]++;
+  }
+  if (i < width)
+    first[pixel[i]]++;
+}
+
+void RawImageDataU16::histogramBlackAreas(int start_y, int end_y) {
+  vector<uint32> histogram;
+
+  for (auto area : blackAreas) {
+    area.size = area.size - (area.size&1);
+
+    int top, bottom, left, width;
+    if (!area.isVertical) {
+      top = area.offset;
+      bottom = area.offset + area.size;
+      left = mOffset.x;
+      width = dim.x;
+    } else {
+      top = mOffset.y;
+      bottom = mOffset.y + dim.y;
+      left = area.offset;
+      width = area.size;
+    }
+    top = max(top, start_y);
+    bottom = min(bottom, end_y);
+    if (top >= bottom || width <= 0)
+      continue;
+
+    if (histogram.empty())
+      histogram.resize(4 * 65536);
+
+    for (int y = top; y < bottom; y++) {
+      auto* pixel = (ushort16*)getDataUncropped(left, y);
+      histogramRow(&histogram[(y & 1) * (65536UL * 2UL)], pixel, left, width);
+    }
+  }
+
+  if (histogram.empty())
+    return;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&mymutex);
+#endif
+  for (size_t i = 0; i < histogram.size(); i++)
+    mBlackHistogram[i] += histogram[i];
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&mymutex);
+#endif
+}
+
+void RawImageDataU16::findMinMax(int start_y, int end_y) {
+  const int gw = (dim.x - skipBorder) * cpp;
+  const int count = gw - skipBorder;
+  int b = 65536;
+  int m = 0;
+  if (count > 0) {
+    for (int row = max(start_y, skipBorder);
+         row < min(end_y, dim.y - skipBorder); row++) {
+      auto* pixel = (ushort16*)getData(skipBorder, row);
+      int col = 0;
+#if _MSC_VER > 1399 || defined(__SSE2__)
+      // SSE2 only has signed 16 bit min/max, so flip the sign bit around it
+      const __m128i sign = _mm_set1_epi16((short)0x8000);
+      __m128i vmin = _mm_set1_epi16(0x7fff);
+      __m128i vmax = _mm_set1_epi16((short)0x8000);
+      for (; col + 8 <= count; col += 8) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((__m128i*)&pixel[col]), sign);
+        vmin = _mm_min_epi16(vmin, v);
+        vmax = _mm_max_epi16(vmax, v);
+      }
+      ushort16 mins[8], maxs[8];
+      _mm_storeu_si128((__m128i*)mins, _mm_xor_si128(vmin, sign));
+      _mm_storeu_si128((__m128i*)maxs, _mm_xor_si128(vmax, sign));
+      for (int i = 0; i < 8; i++) {
+        b = min((int)mins[i], b);
+        m = max((int)maxs[i], m);
+      }
+#endif
+      for (; col < count; col++) {
+        b = min((int)pixel[col], b);
+        m = max((int)pixel[col], m);
       }
     }
+  }
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&mymutex);
+#endif
+  mMinValue = min(mMinValue, b);
+  mMaxValue = max(mMaxValue, m);
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&mymutex);
+#endif
+}
+
+void RawImageDataU16::scaleBlackWhite() {
+  TraceScope trace("RawImageData::scaleBlackWhite");
+  if ((blackAreas.empty() && blackLevelSeparate[0] < 0 && blackLevel < 0) || whitePoint >= 65536) {  // Estimate
+    mMinValue = 65536;
+    mMaxValue = 0;
+    startWorker(RawImageWorker::FIND_MIN_MAX, true);
+    int b = mMinValue;
+    int m = mMaxValue;
     if (blackLevel < 0)
       blackLevel = b;
     if (whitePoint >= 65536)
@@ -150,6 +248,7 @@ void RawImageDataU16::scaleBlackWhite() {
   if (blackLevelSeparate[0] < 0)
     calculateBlackAreas();
 
+  trace.setPixels(dim.area());
   startWorker(RawImageWorker::SCALE_VALUES, true);
 }
 
@@ -0,0 +1,71 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#include "common/RowBinner.h"
+#include "common/Memory.h"                // for alignedFree, alignedMallo...
+#include "common/Point.h"                 // for iPoint2D
+#include "decoders/RawDecoderException.h" // for ThrowRDE
+#include <cstring>                        // for memset
+
+namespace RawSpeed {
+
+RowBinner::RowBinner(const RawImage& img_)
+    : img(img_), block(img->getBinningBlock()),
+      blocks(img->getUnbinnedDim().y / block) {
+  if (img->getBinning() == 1)
+    return;
+
+  const iPoint2D full = img->getUnbinnedDim();
+  stripPitch = roundUp((size_t)full.x * img->getBpp(), 16);
+  strip = (uchar8*)alignedMallocArray<16>(block, stripPitch);
+  if (!strip)
+    ThrowRDE("Memory Allocation failed.");
+  // Never bin uninitialized memory, should the decoder leave rows out
+  memset(strip, 0, (size_t)block * stripPitch);
+}
+
+RowBinner::~RowBinner() { alignedFree(strip); }
+
+void RowBinner::binBlock() {
+  if (current < 0 || current >= blocks)
+    return;
+
+  const uint32 perBlock = block / img->getBinning();
+  img->binRows(strip, stripPitch, current * perBlock, perBlock);
+}
+
+uchar8* RowBinner::getRow(int y) {
+  if (!strip)
+    return img->getDataUncropped(0, y);
+
+  if (y < 0 || y >= img->getUnbinnedDim().y)
+    ThrowRDE("Row %i is outside of the image", y);
+  if (y / block != current) {
+    binBlock();
+    current = y / block;
+  }
+  return &strip[(size_t)(y % block) * stripPitch];
+}
+
+void RowBinner::finish() {
+  binBlock();
+  current = -1;
+}
+
+} // namespace RawSpeed
@@ -0,0 +1,59 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "common/Common.h"   // for uchar8, uint32
+#include "common/RawImage.h" // for RawImage
+
+namespace RawSpeed {
+
+// Where a decoder writes the rows it produces. For an image binned while
+// decoding (see RawImageData::setBinning()) the full resolution rows are
+// collected in a strip of one block of rows, which is binned into the image
+// once the decoder moves on to the next block, so the full resolution image
+// is never held in memory. Otherwise the rows go straight into the image.
+//
+// The rows have to be produced block by block, so decoder threads each need
+// their own RowBinner, for rows of whole blocks (see RawDecoder::startThreads).
+class RowBinner final {
+  RawImage img;
+  uchar8* strip = nullptr;
+  uint32 stripPitch = 0;
+  int block;  // rows per block
+  int blocks; // whole blocks, the rows below them are dropped
+  int current = -1;
+
+  void binBlock();
+
+public:
+  explicit RowBinner(const RawImage& img_);
+  ~RowBinner();
+  RowBinner(const RowBinner&) = delete;
+  RowBinner& operator=(const RowBinner&) = delete;
+
+  // Row y (uncropped, full resolution) for the decoder to fill. It stays
+  // valid until a row of another block is asked for.
+  uchar8* getRow(int y);
+
+  // Bins the last block. The blocks before are binned by getRow().
+  void finish();
+};
+
+} // namespace RawSpeed
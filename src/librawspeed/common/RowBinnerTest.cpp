@@ -0,0 +1,133 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#include "common/RowBinner.h"          // for RowBinner
+#include "common/Common.h"             // for ushort16, uint32
+#include "common/Point.h"              // for iPoint2D, iRectangle2D
+#include "common/RawImage.h"           // for RawImage, RawImageData
+#include "metadata/BlackArea.h"        // for BlackArea
+#include "metadata/ColorFilterArray.h" // for ColorFilterArray, CFAColor
+#include <cstring>                     // for memcpy
+#include <gtest/gtest.h>               // for Test, EXPECT_EQ, TEST, ASSERT_EQ
+#include <vector>                      // for vector
+
+using namespace std;
+using namespace RawSpeed;
+
+static RawImage createBinned(const iPoint2D& dim, uint32 factor) {
+  RawImage img = RawImage::create();
+  img->dim = dim;
+  img->setBinning(factor);
+  img->createData();
+  return img;
+}
+
+// Binning while decoding gives the same image as binning afterwards
+TEST(RowBinnerTest, SameAsBin) {
+  for (uint32 factor : {2U, 4U}) {
+    const iPoint2D dim(37, 29); // not whole blocks
+    RawImage full = RawImage::create(dim);
+    for (int y = 0; y < dim.y; y++) {
+      auto* row = (ushort16*)full->getData(0, y);
+      for (int x = 0; x < dim.x; x++)
+        row[x] = (x * 131 + y * 977) & 0xfff;
+    }
+
+    RawImage binned = createBinned(dim, factor);
+    {
+      RowBinner rows(binned);
+      for (int y = 0; y < dim.y; y++)
+        memcpy(rows.getRow(y), full->getData(0, y), dim.x * sizeof(ushort16));
+      rows.finish();
+    }
+
+    full->cfa.setCFA(iPoint2D(2, 2), CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE);
+    full->bin(factor);
+
+    ASSERT_EQ(full->dim, binned->dim);
+    for (int y = 0; y < full->dim.y; y++) {
+      const auto* expected = (const ushort16*)full->getData(0, y);
+      const auto* actual = (const ushort16*)binned->getData(0, y);
+      for (int x = 0; x < full->dim.x; x++)
+        ASSERT_EQ(expected[x], actual[x]) << "at " << x << ", " << y;
+    }
+  }
+}
+
+// Crops are given in full resolution coordinates, only whole blocks inside
+// of them are kept. Black areas keep every block they touch.
+TEST(RowBinnerTest, Crop) {
+  RawImage img = createBinned(iPoint2D(64, 48), 2);
+  EXPECT_EQ(iPoint2D(32, 24), img->dim);
+  EXPECT_EQ(iPoint2D(64, 48), img->getUnbinnedDim());
+  EXPECT_EQ(4U, img->getBinningBlock());
+
+  img->subFrame(iRectangle2D(3, 4, 56, 40));
+  EXPECT_EQ(iPoint2D(3, 4), img->getFullCrop().pos);
+  EXPECT_EQ(iPoint2D(56, 40), img->getFullCrop().dim);
+  // x from block 1 (pixel 4) to block 14, y from block 1 to block 11
+  EXPECT_EQ(iPoint2D(2, 2), img->getCropOffset());
+  EXPECT_EQ(iPoint2D(26, 20), img->dim);
+
+  img->cfa.setCFA(iPoint2D(2, 2), CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE);
+  img->blackAreas.emplace_back(0, 3, true);
+  img->blackAreas.emplace_back(1, 8, false);
+  img->applyWindow();
+
+  // The crop started at an odd column, the binned crop at an even one
+  EXPECT_EQ(CFA_GREEN, img->cfa.getColorAt(0, 0));
+  EXPECT_EQ(CFA_RED, img->cfa.getColorAt(1, 0));
+
+  ASSERT_EQ(2U, img->blackAreas.size());
+  EXPECT_EQ(0U, img->blackAreas[0].offset);
+  EXPECT_EQ(2U, img->blackAreas[0].size);
+  EXPECT_TRUE(img->blackAreas[0].isVertical);
+  EXPECT_EQ(0U, img->blackAreas[1].offset);
+  EXPECT_EQ(6U, img->blackAreas[1].size);
+  EXPECT_FALSE(img->blackAreas[1].isVertical);
+
+  // Later crops are in binned coordinates
+  EXPECT_EQ(iPoint2D(2, 2), img->getFullCrop().pos);
+  EXPECT_EQ(iPoint2D(26, 20), img->getFullCrop().dim);
+}
+
+// A black area narrower than a block still gives the black levels
+TEST(RowBinnerTest, NarrowBlackArea) {
+  const iPoint2D dim(64, 48);
+  RawImage img = createBinned(dim, 2);
+  {
+    RowBinner rows(img);
+    for (int y = 0; y < dim.y; y++) {
+      auto* row = (ushort16*)rows.getRow(y);
+      for (int x = 0; x < dim.x; x++)
+        row[x] = x < 8 ? 100 + (x & 1) + 2 * (y & 1) : 4000;
+    }
+    rows.finish();
+  }
+
+  img->subFrame(iRectangle2D(8, 0, 56, 48));
+  img->cfa.setCFA(iPoint2D(2, 2), CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE);
+  img->blackAreas.emplace_back(1, 2, true);
+  img->applyWindow();
+  ASSERT_EQ(1U, img->blackAreas.size());
+
+  img->calculateBlackAreas();
+  for (int i = 0; i < 4; i++)
+    EXPECT_EQ(100 + i, img->blackLevelSeparate[i]);
+}
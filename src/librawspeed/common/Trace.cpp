@@ -0,0 +1,147 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "rawspeedconfig.h"
+#include "common/Trace.h"
+#include <algorithm> // for min
+#include <chrono>    // for steady_clock, duration_cast, nanoseconds
+#include <cstdio>    // for snprintf
+#include <ostream>   // for operator<<, ostream, basic_ostream
+
+using namespace std;
+
+namespace RawSpeed {
+
+static TraceSink* traceSink = nullptr;
+
+void setTraceSink(TraceSink* sink) {
+  __atomic_store_n(&traceSink, sink, __ATOMIC_RELEASE);
+}
+
+#ifdef WITH_TRACING
+
+static uint32 getTraceThreadId() {
+  static uint32 lastId = 0;
+#if defined(HAVE_THREAD_LOCAL)
+  static thread_local uint32 id = 0;
+#elif defined(HAVE___THREAD)
+  static __thread uint32 id = 0;
+#else
+  // all threads share one id
+  static uint32 id = 0;
+#endif
+  if (!id)
+    id = __atomic_add_fetch(&lastId, 1, __ATOMIC_RELAXED);
+  return id;
+}
+
+void traceEvent(TraceEvent::Type type, const char* name, uint64 bytes,
+                uint64 pixels, uint32 tasks) {
+  TraceSink* sink = __atomic_load_n(&traceSink, __ATOMIC_ACQUIRE);
+  if (!sink)
+    return;
+
+  TraceEvent e;
+  e.type = type;
+  e.name = name;
+  e.time = chrono::duration_cast<chrono::nanoseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+               .count();
+  e.thread = getTraceThreadId();
+  e.bytes = bytes;
+  e.pixels = pixels;
+  e.tasks = tasks;
+  sink->event(e);
+}
+
+#endif
+
+TraceRecorder::TraceRecorder() {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init(&mutex, nullptr);
+#endif
+}
+
+TraceRecorder::~TraceRecorder() {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_destroy(&mutex);
+#endif
+}
+
+void TraceRecorder::event(const TraceEvent& e) {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&mutex);
+#endif
+  events.push_back(e);
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&mutex);
+#endif
+}
+
+vector<TraceEvent> TraceRecorder::getEvents() {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&mutex);
+#endif
+  vector<TraceEvent> copy = events;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&mutex);
+#endif
+  return copy;
+}
+
+void TraceRecorder::clear() {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&mutex);
+#endif
+  events.clear();
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&mutex);
+#endif
+}
+
+void TraceRecorder::writeChromeTrace(ostream& os) {
+  const vector<TraceEvent> all = getEvents();
+
+  // the threads append in the order they got the lock, not in time order
+  uint64 start = all.empty() ? 0 : all.front().time;
+  for (const TraceEvent& e : all)
+    start = min(start, e.time);
+
+  os << "{\"traceEvents\": [";
+  for (size_t i = 0; i < all.size(); ++i) {
+    const TraceEvent& e = all[i];
+    static const char* const phases[] = {"B", "E", "i"};
+    // in us, with ns precision
+    char ts[32];
+    snprintf(ts, sizeof(ts), "%llu.%03llu", (e.time - start) / 1000,
+             (e.time - start) % 1000);
+
+    os << (i ? "," : "") << "\n  {\"name\": \"" << e.name
+       << "\", \"cat\": \"rawspeed\", \"ph\": \"" << phases[e.type]
+       << "\", \"ts\": " << ts << ", \"pid\": 1, \"tid\": " << e.thread;
+    if (e.type == TraceEvent::END)
+      os << ", \"args\": {\"bytes\": " << e.bytes << ", \"pixels\": "
+         << e.pixels << "}";
+    else if (e.type == TraceEvent::TASKS)
+      os << ", \"s\": \"t\", \"args\": {\"tasks\": " << e.tasks << "}";
+    os << "}";
+  }
+  os << "\n], \"displayTimeUnit\": \"ms\"}\n";
+}
+
+} // namespace RawSpeed
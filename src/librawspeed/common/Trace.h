@@ -0,0 +1,132 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "rawspeedconfig.h"
+#include "common/Common.h" // for uint64, uint32
+#include <iosfwd>          // for ostream
+#include <vector>          // for vector
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h> // for pthread_mutex_t
+#endif
+
+namespace RawSpeed {
+
+// Decoding trace events. The decoders, decompressors and the post-passes of
+// RawImageData report the stages they run through to the TraceSink set with
+// setTraceSink(). Unless RawSpeed is built with WITH_TRACING, nothing is
+// reported and TraceScope and traceTasks() compile to nothing.
+
+struct TraceEvent {
+  enum Type {
+    BEGIN, // a stage starts
+    END,   // the innermost stage of the thread ends
+    TASKS, // a stage is split into tasks, e.g. one per thread
+  };
+
+  Type type;
+  const char* name; // the stage, a string literal
+  uint64 time;      // in ns, steady clock
+  uint32 thread;    // small id of the thread, counting from 1
+  uint64 bytes;     // END: the input consumed by the stage, if known
+  uint64 pixels;    // END: the pixels produced by the stage, if known
+  uint32 tasks;     // TASKS: the number of tasks
+};
+
+class TraceSink {
+public:
+  virtual ~TraceSink() = default;
+
+  // Called from all the decoding threads, concurrently.
+  virtual void event(const TraceEvent& e) = 0;
+};
+
+// Keeps all the events, to write them out as Chrome trace-event JSON, which
+// chrome://tracing and the Perfetto UI both open.
+class TraceRecorder final : public TraceSink {
+  std::vector<TraceEvent> events;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t mutex;
+#endif
+
+public:
+  TraceRecorder();
+  ~TraceRecorder() override;
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  void event(const TraceEvent& e) override;
+
+  std::vector<TraceEvent> getEvents();
+  void clear();
+
+  // Stages become duration events, with the bytes and pixels as arguments,
+  // tasks become instant events. Times are relative to the first event.
+  void writeChromeTrace(std::ostream& os);
+};
+
+// The sink is not owned, nullptr (the default) stops tracing. Do not change
+// it while a decode is running.
+void setTraceSink(TraceSink* sink);
+
+#ifdef WITH_TRACING
+
+void traceEvent(TraceEvent::Type type, const char* name, uint64 bytes = 0,
+                uint64 pixels = 0, uint32 tasks = 0);
+
+// Reports the stage 'name' from construction to destruction.
+class TraceScope final {
+  const char* name;
+  uint64 bytes = 0;
+  uint64 pixels = 0;
+
+public:
+  explicit TraceScope(const char* name_) : name(name_) {
+    traceEvent(TraceEvent::BEGIN, name);
+  }
+  ~TraceScope() { traceEvent(TraceEvent::END, name, bytes, pixels); }
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+  void setBytes(uint64 n) { bytes = n; }
+  void setPixels(uint64 n) { pixels = n; }
+};
+
+inline void traceTasks(const char* name, uint32 tasks) {
+  traceEvent(TraceEvent::TASKS, name, 0, 0, tasks);
+}
+
+#else
+
+class TraceScope final {
+public:
+  explicit TraceScope(const char* /*name*/) {}
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+  void setBytes(uint64 /*n*/) {}
+  void setPixels(uint64 /*n*/) {}
+};
+
+inline void traceTasks(const char* /*name*/, uint32 /*tasks*/) {}
+
+#endif
+
+} // namespace RawSpeed
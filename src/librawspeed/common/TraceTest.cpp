@@ -0,0 +1,83 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "rawspeedconfig.h"
+#include "common/Common.h" // for splitWork
+#include "common/Trace.h"  // for TraceRecorder, TraceScope, TraceEvent
+#include <gtest/gtest.h>   // for Test, EXPECT_EQ, TEST, ASSERT_EQ
+#include <sstream>         // for ostringstream
+#include <string>          // for string
+#include <vector>          // for vector
+
+using namespace std;
+using namespace RawSpeed;
+
+TEST(TraceTest, ChromeTrace) {
+  TraceRecorder recorder;
+  recorder.event({TraceEvent::BEGIN, "decode", 5000, 1, 0, 0, 0});
+  recorder.event({TraceEvent::TASKS, "decode", 6500, 1, 0, 0, 4});
+  recorder.event({TraceEvent::END, "decode", 9001, 1, 100, 25, 0});
+
+  ostringstream os;
+  recorder.writeChromeTrace(os);
+  EXPECT_EQ(
+      "{\"traceEvents\": [\n"
+      "  {\"name\": \"decode\", \"cat\": \"rawspeed\", \"ph\": \"B\", "
+      "\"ts\": 0.000, \"pid\": 1, \"tid\": 1},\n"
+      "  {\"name\": \"decode\", \"cat\": \"rawspeed\", \"ph\": \"i\", "
+      "\"ts\": 1.500, \"pid\": 1, \"tid\": 1, \"s\": \"t\", "
+      "\"args\": {\"tasks\": 4}},\n"
+      "  {\"name\": \"decode\", \"cat\": \"rawspeed\", \"ph\": \"E\", "
+      "\"ts\": 4.001, \"pid\": 1, \"tid\": 1, "
+      "\"args\": {\"bytes\": 100, \"pixels\": 25}}\n"
+      "], \"displayTimeUnit\": \"ms\"}\n",
+      os.str());
+
+  recorder.clear();
+  EXPECT_TRUE(recorder.getEvents().empty());
+}
+
+TEST(TraceTest, Scope) {
+  TraceRecorder recorder;
+  setTraceSink(&recorder);
+  {
+    TraceScope trace("stage");
+    trace.setBytes(10);
+    trace.setPixels(20);
+    splitWork("tasks", 100, 0, 4);
+  }
+  setTraceSink(nullptr);
+  { TraceScope trace("untraced"); }
+
+  const vector<TraceEvent> events = recorder.getEvents();
+#ifdef WITH_TRACING
+  ASSERT_EQ(3U, events.size());
+  EXPECT_EQ(TraceEvent::BEGIN, events[0].type);
+  EXPECT_EQ(string("stage"), events[0].name);
+  EXPECT_EQ(TraceEvent::TASKS, events[1].type);
+  EXPECT_EQ(string("tasks"), events[1].name);
+  EXPECT_EQ(1U, events[1].tasks);
+  EXPECT_EQ(TraceEvent::END, events[2].type);
+  EXPECT_EQ(10U, events[2].bytes);
+  EXPECT_EQ(20U, events[2].pixels);
+  EXPECT_LE(events[0].time, events[2].time);
+  EXPECT_EQ(events[0].thread, events[2].thread);
+#else
+  EXPECT_TRUE(events.empty());
+#endif
+}
@@ -21,6 +21,7 @@
 #include "decoders/AriDecoder.h"
 #include "common/Common.h"                // for uint32, ushort16
 #include "common/Point.h"                 // for iPoint2D
+#include "common/RowBinner.h"             // for RowBinner
 #include "decoders/RawDecoderException.h" // for RawDecoderException (ptr o...
 #include "io/BitPumpMSB32.h"              // for BitPumpMSB32
 #include "io/Buffer.h"                    // for Buffer
@@ -79,9 +80,10 @@ bool AriDecoder::isARI(Buffer* input) {
 
 RawImage AriDecoder::decodeRawInternal() {
   mRaw->dim = iPoint2D(mWidth, mHeight);
-  mRaw->createData();
+  if (!createBinnedData())
+    mRaw->createData();
 
-  startThreads();
+  startThreads(3); // unpacking 12 bit values, ~3 ns per pixel
 
   mRaw->whitePoint = 4095;
   return mRaw;
@@ -91,9 +93,10 @@ void AriDecoder::decodeThreaded(RawDecoderThread * t) {
   uint32 startOff = mDataOffset + t->start_y * ((mWidth * 12) / 8);
   BitPumpMSB32 bits(mFile, startOff);
 
+  RowBinner rows(mRaw);
   uint32 hw = mWidth >> 1;
   for (uint32 y = t->start_y; y < t->end_y; y++) {
-    auto *dest = (ushort16 *)mRaw->getData(0, y);
+    auto *dest = (ushort16 *)rows.getRow(y);
     for (uint32 x = 0 ; x < hw; x++) {
       uint32 a = bits.getBits(12);
       uint32 b = bits.getBits(12);
@@ -101,6 +104,7 @@ void AriDecoder::decodeThreaded(RawDecoderThread * t) {
       dest[x*2+1] = a;
     }
   }
+  rows.finish();
 }
 void AriDecoder::checkSupportInternal(const CameraMetaData* meta) {
   if (meta->hasCamera("ARRI", mModel, mEncoder)) {
@@ -22,6 +22,7 @@
 #include "decoders/ArwDecoder.h"
 #include "common/Common.h"                          // for uint32, uchar8
 #include "common/Point.h"                           // for iPoint2D
+#include "common/RowBinner.h"                       // for RowBinner
 #include "decoders/RawDecoder.h"                    // for RawDecoderThread
 #include "decoders/RawDecoderException.h"           // for RawDecoderExcept...
 #include "decompressors/HuffmanTable.h"             // for HuffmanTable
@@ -48,8 +49,8 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage ArwDecoder::decodeRawInternal() {
-  const TiffIFD* raw = nullptr;
+ArwDecoder::ArwType ArwDecoder::setUpImage(const TiffIFD** rawIFD,
+                                           uint32* bitPerPixel) {
   vector<const TiffIFD*> data = mRootIFD->getIFDsWithTag(STRIPOFFSETS);
 
   if (data.empty()) {
@@ -59,80 +60,33 @@ RawImage ArwDecoder::decodeRawInternal() {
       // We've caught the elusive A100 in the wild, a transitional format
       // between the simple sanity of the MRW custom format and the wordly
       // wonderfullness of the Tiff-based ARW format, let's shoot from the hip
-      raw = mRootIFD->getIFDWithTag(SUBIFDS);
-      uint32 off = raw->getEntry(SUBIFDS)->getU32();
-      uint32 width = 3881;
-      uint32 height = 2608;
-
-      mRaw->dim = iPoint2D(width, height);
-      mRaw->createData();
-      ByteStream input(mFile, off);
-
-      try {
-        DecodeARW(input, width, height);
-      } catch (IOException &e) {
-        mRaw->setError(e.what());
-        // Let's ignore it, it may have delivered somewhat useful data.
-      }
-
-      return mRaw;
+      *rawIFD = mRootIFD->getIFDWithTag(SUBIFDS);
+      mRaw->dim = iPoint2D(3881, 2608);
+      return ARW_A100;
     }
 
-    if (hints.has("srf_format")) {
-      raw = mRootIFD->getIFDWithTag(IMAGEWIDTH);
-
-      uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
-      uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
-      uint32 len = width*height*2;
-
-      // Constants taken from dcraw
-      uint32 off = 862144;
-      uint32 key_off = 200896;
-      uint32 head_off = 164600;
-
-      // Replicate the dcraw contortions to get the "decryption" key
-      const uchar8 *keyData = mFile->getData(key_off, 1);
-      uint32 offset = (*keyData) * 4;
-      keyData = mFile->getData(key_off + offset, 4);
-      uint32 key = getU32BE(keyData);
-      static const size_t head_size = 40;
-      const uchar8* head_orig = mFile->getData(head_off, head_size);
-      vector<uchar8> head(head_size);
-      SonyDecrypt((uint32*)head_orig, (uint32*)&head[0], 10, key);
-      for (int i=26; i-- > 22; )
-        key = key << 8 | head[i];
-
-      // "Decrypt" the whole image buffer
-      auto image_data = mFile->getData(off, len);
-      auto image_decoded = Buffer::Create(len);
-      SonyDecrypt((uint32*)image_data, (uint32*)image_decoded.get(), len / 4,
-                  key);
-
-      Buffer di(move(image_decoded), len);
-
-      // And now decode as a normal 16bit raw
-      mRaw->dim = iPoint2D(width, height);
-      mRaw->createData();
+    if (hints.has(HINT_SRF_FORMAT)) {
+      *rawIFD = mRootIFD->getIFDWithTag(IMAGEWIDTH);
 
-      UncompressedDecompressor u(di, 0, len, mRaw, uncorrectedRawValues);
-      u.decode16BitRawBEunpacked(width, height);
+      uint32 width = (*rawIFD)->getEntry(IMAGEWIDTH)->getU32();
+      uint32 height = (*rawIFD)->getEntry(IMAGELENGTH)->getU32();
 
-      return mRaw;
+      mRaw->dim = iPoint2D(width, height);
+      return ARW_SRF;
     }
 
     ThrowRDE("No image data found");
   }
 
-  raw = data[0];
+  const TiffIFD* raw = data[0];
+  *rawIFD = raw;
+  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
+  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
+
   int compression = raw->getEntry(COMPRESSION)->getU32();
   if (1 == compression) {
-    try {
-      DecodeUncompressed(raw);
-    } catch (IOException &e) {
-      mRaw->setError(e.what());
-    }
-
-    return mRaw;
+    mRaw->dim = iPoint2D(width, height);
+    return ARW_UNCOMPRESSED;
   }
 
   if (32767 != compression)
@@ -149,9 +103,7 @@ RawImage ArwDecoder::decodeRawInternal() {
         "Byte count number does not match strip size: count:%u, strips:%u ",
         counts->count, offsets->count);
   }
-  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
-  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
-  uint32 bitPerPixel = raw->getEntry(BITSPERSAMPLE)->getU32();
+  *bitPerPixel = raw->getEntry(BITSPERSAMPLE)->getU32();
 
   // Sony E-550 marks compressed 8bpp ARW with 12 bit per pixel
   // this makes the compression detect it as a ARW v1.
@@ -163,16 +115,105 @@ RawImage ArwDecoder::decodeRawInternal() {
       string make = i->getEntry(MAKE)->getString();
       /* Check for maker "SONY" without spaces */
       if (make == "SONY")
-        bitPerPixel = 8;
+        *bitPerPixel = 8;
     }
   }
 
-  bool arw1 = counts->getU32() * 8 != width * height * bitPerPixel;
-  if (arw1)
-    height += 8;
+  if (counts->getU32() * 8 != width * height * *bitPerPixel) {
+    mRaw->dim = iPoint2D(width, height + 8);
+    return ARW_1;
+  }
 
   mRaw->dim = iPoint2D(width, height);
-  mRaw->createData();
+  return ARW_2;
+}
+
+RawImage ArwDecoder::decodeRawInternal() {
+  const TiffIFD* raw = nullptr;
+  uint32 bitPerPixel = 0;
+  const ArwType type = setUpImage(&raw, &bitPerPixel);
+  uint32 width = mRaw->dim.x;
+  uint32 height = mRaw->dim.y;
+
+  if (type == ARW_A100) {
+    uint32 off = raw->getEntry(SUBIFDS)->getU32();
+
+    mRaw->createData();
+    ByteStream input(mFile, off);
+
+    try {
+      DecodeARW(input, width, height);
+    } catch (IOException &e) {
+      mRaw->setError(e.what());
+      // Let's ignore it, it may have delivered somewhat useful data.
+    }
+
+    return mRaw;
+  }
+
+  if (type == ARW_SRF) {
+    uint32 len = width*height*2;
+
+    // Constants taken from dcraw
+    uint32 off = 862144;
+    uint32 key_off = 200896;
+    uint32 head_off = 164600;
+
+    // Replicate the dcraw contortions to get the "decryption" key
+    const uchar8 *keyData = mFile->getData(key_off, 1);
+    uint32 offset = (*keyData) * 4;
+    keyData = mFile->getData(key_off + offset, 4);
+    uint32 key = getU32BE(keyData);
+    static const size_t head_size = 40;
+    const uchar8* head_orig = mFile->getData(head_off, head_size);
+    vector<uchar8> head(head_size);
+    SonyDecrypt((uint32*)head_orig, (uint32*)&head[0], 10, key);
+    for (int i=26; i-- > 22; )
+      key = key << 8 | head[i];
+
+    // "Decrypt" the whole image buffer
+    auto image_data = mFile->getData(off, len);
+    auto image_decoded = Buffer::Create(len);
+    SonyDecrypt((uint32*)image_data, (uint32*)image_decoded.get(), len / 4,
+                key);
+
+    Buffer di(move(image_decoded), len);
+
+    // And now decode as a normal 16bit raw
+    mRaw->createData();
+
+    UncompressedDecompressor u(di, 0, len, mRaw, uncorrectedRawValues);
+    u.decode16BitRawBEunpacked(width, height);
+
+    return mRaw;
+  }
+
+  if (type == ARW_UNCOMPRESSED) {
+    try {
+      DecodeUncompressed(raw);
+    } catch (IOException &e) {
+      mRaw->setError(e.what());
+    }
+
+    return mRaw;
+  }
+
+  TiffEntry *offsets = raw->getEntry(STRIPOFFSETS);
+  TiffEntry *counts = raw->getEntry(STRIPBYTECOUNTS);
+
+  bool arw1 = type == ARW_1;
+  if (arw1) {
+    mRaw->createData();
+  } else {
+    // Rows can be decoded on their own, 8 bit data in groups of 32 pixels
+    mWidth = width;
+    // 8 bit data is decoded through a RowBinner (see decodeThreaded())
+    if (bitPerPixel == 8 && createBinnedData())
+      mWindow = iRectangle2D(0, 0, width, height);
+    else
+      mWindow = createWindow(iPoint2D(width, height),
+                             iPoint2D(bitPerPixel == 8 ? 32 : 2, 1));
+  }
 
   auto *curve = new ushort16[0x4001];
   TiffEntry *c = raw->getEntry(SONY_CURVE);
@@ -224,18 +265,24 @@ RawImage ArwDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void ArwDecoder::probeRawInternal() {
+  const TiffIFD* raw = nullptr;
+  uint32 bitPerPixel = 0;
+  setUpImage(&raw, &bitPerPixel);
+  mRaw->createWithoutData();
+}
+
 void ArwDecoder::DecodeUncompressed(const TiffIFD* raw) {
-  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
-  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
   uint32 off = raw->getEntry(STRIPOFFSETS)->getU32();
   uint32 c2 = raw->getEntry(STRIPBYTECOUNTS)->getU32();
 
-  mRaw->dim = iPoint2D(width, height);
   mRaw->createData();
 
   UncompressedDecompressor u(*mFile, off, c2, mRaw, uncorrectedRawValues);
 
-  if (hints.has("sr2_format"))
+  if (hints.has(HINT_SR2_FORMAT))
     u.decode14BitRawBEunpacked(width, height);
   else
     u.decode16BitRawUnpacked(width, height);
@@ -271,7 +318,7 @@ void ArwDecoder::DecodeARW2(ByteStream &input, uint32 w, uint32 h, uint32 bpp) {
 
   if (bpp == 8) {
     in = input;
-    this->startThreads();
+    this->startThreads(5); // 8 bit delta blocks, ~5 ns per pixel
     return;
   } // End bpp = 8
 
@@ -284,11 +331,15 @@ void ArwDecoder::DecodeARW2(ByteStream &input, uint32 w, uint32 h, uint32 bpp) {
 
     uchar8 *outData = mRaw->getData();
     uint32 pitch = mRaw->pitch;
-    const uchar8 *inData = input.getData(input.getRemainSize());
-
-    for (uint32 y = 0; y < h; y++) {
-      auto *dest = (ushort16 *)&outData[y * pitch];
-      for (uint32 x = 0 ; x < w; x += 2) {
+    const uchar8 *input_start = input.getData(input.getRemainSize());
+    const uint32 x0 = mWindow.pos.x;
+    const uint32 x1 = mWindow.getBottomRight().x;
+    h = min(h, (uint32)mWindow.getBottomRight().y);
+
+    for (uint32 y = mWindow.pos.y; y < h; y++) {
+      auto *dest = (ushort16 *)&outData[(y - mWindow.pos.y) * pitch];
+      const uchar8 *inData = &input_start[(y * w + x0) * 3 / 2];
+      for (uint32 x = 0; x < x1 - x0; x += 2) {
         uint32 g1 = *inData++;
         uint32 g2 = *inData++;
         dest[x] = (g1 | ((g2 & 0xf) << 8));
@@ -447,19 +498,19 @@ void ArwDecoder::GetWB() {
 /* Since ARW2 compressed images have predictable offsets, we decode them threaded */
 
 void ArwDecoder::decodeThreaded(RawDecoderThread * t) {
-  uchar8* data = mRaw->getData();
-  uint32 pitch = mRaw->pitch;
-  int32 w = mRaw->dim.x;
+  const int32 x0 = mWindow.pos.x;
+  const int32 x1 = mWindow.getBottomRight().x;
 
+  RowBinner rows(mRaw);
   BitPumpPlain bits(in);
   for (uint32 y = t->start_y; y < t->end_y; y++) {
-    auto *dest = (ushort16 *)&data[y * pitch];
-    // Realign
-    bits.setBufferPosition(w*y);
+    auto *dest = (ushort16 *)rows.getRow(y);
+    // Realign, each group of 32 pixels takes 32 bytes
+    bits.setBufferPosition(mWidth * (y + mWindow.pos.y) + x0);
     uint32 random = bits.peekBits(24);
 
     // Process 32 pixels (16x2) per loop.
-    for (int32 x = 0; x < w - 30;) {
+    for (int32 x = x0; x < x1 - 30;) {
       int _max = bits.getBits(11);
       int _min = bits.getBits(11);
       int _imax = bits.getBits(4);
@@ -479,11 +530,12 @@ void ArwDecoder::decodeThreaded(RawDecoderThread * t) {
               p = 0x7ff;
           }
         }
-        mRaw->setWithLookUp(p << 1, (uchar8*)&dest[x+i*2], &random);
+        mRaw->setWithLookUp(p << 1, (uchar8*)&dest[x-x0+i*2], &random);
       }
       x += x & 1 ? 31 : 1;  // Skip to next 32 pixels
     }
   }
+  rows.finish();
 }
 
 } // namespace RawSpeed
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "common/Common.h"                // for uint32
+#include "common/Point.h"                 // for iRectangle2D
 #include "common/RawImage.h"              // for RawImage
 #include "decoders/AbstractTiffDecoder.h" // for AbstractTiffDecoder
 #include "io/ByteStream.h"                // for ByteStream
@@ -45,11 +46,17 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   void decodeThreaded(RawDecoderThread *t) override;
 
 protected:
   int getDecoderVersion() const override { return 1; }
+  // How the raw data of an ARW is stored
+  enum ArwType { ARW_A100, ARW_SRF, ARW_UNCOMPRESSED, ARW_1, ARW_2 };
+  // Checks the headers and sets the image size. Returns the raw IFD, and
+  // the bits per pixel of compressed data.
+  ArwType setUpImage(const TiffIFD** rawIFD, uint32* bitPerPixel);
   void DecodeARW(ByteStream &input, uint32 w, uint32 h);
   void DecodeARW2(ByteStream &input, uint32 w, uint32 h, uint32 bpp);
   void DecodeUncompressed(const TiffIFD* raw);
@@ -58,6 +65,8 @@ protected:
   void GetWB();
   ByteStream in;
   int mShiftDownScale = 0;
+  iRectangle2D mWindow; // Part of the ARW2 image that is decoded
+  uint32 mWidth = 0;    // Width of the whole ARW2 image
 };
 
 } // namespace RawSpeed
@@ -43,7 +43,7 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage Cr2Decoder::decodeOldFormat() {
+uint32 Cr2Decoder::setUpOldFormat() {
   uint32 offset = 0;
   if (mRootIFD->getEntryRecursive(CANON_RAW_DATA_OFFSET))
     offset = mRootIFD->getEntryRecursive(CANON_RAW_DATA_OFFSET)->getU32();
@@ -68,11 +68,17 @@ RawImage Cr2Decoder::decodeOldFormat() {
   }
   width *= 2; // components
 
-  mRaw = RawImage::create({width, height});
+  mRaw->dim = iPoint2D(width, height);
+  return offset;
+}
+
+RawImage Cr2Decoder::decodeOldFormat() {
+  const uint32 offset = setUpOldFormat();
+  mRaw->createData();
 
   Cr2Decompressor l(*mFile, offset, mRaw);
   try {
-    l.decode({width});
+    l.decode({mRaw->dim.x});
   } catch (IOException& e) {
     mRaw->setError(e.what());
   }
@@ -98,7 +104,7 @@ RawImage Cr2Decoder::decodeOldFormat() {
 
 // for technical details about Cr2 mRAW/sRAW, see http://lclevy.free.fr/cr2/
 
-RawImage Cr2Decoder::decodeNewFormat() {
+const TiffIFD* Cr2Decoder::setUpNewFormat() {
   TiffEntry* sensorInfoE = mRootIFD->getEntryRecursive(CANON_SENSOR_INFO);
   if (!sensorInfoE)
     ThrowTPE("failed to get SensorInfo from MakerNote");
@@ -110,7 +116,15 @@ RawImage Cr2Decoder::decodeNewFormat() {
       raw->getEntry(CANON_SRAWTYPE)->getU32() == 4)
     componentsPerPixel = 3;
 
-  mRaw = RawImage::create(dim, TYPE_USHORT16, componentsPerPixel);
+  mRaw->dim = dim;
+  mRaw->setCpp(componentsPerPixel);
+  mRaw->isCFA = componentsPerPixel == 1;
+  return raw;
+}
+
+RawImage Cr2Decoder::decodeNewFormat() {
+  const TiffIFD* raw = setUpNewFormat();
+  mRaw->createData();
 
   vector<int> s_width;
   TiffEntry* cr2SliceEntry = raw->getEntryRecursive(CANONCR2SLICE);
@@ -147,6 +161,23 @@ RawImage Cr2Decoder::decodeRawInternal() {
     return decodeNewFormat();
 }
 
+void Cr2Decoder::probeRawInternal() {
+  if (mRootIFD->getSubIFDs().size() < 4) {
+    setUpOldFormat();
+    mRaw->createWithoutData();
+    return;
+  }
+
+  const TiffIFD* raw = setUpNewFormat();
+  mRaw->createWithoutData();
+
+  // sRaw images are told apart by the subsampling in the frame header
+  TiffEntry* offsets = raw->getEntry(STRIPOFFSETS);
+  TiffEntry* counts = raw->getEntry(STRIPBYTECOUNTS);
+  Cr2Decompressor d(*mFile, offsets->getU32(), counts->getU32(), mRaw);
+  d.parseFrameHeader();
+}
+
 void Cr2Decoder::checkSupportInternal(const CameraMetaData* meta) {
   auto id = mRootIFD->getID();
   // Check for sRaw mode
@@ -182,7 +213,7 @@ void Cr2Decoder::decodeMetaDataInternal(const CameraMetaData* meta) {
       TiffEntry *wb = mRootIFD->getEntryRecursive(CANONCOLORDATA);
       // this entry is a big table, and different cameras store used WB in
       // different parts, so find the offset, default is the most common one
-      int offset = hints.get("wb_offset", 126);
+      int offset = hints.get(HINT_WB_OFFSET, 126);
 
       offset /= 2;
       mRaw->metadata.wbCoeffs[0] = (float) wb->getU16(offset + 0);
@@ -219,14 +250,14 @@ void Cr2Decoder::decodeMetaDataInternal(const CameraMetaData* meta) {
 }
 
 int Cr2Decoder::getHue() {
-  if (hints.has("old_sraw_hue"))
+  if (hints.has(HINT_OLD_SRAW_HUE))
     return (mRaw->metadata.subsampling.y * mRaw->metadata.subsampling.x);
 
   if (!mRootIFD->hasEntryRecursive((TiffTag)0x10)) {
     return 0;
   }
   uint32 model_id = mRootIFD->getEntryRecursive((TiffTag)0x10)->getU32();
-  if (model_id >= 0x80000281 || model_id == 0x80000218 || (hints.has("force_new_sraw_hue")))
+  if (model_id >= 0x80000281 || model_id == 0x80000218 || (hints.has(HINT_FORCE_NEW_SRAW_HUE)))
     return ((mRaw->metadata.subsampling.y * mRaw->metadata.subsampling.x) - 1) >> 1;
 
   return (mRaw->metadata.subsampling.y * mRaw->metadata.subsampling.x);
@@ -443,14 +474,14 @@ void Cr2Decoder::sRawInterpolate() {
       (wb->getU16(offset + 1) + wb->getU16(offset + 2) + 1) >> 1;
   sraw_coeffs[2] = wb->getU16(offset + 3);
 
-  if (hints.has("invert_sraw_wb")) {
+  if (hints.has(HINT_INVERT_SRAW_WB)) {
     sraw_coeffs[0] = (int)(1024.0f / ((float)sraw_coeffs[0] / 1024.0f));
     sraw_coeffs[2] = (int)(1024.0f / ((float)sraw_coeffs[2] / 1024.0f));
   }
 
   /* Determine sRaw coefficients */
-  bool isOldSraw = hints.has("sraw_40d");
-  bool isNewSraw = hints.has("sraw_new");
+  bool isOldSraw = hints.has(HINT_SRAW_40D);
+  bool isNewSraw = hints.has(HINT_SRAW_NEW);
 
   const auto& subSampling = mRaw->metadata.subsampling;
   int width = mRaw->dim.x / subSampling.x;
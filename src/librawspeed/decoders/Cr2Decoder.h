@@ -20,9 +20,10 @@
 
 #pragma once
 
+#include "common/Common.h"                // for uint32
 #include "common/RawImage.h"              // for RawImage
 #include "decoders/AbstractTiffDecoder.h" // for AbstractTiffDecoder
-#include "tiff/TiffIFD.h"                 // for TiffRootIFDOwner
+#include "tiff/TiffIFD.h"                 // for TiffIFD, TiffRootIFDOwner
 #include <algorithm>                      // for move
 
 namespace RawSpeed {
@@ -40,11 +41,16 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void checkSupportInternal(const CameraMetaData* meta) override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
 
 protected:
   int getDecoderVersion() const override { return 8; }
+  // Check the headers and set the image size. The old format returns the
+  // offset of its data, the new one its raw IFD.
+  uint32 setUpOldFormat();
+  const TiffIFD* setUpNewFormat();
   RawImage decodeOldFormat();
   RawImage decodeNewFormat();
   void sRawInterpolate();
@@ -58,7 +58,7 @@ CrwDecoder::~CrwDecoder() {
   mRootIFD = nullptr;
 }
 
-RawImage CrwDecoder::decodeRawInternal() {
+uint32 CrwDecoder::setUpImage() {
   CiffEntry *sensorInfo = mRootIFD->getEntryRecursive(CIFF_SENSORINFO);
 
   if (!sensorInfo || sensorInfo->count < 6 || sensorInfo->type != CIFF_SHORT)
@@ -76,14 +76,24 @@ RawImage CrwDecoder::decodeRawInternal() {
     ThrowRDE("Unknown decoder table %d", dec_table);
 
   mRaw->dim = iPoint2D(width, height);
+  return dec_table;
+}
+
+RawImage CrwDecoder::decodeRawInternal() {
+  const uint32 dec_table = setUpImage();
   mRaw->createData();
 
-  bool lowbits = ! hints.has("no_decompressed_lowbits");
-  decodeRaw(lowbits, dec_table, width, height);
+  bool lowbits = ! hints.has(HINT_NO_DECOMPRESSED_LOWBITS);
+  decodeRaw(lowbits, dec_table, mRaw->dim.x, mRaw->dim.y);
 
   return mRaw;
 }
 
+void CrwDecoder::probeRawInternal() {
+  setUpImage();
+  mRaw->createWithoutData();
+}
+
 void CrwDecoder::checkSupportInternal(const CameraMetaData* meta) {
   vector<CiffIFD*> data = mRootIFD->getIFDsWithTag(CIFF_MAKEMODEL);
   if (data.empty())
@@ -148,10 +158,10 @@ void CrwDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
         mRaw->metadata.wbCoeffs[2] = (float) (1024.0 /wb->getByte(75));
       } else if (wb->type == CIFF_BYTE && wb->count > 768) { // Other G series and S series cameras
         // correct offset for most cameras
-        int offset = hints.get("wb_offset", 120);
+        int offset = hints.get(HINT_WB_OFFSET, 120);
 
         ushort16 key[] = { 0x410, 0x45f3 };
-        if (! hints.has("wb_mangle"))
+        if (! hints.has(HINT_WB_MANGLE))
           key[0] = key[1] = 0;
 
         offset /= 2;
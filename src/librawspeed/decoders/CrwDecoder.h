@@ -37,6 +37,7 @@ class CrwDecoder final : public RawDecoder {
 public:
   CrwDecoder(CiffIFD* rootIFD, Buffer* file);
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void checkSupportInternal(const CameraMetaData* meta) override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   ~CrwDecoder() override;
@@ -44,6 +45,9 @@ public:
 protected:
   int getDecoderVersion() const override { return 0; }
   CiffIFD *mRootIFD;
+  // Checks the sensor info and sets the image size. Returns the number of
+  // the decoder table.
+  uint32 setUpImage();
   void decodeRaw(bool lowbits, uint32 dec_table, uint32 width, uint32 height);
 };
 
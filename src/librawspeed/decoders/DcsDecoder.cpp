@@ -37,21 +37,27 @@ namespace RawSpeed {
 
 class CameraMetaData;
 
-RawImage DcsDecoder::decodeRawInternal() {
+uint32 DcsDecoder::setUpImage(uint32* count) {
   auto raw = getIFDWithLargestImage();
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
   uint32 off = raw->getEntry(STRIPOFFSETS)->getU32();
-  uint32 c2 = raw->getEntry(STRIPBYTECOUNTS)->getU32();
+  *count = raw->getEntry(STRIPBYTECOUNTS)->getU32();
 
   if (off > mFile->getSize())
     ThrowRDE("Offset is out of bounds");
 
-  if (c2 > mFile->getSize() - off) {
+  if (*count > mFile->getSize() - off) {
     mRaw->setError("Warning: byte count larger than file size, file probably truncated.");
   }
 
   mRaw->dim = iPoint2D(width, height);
+  return off;
+}
+
+RawImage DcsDecoder::decodeRawInternal() {
+  uint32 c2;
+  uint32 off = setUpImage(&c2);
   mRaw->createData();
 
   TiffEntry *linearization = mRootIFD->getEntryRecursive(GRAYRESPONSECURVE);
@@ -65,7 +71,7 @@ RawImage DcsDecoder::decodeRawInternal() {
 
   UncompressedDecompressor u(*mFile, off, c2, mRaw, uncorrectedRawValues);
 
-  u.decode8BitRaw(width, height);
+  u.decode8BitRaw(mRaw->dim.x, mRaw->dim.y);
 
   // Set the table, if it should be needed later.
   if (uncorrectedRawValues) {
@@ -77,6 +83,12 @@ RawImage DcsDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void DcsDecoder::probeRawInternal() {
+  uint32 c2;
+  setUpImage(&c2);
+  mRaw->createWithoutData();
+}
+
 void DcsDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   setMetaData(meta, "", 0);
 }
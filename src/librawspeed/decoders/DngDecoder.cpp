@@ -34,7 +34,7 @@
 #include "tiff/TiffEntry.h"               // for TiffEntry, TiffDataType::T...
 #include "tiff/TiffIFD.h"                 // for TiffIFD, TiffRootIFD, TiffID
 #include "tiff/TiffTag.h"                 // for TiffTag::UNIQUECAMERAMODEL
-#include <algorithm>                      // for move
+#include <algorithm>                      // for min, move
 #include <cstdio>                         // for printf
 #include <cstring>                        // for memset
 #include <map>                            // for map
@@ -174,8 +174,29 @@ void DngDecoder::parseCFA(const TiffIFD* raw) {
   }
 }
 
-void DngDecoder::decodeData(const TiffIFD* raw, int compression, uint32 sample_format) {
-  mRaw->createData();
+void DngDecoder::decodeData(const TiffIFD* raw, int compression,
+                            uint32 sample_format, uint32 scale) {
+  // Tiles and strips are always laid out in full resolution coordinates
+  const iPoint2D fullDim = mRaw->dim;
+  const bool tiled = raw->hasEntry(TILEOFFSETS);
+
+  // A region of interest is decoded in whole tiles or strips
+  iRectangle2D window(iPoint2D(0, 0), fullDim);
+  if (scale > 1) {
+    mRaw->dim = iPoint2D((fullDim.x + scale - 1) / scale,
+                         (fullDim.y + scale - 1) / scale);
+    mRaw->createData();
+  } else if (tiled) {
+    window = createWindow(fullDim,
+                          iPoint2D(raw->getEntry(TILEWIDTH)->getU32(),
+                                   raw->getEntry(TILELENGTH)->getU32()));
+  } else {
+    window = createWindow(
+        fullDim,
+        iPoint2D(fullDim.x, raw->hasEntry(ROWSPERSTRIP)
+                                ? raw->getEntry(ROWSPERSTRIP)->getU32()
+                                : fullDim.y));
+  }
 
   if (compression == 8 && sample_format != 3) {
     ThrowRDE("Only float format is supported for "
@@ -192,14 +213,15 @@ void DngDecoder::decodeData(const TiffIFD* raw, int compression, uint32 sample_f
     slices.mPredictor = predictor;
   }
   slices.mBps = raw->getEntry(BITSPERSAMPLE)->getU32();
-  if (raw->hasEntry(TILEOFFSETS)) {
+  slices.mScale = scale;
+  if (tiled) {
     uint32 tilew = raw->getEntry(TILEWIDTH)->getU32();
     uint32 tileh = raw->getEntry(TILELENGTH)->getU32();
     if (!tilew || !tileh)
       ThrowRDE("Invalid tile size");
 
-    uint32 tilesX = (mRaw->dim.x + tilew - 1) / tilew;
-    uint32 tilesY = (mRaw->dim.y + tileh - 1) / tileh;
+    uint32 tilesX = (fullDim.x + tilew - 1) / tilew;
+    uint32 tilesY = (fullDim.y + tileh - 1) / tileh;
     uint32 nTiles = tilesX * tilesY;
 
     TiffEntry* offsets = raw->getEntry(TILEOFFSETS);
@@ -212,10 +234,17 @@ void DngDecoder::decodeData(const TiffIFD* raw, int compression, uint32 sample_f
 
     slices.mFixLjpeg = mFixLjpeg;
 
+    const vector<uint32> tileOffsets = offsets->getU32Array(nTiles);
+    const vector<uint32> tileCounts = counts->getU32Array(nTiles);
+
     for (uint32 y = 0; y < tilesY; y++) {
       for (uint32 x = 0; x < tilesX; x++) {
-        DngSliceElement e(offsets->getU32(x + y * tilesX),
-                          counts->getU32(x + y * tilesX), tilew * x, tileh * y,
+        iRectangle2D tile(tilew * x, tileh * y, tilew, tileh);
+        if (!tile.getOverlap(window).hasPositiveArea())
+          continue;
+        DngSliceElement e(tileOffsets[x + y * tilesX],
+                          tileCounts[x + y * tilesX],
+                          tile.pos.x - window.pos.x, tile.pos.y - window.pos.y,
                           tilew, tileh);
         slices.addSlice(e);
       }
@@ -231,17 +260,24 @@ void DngDecoder::decodeData(const TiffIFD* raw, int compression, uint32 sample_f
     }
 
     uint32 yPerSlice = raw->hasEntry(ROWSPERSTRIP) ?
-          raw->getEntry(ROWSPERSTRIP)->getU32() : mRaw->dim.y;
+          raw->getEntry(ROWSPERSTRIP)->getU32() : fullDim.y;
 
-    if (yPerSlice == 0 || yPerSlice > (uint32)mRaw->dim.y)
+    if (yPerSlice == 0 || yPerSlice > (uint32)fullDim.y)
       ThrowRDE("Invalid y per slice");
 
+    const vector<uint32> stripOffsets = offsets->getU32Array(counts->count);
+    const vector<uint32> stripCounts = counts->getU32Array(counts->count);
+
     uint32 offY = 0;
     for (uint32 s = 0; s < counts->count; s++) {
-      DngSliceElement e(offsets->getU32(s), counts->getU32(s), 0, offY,
-                        mRaw->dim.x, yPerSlice);
+      const uint32 stripY = offY;
       offY += yPerSlice;
+      if (stripY + yPerSlice <= (uint32)window.pos.y ||
+          stripY >= (uint32)window.getBottomRight().y)
+        continue;
 
+      DngSliceElement e(stripOffsets[s], stripCounts[s], 0,
+                        stripY - window.pos.y, fullDim.x, yPerSlice);
       if (mFile->isValid(e.byteOffset,
                          e.byteCount)) // Only decode if size is valid
         slices.addSlice(e);
@@ -259,7 +295,7 @@ void DngDecoder::decodeData(const TiffIFD* raw, int compression, uint32 sample_f
   }
 }
 
-RawImage DngDecoder::decodeRawInternal() {
+const TiffIFD* DngDecoder::getRawIFD() {
   vector<const TiffIFD*> data = mRootIFD->getIFDsWithTag(COMPRESSION);
 
   if (data.empty())
@@ -274,7 +310,10 @@ RawImage DngDecoder::decodeRawInternal() {
     writeLog(DEBUG_PRIO_EXTRA, "Multiple RAW chunks found - using first only!");
   }
 
-  const TiffIFD* raw = data[0];
+  return data[0];
+}
+
+void DngDecoder::setUpImage(const TiffIFD* raw) {
   uint32 bps = raw->getEntry(BITSPERSAMPLE)->getU32();
 
   uint32 sample_format = 1;
@@ -295,6 +334,8 @@ RawImage DngDecoder::decodeRawInternal() {
              "format %u is not supported.",
              sample_format);
   }
+  mRaw->setAllocator(allocator);
+  mRaw->threadCount = threadCount;
 
   mRaw->isCFA = (raw->getEntry(PHOTOMETRICINTERPRETATION)->getU16() == 32803);
 
@@ -322,58 +363,41 @@ RawImage DngDecoder::decodeRawInternal() {
     ThrowRDE("More than 4 samples per pixel is not supported.");
 
   mRaw->setCpp(cpp);
+}
 
-  // Now load the image
-  decodeData(raw, compression, sample_format);
-
-  // Crop
-  if (raw->hasEntry(ACTIVEAREA)) {
-    iPoint2D new_size(mRaw->dim.x, mRaw->dim.y);
+RawImage DngDecoder::decodeRawInternal() {
+  const TiffIFD* raw = getRawIFD();
+  setUpImage(raw);
 
-    TiffEntry *active_area = raw->getEntry(ACTIVEAREA);
-    if (active_area->count != 4)
-      ThrowRDE("active area has %d values instead of 4", active_area->count);
+  int compression = raw->getEntry(COMPRESSION)->getU16();
+  uint32 sample_format = 1;
+  if (raw->hasEntry(SAMPLEFORMAT))
+    sample_format = raw->getEntry(SAMPLEFORMAT)->getU32();
 
-    auto corners = active_area->getU32Array(4);
-    if (iPoint2D(corners[1], corners[0]).isThisInside(mRaw->dim)) {
-      if (iPoint2D(corners[3], corners[2]).isThisInside(mRaw->dim)) {
-        iRectangle2D crop(corners[1], corners[0], corners[3] - corners[1], corners[2] - corners[0]);
-        mRaw->subFrame(crop);
-      }
-    }
+  // Reduced resolution decoding is only possible for lossy JPEG data
+  uint32 scale = 1;
+  if (compression == 0x884c && lossyDngScale != 1) {
+    if (lossyDngScale != 2 && lossyDngScale != 4 && lossyDngScale != 8)
+      ThrowRDE("Unsupported lossy DNG scale 1/%u", lossyDngScale);
+    scale = lossyDngScale;
   }
 
-  if (raw->hasEntry(DEFAULTCROPORIGIN) && raw->hasEntry(DEFAULTCROPSIZE)) {
-    iRectangle2D cropped(0, 0, mRaw->dim.x, mRaw->dim.y);
-    TiffEntry *origin_entry = raw->getEntry(DEFAULTCROPORIGIN);
-    TiffEntry *size_entry = raw->getEntry(DEFAULTCROPSIZE);
-
-    /* Read crop position (sometimes is rational so use float) */
-    auto tl = origin_entry->getFloatArray(2);
-    if (iPoint2D(tl[0], tl[1]).isThisInside(mRaw->dim))
-      cropped = iRectangle2D(tl[0], tl[1], 0, 0);
+  // Now load the image
+  const iPoint2D fullDim = mRaw->dim;
+  decodeData(raw, compression, sample_format, scale);
+  // Only the region of interest, or a scaled image, was decoded
+  const bool partial = scale > 1 || mRaw->getUncroppedDim() != fullDim;
 
-    cropped.dim = mRaw->dim - cropped.pos;
-    /* Read size (sometimes is rational so use float) */
-    auto sz = size_entry->getFloatArray(2);
-    iPoint2D size(sz[0], sz[1]);
-    if ((size + cropped.pos).isThisInside(mRaw->dim))
-      cropped.dim = size;
+  setCrop(raw, scale);
 
-    if (!cropped.hasPositiveArea())
-      ThrowRDE("No positive crop area");
-
-    mRaw->subFrame(cropped);
-    if (mRaw->isCFA && cropped.pos.x %2 == 1)
-      mRaw->cfa.shiftLeft();
-    if (mRaw->isCFA && cropped.pos.y %2 == 1)
-      mRaw->cfa.shiftDown();
-  }
-  if (mRaw->dim.area() <= 0)
-    ThrowRDE("No image left after crop");
+  // Opcodes use full image coordinates
+  if (partial &&
+      (raw->hasEntry(OPCODELIST1) || raw->hasEntry(OPCODELIST2)))
+    writeLog(DEBUG_PRIO_EXTRA,
+             "DNG Decoder: scaled or partial decode, skipping opcodes");
 
   // Apply stage 1 opcodes
-  if (applyStage1DngOpcodes) {
+  if (applyStage1DngOpcodes && !partial) {
     if (raw->hasEntry(OPCODELIST1))
     {
       // Apply stage 1 codes
@@ -409,19 +433,10 @@ RawImage DngDecoder::decodeRawInternal() {
     }
   }
 
- // Default white level is (2 ** BitsPerSample) - 1
-  mRaw->whitePoint = (1UL << raw->getEntry(BITSPERSAMPLE)->getU16()) - 1UL;
-
-  if (raw->hasEntry(WHITELEVEL)) {
-    TiffEntry *whitelevel = raw->getEntry(WHITELEVEL);
-    if (whitelevel->isInt())
-      mRaw->whitePoint = whitelevel->getU32();
-  }
-  // Set black
-  setBlack(raw);
+  setWhiteBlack(raw, scale);
 
   // Apply opcodes to lossy DNG
-  if (compression == 0x884c && !uncorrectedRawValues) {
+  if (compression == 0x884c && !uncorrectedRawValues && !partial) {
     if (raw->hasEntry(OPCODELIST2))
     {
       // We must apply black/white scaling
@@ -444,6 +459,82 @@ RawImage DngDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void DngDecoder::probeRawInternal() {
+  const TiffIFD* raw = getRawIFD();
+  setUpImage(raw);
+  mRaw->createWithoutData();
+  setCrop(raw, 1);
+  setWhiteBlack(raw, 1);
+}
+
+void DngDecoder::setCrop(const TiffIFD* raw, uint32 scale) {
+  if (raw->hasEntry(ACTIVEAREA)) {
+    iPoint2D new_size(mRaw->dim.x, mRaw->dim.y);
+
+    TiffEntry *active_area = raw->getEntry(ACTIVEAREA);
+    if (active_area->count != 4)
+      ThrowRDE("active area has %d values instead of 4", active_area->count);
+
+    auto corners = active_area->getU32Array(4);
+    for (auto& corner : corners)
+      corner /= scale;
+    const iPoint2D cropDim = mRaw->getFullCrop().dim;
+    if (iPoint2D(corners[1], corners[0]).isThisInside(cropDim)) {
+      if (iPoint2D(corners[3], corners[2]).isThisInside(cropDim)) {
+        iRectangle2D crop(corners[1], corners[0], corners[3] - corners[1], corners[2] - corners[0]);
+        mRaw->subFrame(crop);
+      }
+    }
+  }
+
+  if (raw->hasEntry(DEFAULTCROPORIGIN) && raw->hasEntry(DEFAULTCROPSIZE)) {
+    const iPoint2D cropDim = mRaw->getFullCrop().dim;
+    iRectangle2D cropped(0, 0, cropDim.x, cropDim.y);
+    TiffEntry *origin_entry = raw->getEntry(DEFAULTCROPORIGIN);
+    TiffEntry *size_entry = raw->getEntry(DEFAULTCROPSIZE);
+
+    /* Read crop position (sometimes is rational so use float) */
+    auto tl = origin_entry->getFloatArray(2);
+    for (auto& v : tl)
+      v /= scale;
+    if (iPoint2D(tl[0], tl[1]).isThisInside(cropDim))
+      cropped = iRectangle2D(tl[0], tl[1], 0, 0);
+
+    cropped.dim = cropDim - cropped.pos;
+    /* Read size (sometimes is rational so use float) */
+    auto sz = size_entry->getFloatArray(2);
+    for (auto& v : sz)
+      v /= scale;
+    iPoint2D size(sz[0], sz[1]);
+    if ((size + cropped.pos).isThisInside(cropDim))
+      cropped.dim = size;
+
+    if (!cropped.hasPositiveArea())
+      ThrowRDE("No positive crop area");
+
+    mRaw->subFrame(cropped);
+    if (mRaw->isCFA && cropped.pos.x %2 == 1)
+      mRaw->cfa.shiftLeft();
+    if (mRaw->isCFA && cropped.pos.y %2 == 1)
+      mRaw->cfa.shiftDown();
+  }
+  if (mRaw->dim.area() <= 0)
+    ThrowRDE("No image left after crop");
+}
+
+void DngDecoder::setWhiteBlack(const TiffIFD* raw, uint32 scale) {
+  // Default white level is (2 ** BitsPerSample) - 1
+  mRaw->whitePoint = (1UL << raw->getEntry(BITSPERSAMPLE)->getU16()) - 1UL;
+
+  if (raw->hasEntry(WHITELEVEL)) {
+    TiffEntry *whitelevel = raw->getEntry(WHITELEVEL);
+    if (whitelevel->isInt())
+      mRaw->whitePoint = whitelevel->getU32();
+  }
+  // Set black
+  setBlack(raw, scale);
+}
+
 void DngDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   if (mRootIFD->hasEntryRecursive(ISOSPEEDRATINGS))
     mRaw->metadata.isoSpeed = mRootIFD->getEntryRecursive(ISOSPEEDRATINGS)->getU32();
@@ -523,7 +614,9 @@ void DngDecoder::checkSupportInternal(const CameraMetaData* meta) {
 }
 
 /* Decodes DNG masked areas into blackareas in the image */
-bool DngDecoder::decodeMaskedAreas(const TiffIFD* raw) {
+/* The areas are in full resolution coordinates, for a scaled decode they are
+   shrunk to the scaled pixels that lie completely inside of them. */
+bool DngDecoder::decodeMaskedAreas(const TiffIFD* raw, uint32 scale) {
   TiffEntry *masked = raw->getEntry(MASKEDAREAS);
 
   if (masked->type != TIFF_SHORT && masked->type != TIFF_LONG)
@@ -536,26 +629,31 @@ bool DngDecoder::decodeMaskedAreas(const TiffIFD* raw) {
   /* Since we may both have short or int, copy it to int array. */
   auto rects = masked->getU32Array(nrects*4);
 
-  iPoint2D top = mRaw->getCropOffset();
+  const iRectangle2D crop = mRaw->getFullCrop();
+  const iPoint2D top = crop.pos;
 
   for (uint32 i = 0; i < nrects; i++) {
-    iPoint2D topleft = iPoint2D(rects[i * 4UL + 1UL], rects[i * 4UL]);
-    iPoint2D bottomright = iPoint2D(rects[i * 4UL + 3UL], rects[i * 4UL + 2UL]);
+    iPoint2D topleft = iPoint2D((rects[i * 4UL + 1UL] + scale - 1) / scale,
+                                (rects[i * 4UL] + scale - 1) / scale);
+    iPoint2D bottomright =
+        iPoint2D(rects[i * 4UL + 3UL] / scale, rects[i * 4UL + 2UL] / scale);
+    if (bottomright.x <= topleft.x || bottomright.y <= topleft.y)
+      continue;
     // Is this a horizontal box, only add it if it covers the active width of the image
-    if (topleft.x <= top.x && bottomright.x >= (mRaw->dim.x + top.x)) {
+    if (topleft.x <= top.x && bottomright.x >= (crop.dim.x + top.x)) {
       mRaw->blackAreas.emplace_back(topleft.y, bottomright.y - topleft.y,
                                     false);
     }
     // Is it a vertical box, only add it if it covers the active height of the
     // image
-    else if (topleft.y <= top.y && bottomright.y >= (mRaw->dim.y + top.y)) {
+    else if (topleft.y <= top.y && bottomright.y >= (crop.dim.y + top.y)) {
       mRaw->blackAreas.emplace_back(topleft.x, bottomright.x - topleft.x, true);
     }
   }
   return !mRaw->blackAreas.empty();
 }
 
-bool DngDecoder::decodeBlackLevels(const TiffIFD* raw) {
+bool DngDecoder::decodeBlackLevels(const TiffIFD* raw, uint32 scale) {
   iPoint2D blackdim(1,1);
   if (raw->hasEntry(BLACKLEVELREPEATDIM)) {
     TiffEntry *bleveldim = raw->getEntry(BLACKLEVELREPEATDIM);
@@ -592,42 +690,48 @@ bool DngDecoder::decodeBlackLevels(const TiffIFD* raw) {
   }
 
   // DNG Spec says we must add black in deltav and deltah
+  // They have one value per full resolution row / column, the last scaled
+  // row / column may stand for fewer than 'scale' of them.
+  // The crop, not the window of a region of interest, decides how many.
+  const iPoint2D cropDim = mRaw->getFullCrop().dim;
   if (raw->hasEntry(BLACKLEVELDELTAV)) {
     TiffEntry *blackleveldeltav = raw->getEntry(BLACKLEVELDELTAV);
-    if ((int)blackleveldeltav->count < mRaw->dim.y)
+    if ((int)blackleveldeltav->count < cropDim.y)
       ThrowRDE("BLACKLEVELDELTAV array is too small");
+    const int rows = min<int>(blackleveldeltav->count, cropDim.y * scale);
     float black_sum[2] = {0.0f, 0.0f};
-    for (int i = 0; i < mRaw->dim.y; i++)
+    for (int i = 0; i < rows; i++)
       black_sum[i&1] += blackleveldeltav->getFloat(i);
 
     for (int i = 0; i < 4; i++)
-      mRaw->blackLevelSeparate[i] += (int)(black_sum[i>>1] / (float)mRaw->dim.y * 2.0f);
+      mRaw->blackLevelSeparate[i] += (int)(black_sum[i>>1] / (float)rows * 2.0f);
   }
 
   if (raw->hasEntry(BLACKLEVELDELTAH)){
     TiffEntry *blackleveldeltah = raw->getEntry(BLACKLEVELDELTAH);
-    if ((int)blackleveldeltah->count < mRaw->dim.x)
+    if ((int)blackleveldeltah->count < cropDim.x)
       ThrowRDE("BLACKLEVELDELTAH array is too small");
+    const int cols = min<int>(blackleveldeltah->count, cropDim.x * scale);
     float black_sum[2] = {0.0f, 0.0f};
-    for (int i = 0; i < mRaw->dim.x; i++)
+    for (int i = 0; i < cols; i++)
       black_sum[i&1] += blackleveldeltah->getFloat(i);
 
     for (int i = 0; i < 4; i++)
-      mRaw->blackLevelSeparate[i] += (int)(black_sum[i&1] / (float)mRaw->dim.x * 2.0f);
+      mRaw->blackLevelSeparate[i] += (int)(black_sum[i&1] / (float)cols * 2.0f);
   }
   return true;
 }
 
-void DngDecoder::setBlack(const TiffIFD* raw) {
+void DngDecoder::setBlack(const TiffIFD* raw, uint32 scale) {
 
   if (raw->hasEntry(MASKEDAREAS))
-    if (decodeMaskedAreas(raw))
+    if (decodeMaskedAreas(raw, scale))
       return;
 
   // Black defaults to 0
   memset(mRaw->blackLevelSeparate,0,sizeof(mRaw->blackLevelSeparate));
 
   if (raw->hasEntry(BLACKLEVEL))
-    decodeBlackLevels(raw);
+    decodeBlackLevels(raw, scale);
 }
 } // namespace RawSpeed
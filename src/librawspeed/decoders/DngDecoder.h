@@ -38,6 +38,7 @@ public:
   DngDecoder(TiffRootIFDOwner&& rootIFD, Buffer* file);
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   void checkSupportInternal(const CameraMetaData* meta) override;
 
@@ -45,12 +46,17 @@ protected:
   int getDecoderVersion() const override { return 0; }
   bool mFixLjpeg;
   void dropUnsuportedChunks(std::vector<const TiffIFD*>& data);
+  const TiffIFD* getRawIFD();
+  void setUpImage(const TiffIFD* raw);
   void parseCFA(const TiffIFD* raw);
-  void decodeData(const TiffIFD* raw, int compression, uint32 sample_format);
+  void decodeData(const TiffIFD* raw, int compression, uint32 sample_format,
+                  uint32 scale);
+  void setCrop(const TiffIFD* raw, uint32 scale);
+  void setWhiteBlack(const TiffIFD* raw, uint32 scale);
   void printMetaData();
-  bool decodeMaskedAreas(const TiffIFD* raw);
-  bool decodeBlackLevels(const TiffIFD* raw);
-  void setBlack(const TiffIFD* raw);
+  bool decodeMaskedAreas(const TiffIFD* raw, uint32 scale);
+  bool decodeBlackLevels(const TiffIFD* raw, uint32 scale);
+  void setBlack(const TiffIFD* raw, uint32 scale);
 };
 
 } // namespace RawSpeed
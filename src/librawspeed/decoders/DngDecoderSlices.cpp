@@ -21,7 +21,9 @@
 #include "rawspeedconfig.h"
 #include "decoders/DngDecoderSlices.h"
 #include "common/Common.h"                          // for uint32, getThrea...
+#include "common/DecodeCounters.h"                  // for DecodeCountersScope
 #include "common/Point.h"                           // for iPoint2D
+#include "common/Trace.h"                           // for TraceScope
 #include "decoders/RawDecoderException.h"           // for RawDecoderException
 #include "decompressors/DeflateDecompressor.h"      // for DeflateDecompressor
 #include "decompressors/JpegDecompressor.h"         // for JpegDecompressor
@@ -45,6 +47,8 @@ namespace RawSpeed {
 void *DecodeThread(void *_this) {
   auto *me = (DngDecoderThread *)_this;
   DngDecoderSlices* parent = me->parent;
+  TraceScope trace("DngDecoderSlices thread");
+  DecodeCountersScope counters(&parent->mRaw->counters);
   try {
     parent->decodeSlice(me);
   } catch (const std::exception &exc) {
@@ -60,6 +64,7 @@ DngDecoderSlices::DngDecoderSlices(Buffer* file, const RawImage& img,
                                    int _compression)
     : mFile(file), mRaw(img) {
   mFixLjpeg = false;
+  mScale = 1;
   compression = _compression;
 }
 
@@ -68,18 +73,31 @@ void DngDecoderSlices::addSlice(const DngSliceElement &slice) {
 }
 
 void DngDecoderSlices::startDecoding() {
-#ifndef HAVE_PTHREAD
-  DngDecoderThread t(this);
-  while (!slices.empty()) {
-    t.slices.push(slices.front());
-    slices.pop();
+  if (slices.empty())
+    return;
+
+  // Rough decoding cost per pixel: ~2 ns uncompressed, ~10 ns for (L)JPEG
+  const DngSliceElement& first = slices.front();
+  const uint64 sliceCost =
+      (uint64)first.width * first.height * mRaw->getCpp() *
+      (compression == 1 ? 2 : 10) / (mScale * mScale);
+  const WorkSplit split = splitWork("DngDecoderSlices", slices.size(),
+                                    sliceCost, getThreadCount(mRaw->threadCount));
+  nThreads = split.threads;
+
+  // Not worth starting any threads
+  if (nThreads == 1) {
+    DngDecoderThread t(this);
+    while (!slices.empty()) {
+      t.slices.push(slices.front());
+      slices.pop();
+    }
+    DecodeThread(&t);
+    return;
   }
-  DecodeThread(&t);
-#else
-  // Create threads
 
-  nThreads = getThreadCount();
-  int slicesPerThread = ((int)slices.size() + nThreads - 1) / nThreads;
+#ifdef HAVE_PTHREAD
+  int slicesPerThread = split.itemsPerThread;
 //  decodedSlices = 0;
   pthread_attr_t attr;
   /* Initialize and set thread detached attribute */
@@ -104,6 +122,8 @@ void DngDecoderSlices::startDecoding() {
     pthread_join(thread->threadid, &status);
   }
   threads.clear();
+#else
+  ThrowRDE("Unreachable");
 #endif
 }
 
@@ -185,7 +205,7 @@ void DngDecoderSlices::decodeSlice(DngDecoderThread* t) {
       t->slices.pop();
       JpegDecompressor j(*mFile, e.byteOffset, e.byteCount, mRaw);
       try {
-        j.decode(e.offX, e.offY);
+        j.decode(e.offX / mScale, e.offY / mScale, mScale);
       } catch (RawDecoderException &err) {
         mRaw->setError(err.what());
       } catch (IOException &err) {
@@ -80,6 +80,7 @@ public:
   bool mFixLjpeg;
   uint32 mPredictor;
   uint32 mBps;
+  uint32 mScale; // lossy JPEG only: decode at 1/mScale resolution
   uint32 nThreads;
   int compression;
 };
@@ -35,20 +35,28 @@ namespace RawSpeed {
 
 class CameraMetaData;
 
-RawImage ErfDecoder::decodeRawInternal() {
+uint32 ErfDecoder::setUpImage(uint32* count) {
   auto raw = mRootIFD->getIFDWithTag(STRIPOFFSETS, 1);
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
   uint32 off = raw->getEntry(STRIPOFFSETS)->getU32();
-  uint32 c2 = raw->getEntry(STRIPBYTECOUNTS)->getU32();
+  *count = raw->getEntry(STRIPBYTECOUNTS)->getU32();
 
-  if (c2 > mFile->getSize() - off) {
+  if (*count > mFile->getSize() - off) {
     mRaw->setError("Warning: byte count larger than file size, file probably truncated.");
   }
 
   mRaw->dim = iPoint2D(width, height);
+  return off;
+}
+
+RawImage ErfDecoder::decodeRawInternal() {
+  uint32 c2;
+  uint32 off = setUpImage(&c2);
   mRaw->createData();
 
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
   UncompressedDecompressor u(*mFile, off, c2, mRaw, uncorrectedRawValues);
 
   u.decode12BitRawBEWithControl(width, height);
@@ -56,6 +64,12 @@ RawImage ErfDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void ErfDecoder::probeRawInternal() {
+  uint32 c2;
+  setUpImage(&c2);
+  mRaw->createWithoutData();
+}
+
 void ErfDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   setMetaData(meta, "", 0);
 
@@ -36,7 +36,7 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage KdcDecoder::decodeRawInternal() {
+uint32 KdcDecoder::setUpImage() {
   if (!mRootIFD->hasEntryRecursive(COMPRESSION))
     ThrowRDE("Couldn't find compression setting");
 
@@ -60,22 +60,32 @@ RawImage KdcDecoder::decodeRawInternal() {
   uint32 off = offset->getU32(4) + offset->getU32(12);
 
   // Offset hardcoding gotten from dcraw
-  if (hints.has("easyshare_offset_hack"))
+  if (hints.has(HINT_EASYSHARE_OFFSET_HACK))
     off = off < 0x15000 ? 0x15000 : 0x17000;
 
   if (off > mFile->getSize())
     ThrowRDE("offset is out of bounds");
 
   mRaw->dim = iPoint2D(width, height);
+  return off;
+}
+
+RawImage KdcDecoder::decodeRawInternal() {
+  uint32 off = setUpImage();
   mRaw->createData();
 
   UncompressedDecompressor u(*mFile, off, mRaw, uncorrectedRawValues);
 
-  u.decode12BitRawBE(width, height);
+  u.decode12BitRawBE(mRaw->dim.x, mRaw->dim.y);
 
   return mRaw;
 }
 
+void KdcDecoder::probeRawInternal() {
+  setUpImage();
+  mRaw->createWithoutData();
+}
+
 void KdcDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   setMetaData(meta, "", 0);
 
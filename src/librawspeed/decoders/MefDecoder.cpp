@@ -33,20 +33,28 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage MefDecoder::decodeRawInternal() {
+uint32 MefDecoder::setUpImage(uint32* count) {
   auto raw = mRootIFD->getIFDWithTag(STRIPOFFSETS, 1);
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
   uint32 off = raw->getEntry(STRIPOFFSETS)->getU32();
-  uint32 c2 = raw->getEntry(STRIPBYTECOUNTS)->getU32();
+  *count = raw->getEntry(STRIPBYTECOUNTS)->getU32();
 
-  if (c2 > mFile->getSize() - off) {
+  if (*count > mFile->getSize() - off) {
     mRaw->setError("Warning: byte count larger than file size, file probably truncated.");
   }
 
   mRaw->dim = iPoint2D(width, height);
+  return off;
+}
+
+RawImage MefDecoder::decodeRawInternal() {
+  uint32 c2;
+  uint32 off = setUpImage(&c2);
   mRaw->createData();
 
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
   UncompressedDecompressor u(*mFile, off, mRaw, uncorrectedRawValues);
 
   u.decode12BitRawBE(width, height);
@@ -54,6 +62,12 @@ RawImage MefDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void MefDecoder::probeRawInternal() {
+  uint32 c2;
+  setUpImage(&c2);
+  mRaw->createWithoutData();
+}
+
 void MefDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   setMetaData(meta, "", 0);
 }
@@ -34,8 +34,9 @@
 #include "tiff/TiffTag.h"                           // for TiffTag::TILEOFF...
 #include <algorithm>                                // for move
 #include <cstring>                                  // for memchr
-#include <istream>                                  // for istringstream
+#include <istream>                                  // for basic_istream::operator>>
 #include <memory>                                   // for unique_ptr
+#include <sstream>                                  // for istringstream
 #include <string>                                   // for string, allocator
 
 using namespace std;
@@ -109,6 +109,11 @@ RawImage MrwDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void MrwDecoder::probeRawInternal() {
+  mRaw->dim = iPoint2D(raw_width, raw_height);
+  mRaw->createWithoutData();
+}
+
 void MrwDecoder::checkSupportInternal(const CameraMetaData* meta) {
   auto id = rootIFD->getID();
   this->checkCameraSupported(meta, id.make, id.model, "");
@@ -124,7 +129,7 @@ void MrwDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   auto id = rootIFD->getID();
   setMetaData(meta, id.make, id.model, "", iso);
 
-  if (hints.has("swapped_wb")) {
+  if (hints.has(HINT_SWAPPED_WB)) {
     mRaw->metadata.wbCoeffs[0] = (float) wb_coeffs[2];
     mRaw->metadata.wbCoeffs[1] = (float) wb_coeffs[0];
     mRaw->metadata.wbCoeffs[2] = (float) wb_coeffs[1];
@@ -35,6 +35,7 @@ class MrwDecoder final : public RawDecoder {
 public:
   MrwDecoder(Buffer* file);
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void checkSupportInternal(const CameraMetaData* meta) override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   static int isMRW(Buffer* input);
@@ -54,20 +54,21 @@ void NakedDecoder::parseHints() {
   const auto& make = cam->make.c_str();
   const auto& model = cam->model.c_str();
 
-  auto parseHint = [&cHints, &make, &model](const string& name) -> uint32 {
-    if (!cHints.has(name))
-      ThrowRDE("%s %s: couldn't find %s", make, model, name.c_str());
+  auto parseHint = [&cHints, &make, &model](HintKey key,
+                                            const char* name) -> uint32 {
+    if (!cHints.has(key))
+      ThrowRDE("%s %s: couldn't find %s", make, model, name);
 
-    return cHints.get(name, 0u);
+    return cHints.get(key, 0u);
   };
 
-  width = parseHint("full_width");
-  height = parseHint("full_height");
-  filesize = parseHint("filesize");
-  offset = cHints.get("offset", 0);
-  bits = cHints.get("bits", (filesize-offset)*8/width/height);
+  width = parseHint(HINT_FULL_WIDTH, "full_width");
+  height = parseHint(HINT_FULL_HEIGHT, "full_height");
+  filesize = parseHint(HINT_FILESIZE, "filesize");
+  offset = cHints.get(HINT_OFFSET, 0);
+  bits = cHints.get(HINT_BITS, (filesize-offset)*8/width/height);
 
-  auto order = cHints.get("order", string());
+  auto order = cHints.get(HINT_ORDER, string());
   if (!order.empty()) {
     try {
       bo = order2enum.at(order);
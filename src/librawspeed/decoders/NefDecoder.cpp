@@ -49,7 +49,7 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage NefDecoder::decodeRawInternal() {
+NefDecoder::NefType NefDecoder::setUpImage(vector<NefSlice>* slices) {
   auto raw = mRootIFD->getIFDWithTag(CFAPATTERN);
   int compression = raw->getEntry(COMPRESSION)->getU32();
 
@@ -60,20 +60,27 @@ RawImage NefDecoder::decodeRawInternal() {
     if (!mFile->isValid(offsets->getU32()))
       ThrowRDE("Image data outside of file.");
     if (!D100IsCompressed(offsets->getU32())) {
-      DecodeD100Uncompressed();
-      return mRaw;
+      // Hardcode the sizes as at least the width is not correctly reported
+      mRaw->dim = iPoint2D(3040, 2024);
+      return NEF_D100_UNCOMPRESSED;
     }
   }
 
-  if (compression == 1 || (hints.has("force_uncompressed")) ||
+  if (compression == 1 || (hints.has(HINT_FORCE_UNCOMPRESSED)) ||
       NEFIsUncompressed(raw)) {
-    DecodeUncompressed();
-    return mRaw;
+    *slices = setUpUncompressed();
+    return NEF_UNCOMPRESSED;
   }
 
   if (NEFIsUncompressedRGB(raw)) {
-    DecodeSNefUncompressed();
-    return mRaw;
+    raw = getIFDWithLargestImage(CFAPATTERN);
+    uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
+    uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
+
+    mRaw->dim = iPoint2D(width, height);
+    mRaw->setCpp(3);
+    mRaw->isCFA = false;
+    return NEF_SNEF_UNCOMPRESSED;
   }
 
   if (offsets->count != 1) {
@@ -92,9 +99,42 @@ RawImage NefDecoder::decodeRawInternal() {
 
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
-  uint32 bitPerPixel = raw->getEntry(BITSPERSAMPLE)->getU32();
 
   mRaw->dim = iPoint2D(width, height);
+  return NEF_COMPRESSED;
+}
+
+RawImage NefDecoder::decodeRawInternal() {
+  vector<NefSlice> slices;
+  switch (setUpImage(&slices)) {
+  case NEF_D100_UNCOMPRESSED:
+    DecodeD100Uncompressed();
+    break;
+  case NEF_UNCOMPRESSED:
+    DecodeUncompressed(slices);
+    break;
+  case NEF_SNEF_UNCOMPRESSED:
+    DecodeSNefUncompressed();
+    break;
+  case NEF_COMPRESSED:
+    DecodeCompressed();
+    break;
+  }
+  return mRaw;
+}
+
+void NefDecoder::probeRawInternal() {
+  vector<NefSlice> slices;
+  setUpImage(&slices);
+  mRaw->createWithoutData();
+}
+
+void NefDecoder::DecodeCompressed() {
+  auto raw = mRootIFD->getIFDWithTag(CFAPATTERN);
+  TiffEntry *offsets = raw->getEntry(STRIPOFFSETS);
+  TiffEntry *counts = raw->getEntry(STRIPBYTECOUNTS);
+  uint32 bitPerPixel = raw->getEntry(BITSPERSAMPLE)->getU32();
+
   mRaw->createData();
 
   raw = mRootIFD->getIFDWithTag((TiffTag)0x8c);
@@ -114,8 +154,6 @@ RawImage NefDecoder::decodeRawInternal() {
     mRaw->setError(e.what());
     // Let's ignore it, it may have delivered somewhat useful data.
   }
-
-  return mRaw;
 }
 
 /*
@@ -155,7 +193,7 @@ bool NefDecoder::NEFIsUncompressedRGB(const TiffIFD* raw) {
   return counts->getU32(0) == width*height*3;
 }
 
-void NefDecoder::DecodeUncompressed() {
+vector<NefSlice> NefDecoder::setUpUncompressed() {
   auto raw = getIFDWithLargestImage(CFAPATTERN);
   uint32 nslices = raw->getEntry(STRIPOFFSETS)->count;
   TiffEntry *offsets = raw->getEntry(STRIPOFFSETS);
@@ -163,15 +201,17 @@ void NefDecoder::DecodeUncompressed() {
   uint32 yPerSlice = raw->getEntry(ROWSPERSTRIP)->getU32();
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
-  uint32 bitPerPixel = raw->getEntry(BITSPERSAMPLE)->getU32();
+
+  const vector<uint32> sliceOffsets = offsets->getU32Array(nslices);
+  const vector<uint32> sliceCounts = counts->getU32Array(nslices);
 
   vector<NefSlice> slices;
   uint32 offY = 0;
 
   for (uint32 s = 0; s < nslices; s++) {
     NefSlice slice;
-    slice.offset = offsets->getU32(s);
-    slice.count = counts->getU32(s);
+    slice.offset = sliceOffsets[s];
+    slice.count = sliceCounts[s];
     if (offY + yPerSlice > height)
       slice.h = height - offY;
     else
@@ -187,26 +227,33 @@ void NefDecoder::DecodeUncompressed() {
     ThrowRDE("No valid slices found. File probably truncated.");
 
   mRaw->dim = iPoint2D(width, offY);
+  return slices;
+}
+
+void NefDecoder::DecodeUncompressed(const vector<NefSlice>& slices) {
+  auto raw = getIFDWithLargestImage(CFAPATTERN);
+  const uint32 width = mRaw->dim.x;
+  uint32 bitPerPixel = raw->getEntry(BITSPERSAMPLE)->getU32();
 
   mRaw->createData();
   if (bitPerPixel == 14 && width*slices[0].h*2 == slices[0].count)
     bitPerPixel = 16; // D3 & D810
 
-  bitPerPixel = hints.get("real_bpp", bitPerPixel);
+  bitPerPixel = hints.get(HINT_REAL_BPP, bitPerPixel);
 
-  bool bitorder = ! hints.has("msb_override");
+  bool bitorder = ! hints.has(HINT_MSB_OVERRIDE);
 
-  offY = 0;
+  uint32 offY = 0;
   for (uint32 i = 0; i < slices.size(); i++) {
     NefSlice slice = slices[i];
     ByteStream in(mFile, slice.offset, slice.count);
     iPoint2D size(width, slice.h);
     iPoint2D pos(0, offY);
     try {
-      if (hints.has("coolpixmangled"))
+      if (hints.has(HINT_COOLPIXMANGLED))
         readCoolpixMangledRaw(in, size, pos, width*bitPerPixel / 8);
       else {
-        if (hints.has("coolpixsplit"))
+        if (hints.has(HINT_COOLPIXSPLIT))
           readCoolpixSplitRaw(in, size, pos, width * bitPerPixel / 8);
         else {
           UncompressedDecompressor u(in, mRaw, uncorrectedRawValues);
@@ -309,11 +356,9 @@ void NefDecoder::DecodeD100Uncompressed() {
   auto ifd = mRootIFD->getIFDWithTag(STRIPOFFSETS, 1);
 
   uint32 offset = ifd->getEntry(STRIPOFFSETS)->getU32();
-  // Hardcode the sizes as at least the width is not correctly reported
-  uint32 width = 3040;
-  uint32 height = 2024;
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
 
-  mRaw->dim = iPoint2D(width, height);
   mRaw->createData();
 
   UncompressedDecompressor u(*mFile, offset, mRaw, uncorrectedRawValues);
@@ -324,12 +369,9 @@ void NefDecoder::DecodeD100Uncompressed() {
 void NefDecoder::DecodeSNefUncompressed() {
   auto raw = getIFDWithLargestImage(CFAPATTERN);
   uint32 offset = raw->getEntry(STRIPOFFSETS)->getU32();
-  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
-  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
 
-  mRaw->dim = iPoint2D(width, height);
-  mRaw->setCpp(3);
-  mRaw->isCFA = false;
   mRaw->createData();
 
   ByteStream in(mFile, offset);
@@ -508,7 +550,7 @@ void NefDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
     }
   }
 
-  if (hints.has("nikon_wb_adjustment")) {
+  if (hints.has(HINT_NIKON_WB_ADJUSTMENT)) {
     mRaw->metadata.wbCoeffs[0] *= 256/527.0;
     mRaw->metadata.wbCoeffs[2] *= 256/317.0;
   }
@@ -26,6 +26,7 @@
 #include "tiff/TiffIFD.h"                 // for TiffIFD (ptr only), TiffRo...
 #include <algorithm>                      // for move
 #include <string>                         // for string
+#include <vector>                         // for vector
 
 namespace RawSpeed {
 
@@ -33,6 +34,7 @@ class ByteStream;
 class CameraMetaData;
 class iPoint2D;
 class Buffer;
+class NefSlice;
 
 class NefDecoder final : public AbstractTiffDecoder
 {
@@ -43,15 +45,28 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   void checkSupportInternal(const CameraMetaData* meta) override;
 
 private:
   int getDecoderVersion() const override { return 5; }
+  // How the raw data of a NEF is stored
+  enum NefType {
+    NEF_D100_UNCOMPRESSED,
+    NEF_UNCOMPRESSED,
+    NEF_SNEF_UNCOMPRESSED,
+    NEF_COMPRESSED
+  };
+  // Checks the headers and sets the image size. The slices are only set
+  // for NEF_UNCOMPRESSED.
+  NefType setUpImage(std::vector<NefSlice>* slices);
+  std::vector<NefSlice> setUpUncompressed();
   bool D100IsCompressed(uint32 offset);
   bool NEFIsUncompressed(const TiffIFD* raw);
   bool NEFIsUncompressedRGB(const TiffIFD* raw);
-  void DecodeUncompressed();
+  void DecodeCompressed();
+  void DecodeUncompressed(const std::vector<NefSlice>& slices);
   void DecodeD100Uncompressed();
   void DecodeSNefUncompressed();
   void readCoolpixMangledRaw(ByteStream &input, iPoint2D& size, iPoint2D& offset, int inputPitch);
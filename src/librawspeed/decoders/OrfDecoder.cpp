@@ -39,6 +39,7 @@
 #include <cstdlib>                                  // for abs
 #include <cstring>                                  // for memset
 #include <memory>                                   // for unique_ptr
+#include <vector>                                   // for vector
 
 using namespace std;
 
@@ -46,7 +47,7 @@ namespace RawSpeed {
 
 class CameraMetaData;
 
-RawImage OrfDecoder::decodeRawInternal() {
+const TiffIFD* OrfDecoder::setUpImage(uint32* off, uint32* size) {
   auto raw = mRootIFD->getIFDWithTag(STRIPOFFSETS);
 
   int compression = raw->getEntry(COMPRESSION)->getU32();
@@ -63,25 +64,35 @@ RawImage OrfDecoder::decodeRawInternal() {
   }
 
   //TODO: this code assumes that all strips are layed out directly after another without padding and in order
-  uint32 off = raw->getEntry(STRIPOFFSETS)->getU32();
-  uint32 size = 0;
-  for (uint32 i=0; i < counts->count; i++)
-    size += counts->getU32(i);
+  *off = raw->getEntry(STRIPOFFSETS)->getU32();
+  *size = 0;
+  for (uint32 count : counts->getU32Array(counts->count))
+    *size += count;
 
-  if (!mFile->isValid(off, size))
+  if (!mFile->isValid(*off, *size))
     ThrowRDE("Truncated file");
 
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
 
   mRaw->dim = iPoint2D(width, height);
+  return raw;
+}
+
+RawImage OrfDecoder::decodeRawInternal() {
+  uint32 off;
+  uint32 size;
+  auto raw = setUpImage(&off, &size);
   mRaw->createData();
 
+  TiffEntry *offsets = raw->getEntry(STRIPOFFSETS);
   ByteStream input(offsets->getRootIfdData());
   input.setPosition(off);
 
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
   try {
-    if (offsets->count != 1 || hints.has("force_uncompressed"))
+    if (offsets->count != 1 || hints.has(HINT_FORCE_UNCOMPRESSED))
       decodeUncompressed(input, width, height, size);
     else
       decodeCompressed(input, width, height);
@@ -92,11 +103,18 @@ RawImage OrfDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void OrfDecoder::probeRawInternal() {
+  uint32 off;
+  uint32 size;
+  setUpImage(&off, &size);
+  mRaw->createWithoutData();
+}
+
 void OrfDecoder::decodeUncompressed(ByteStream& s, uint32 w, uint32 h, uint32 size) {
   UncompressedDecompressor u(s, mRaw, uncorrectedRawValues);
-  if (hints.has("packed_with_control"))
+  if (hints.has(HINT_PACKED_WITH_CONTROL))
     u.decode12BitRawWithControl(w, h);
-  else if (hints.has("jpeg32_bitorder")) {
+  else if (hints.has(HINT_JPEG32_BITORDER)) {
     iPoint2D dimensions(w, h), pos(0, 0);
     u.readUncompressedRaw(dimensions, pos, w * 12 / 8, 12, BitOrder_Jpeg32);
   } else if (size >= w*h*2) { // We're in an unpacked raw
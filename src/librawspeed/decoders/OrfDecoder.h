@@ -24,7 +24,7 @@
 #include "common/Common.h"                // for uint32
 #include "common/RawImage.h"              // for RawImage
 #include "decoders/AbstractTiffDecoder.h" // for AbstractTiffDecoder
-#include "tiff/TiffIFD.h"                 // for TiffRootIFDOwner
+#include "tiff/TiffIFD.h"                 // for TiffIFD, TiffRootIFDOwner
 #include <algorithm>                      // for move
 
 namespace RawSpeed {
@@ -42,10 +42,14 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
 
 private:
   int getDecoderVersion() const override { return 3; }
+  // Checks the strips and sets the image size. Returns the raw IFD, and the
+  // offset and total size of the strips.
+  const TiffIFD* setUpImage(uint32* off, uint32* size);
   void decodeCompressed(ByteStream& s,uint32 w, uint32 h);
   void decodeUncompressed(ByteStream& s, uint32 w, uint32 h, uint32 size);
 };
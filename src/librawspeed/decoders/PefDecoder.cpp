@@ -37,15 +37,14 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage PefDecoder::decodeRawInternal() {
+const TiffIFD* PefDecoder::setUpImage(bool* compressed) {
   auto raw = mRootIFD->getIFDWithTag(STRIPOFFSETS);
 
   int compression = raw->getEntry(COMPRESSION)->getU32();
 
-  if (1 == compression || compression == 32773) {
-    decodeUncompressed(raw, BitOrder_Jpeg);
-    return mRaw;
-  }
+  *compressed = !(1 == compression || compression == 32773);
+  if (!*compressed)
+    return raw;
 
   if (65535 != compression)
     ThrowRDE("Unsupported compression");
@@ -68,7 +67,21 @@ RawImage PefDecoder::decodeRawInternal() {
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
 
   mRaw->dim = iPoint2D(width, height);
+  return raw;
+}
+
+RawImage PefDecoder::decodeRawInternal() {
+  bool compressed;
+  auto raw = setUpImage(&compressed);
+
+  if (!compressed) {
+    decodeUncompressed(raw, BitOrder_Jpeg);
+    return mRaw;
+  }
+
   mRaw->createData();
+  TiffEntry *offsets = raw->getEntry(STRIPOFFSETS);
+  TiffEntry *counts = raw->getEntry(STRIPBYTECOUNTS);
   try {
     decodePentax(mRaw, ByteStream(mFile, offsets->getU32(), counts->getU32()), getRootIFD());
   } catch (IOException &e) {
@@ -79,6 +92,16 @@ RawImage PefDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void PefDecoder::probeRawInternal() {
+  bool compressed;
+  auto raw = setUpImage(&compressed);
+
+  if (compressed)
+    mRaw->createWithoutData();
+  else
+    probeUncompressed(raw);
+}
+
 void PefDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   int iso = 0;
   mRaw->cfa.setCFA(iPoint2D(2,2), CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE);
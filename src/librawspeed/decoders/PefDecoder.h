@@ -22,7 +22,7 @@
 
 #include "common/RawImage.h"              // for RawImage
 #include "decoders/AbstractTiffDecoder.h" // for AbstractTiffDecoder
-#include "tiff/TiffIFD.h"                 // for TiffRootIFDOwner
+#include "tiff/TiffIFD.h"                 // for TiffIFD, TiffRootIFDOwner
 #include <algorithm>                      // for move
 
 namespace RawSpeed {
@@ -39,10 +39,16 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
 
 protected:
   int getDecoderVersion() const override { return 3; }
+
+private:
+  // Returns the raw IFD, and whether its data is compressed. For compressed
+  // data the strip is checked and the image size set.
+  const TiffIFD* setUpImage(bool* compressed);
 };
 
 } // namespace RawSpeed
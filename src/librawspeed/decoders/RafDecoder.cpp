@@ -88,7 +88,7 @@ RawImage RafDecoder::decodeRawInternal() {
   // Some fuji SuperCCD cameras include a second raw image next to the first one
   // that is identical but darker to the first. The two combined can produce
   // a higher dynamic range image. Right now we're ignoring it.
-  bool double_width = hints.has("double_width_unpacked");
+  bool double_width = hints.has(HINT_DOUBLE_WIDTH_UNPACKED);
 
   mRaw->dim = iPoint2D(width*(double_width ? 2 : 1), height);
   mRaw->createData();
@@ -106,7 +106,7 @@ RawImage RafDecoder::decodeRawInternal() {
   } else if (input.isInNativeByteOrder() == (getHostEndianness() == big)) {
     u.decode16BitRawBEunpacked(width, height);
   } else {
-    if (hints.has("jpeg32_bitorder")) {
+    if (hints.has(HINT_JPEG32_BITORDER)) {
       u.readUncompressedRaw(mRaw->dim, pos, width * bps / 8, bps,
                             BitOrder_Jpeg32);
     } else {
@@ -141,7 +141,7 @@ void RafDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   if (applyCrop) {
     new_size = cam->cropSize;
     crop_offset = cam->cropPos;
-    bool double_width = hints.has("double_width_unpacked");
+    bool double_width = hints.has(HINT_DOUBLE_WIDTH_UNPACKED);
     // If crop size is negative, use relative cropping
     if (new_size.x <= 0)
       new_size.x = mRaw->dim.x / (double_width ? 2 : 1) - cam->cropPos.x + new_size.x;
@@ -152,7 +152,7 @@ void RafDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
       new_size.y = mRaw->dim.y - cam->cropPos.y + new_size.y;
   }
 
-  bool rotate = hints.has("fuji_rotate");
+  bool rotate = hints.has(HINT_FUJI_ROTATE);
   rotate = rotate & fujiRotate;
 
   // Rotate 45 degrees - could be multithreaded.
@@ -170,9 +170,11 @@ void RafDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
     }
 
     iPoint2D final_size(rotatedsize, rotatedsize-1);
-    RawImage rotated = RawImage::create(final_size, TYPE_USHORT16, 1);
+    RawImage rotated =
+        RawImage::create(final_size, TYPE_USHORT16, 1, allocator);
     rotated->clearArea(iRectangle2D(iPoint2D(0,0), rotated->dim));
     rotated->metadata = mRaw->metadata;
+    rotated->counters = mRaw->counters;
     rotated->metadata.fujiRotationPos = rotationPos;
 
     int dest_pitch = (int)rotated->pitch / 2;
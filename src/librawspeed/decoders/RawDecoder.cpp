@@ -22,7 +22,11 @@
 #include "rawspeedconfig.h" // for HAVE_PTHREAD
 #include "decoders/RawDecoder.h"
 #include "common/Common.h"                          // for uint32, getThrea...
+#include "common/DecodeCounters.h"                  // for DecodeCountersScope
 #include "common/Point.h"                           // for iPoint2D, iRecta...
+#include "common/RawspeedException.h"               // for RawspeedExce...
+#include "common/RowBinner.h"                       // for RowBinner
+#include "common/Trace.h"                           // for TraceScope
 #include "decoders/RawDecoderException.h"           // for ThrowRDE, RawDec...
 #include "decompressors/UncompressedDecompressor.h" // for UncompressedDeco...
 #include "io/Buffer.h"                              // for Buffer
@@ -53,9 +57,66 @@ RawDecoder::RawDecoder(Buffer* file) : mRaw(RawImage::create()), mFile(file) {
   applyCrop = true;
   uncorrectedRawValues = false;
   fujiRotate = true;
+  lossyDngScale = 1;
+  allocator = nullptr;
+  binning = 1;
+  threadCount = 0;
 }
 
 void RawDecoder::decodeUncompressed(const TiffIFD *rawIFD, BitOrder order) {
+  const vector<RawSlice> slices = setUpUncompressed(rawIFD);
+  const iPoint2D fullDim = mRaw->dim;
+  const uint32 width = fullDim.x;
+
+  // Only whole rows can be skipped
+  iRectangle2D window(iPoint2D(0, 0), fullDim);
+  if (!createBinnedData())
+    window = createWindow(fullDim, iPoint2D(width, 1));
+  const uint32 windowEnd = window.getBottomRight().y;
+  // The slices may split the blocks of a binned image
+  RowBinner rows(mRaw);
+
+  uint32 offY = 0;
+  for (uint32 i = 0; i < slices.size(); i++) {
+    RawSlice slice = slices[i];
+    uint32 bitPerPixel = (int)((uint64)((uint64)slice.count * 8u) / (slice.h * width));
+    const uint32 inputPitch = width * bitPerPixel / 8;
+
+    const uint32 sliceY = offY;
+    offY += slice.h;
+
+    // Rows of the slice inside of the window
+    uint32 skip = sliceY < (uint32)window.pos.y ? window.pos.y - sliceY : 0;
+    uint32 end = min(slice.h, windowEnd > sliceY ? windowEnd - sliceY : 0);
+    if (skip >= end || (skip && (uint64)skip * inputPitch >= slice.count))
+      continue;
+
+    UncompressedDecompressor u(*mFile, slice.offset + skip * inputPitch,
+                               slice.count - skip * inputPitch, mRaw,
+                               uncorrectedRawValues);
+    iPoint2D size(width, end - skip);
+    iPoint2D pos(0, sliceY + skip - window.pos.y);
+    try {
+      u.readUncompressedRaw(size, pos, inputPitch, bitPerPixel, order, &rows);
+    } catch (RawDecoderException &e) {
+      if (i>0)
+        mRaw->setError(e.what());
+      else
+        throw;
+    } catch (IOException &e) {
+      if (i>0)
+        mRaw->setError(e.what());
+      else {
+        ThrowRDE("IO error occurred in first slice, unable to decode more. "
+                 "Error is: %s",
+                 e.what());
+      }
+    }
+  }
+  rows.finish();
+}
+
+vector<RawSlice> RawDecoder::setUpUncompressed(const TiffIFD* rawIFD) {
   uint32 nslices = rawIFD->getEntry(STRIPOFFSETS)->count;
   TiffEntry *offsets = rawIFD->getEntry(STRIPOFFSETS);
   TiffEntry *counts = rawIFD->getEntry(STRIPBYTECOUNTS);
@@ -64,13 +125,16 @@ void RawDecoder::decodeUncompressed(const TiffIFD *rawIFD, BitOrder order) {
   uint32 height = rawIFD->getEntry(IMAGELENGTH)->getU32();
   uint32 bitPerPixel = rawIFD->getEntry(BITSPERSAMPLE)->getU32();
 
+  const vector<uint32> sliceOffsets = offsets->getU32Array(nslices);
+  const vector<uint32> sliceCounts = counts->getU32Array(nslices);
+
   vector<RawSlice> slices;
   uint32 offY = 0;
 
   for (uint32 s = 0; s < nslices; s++) {
     RawSlice slice;
-    slice.offset = offsets->getU32(s);
-    slice.count = counts->getU32(s);
+    slice.offset = sliceOffsets[s];
+    slice.count = sliceCounts[s];
     if (offY + yPerSlice > height)
       slice.h = height - offY;
     else
@@ -86,36 +150,13 @@ void RawDecoder::decodeUncompressed(const TiffIFD *rawIFD, BitOrder order) {
     ThrowRDE("No valid slices found. File probably truncated.");
 
   mRaw->dim = iPoint2D(width, offY);
-  mRaw->createData();
   mRaw->whitePoint = (1<<bitPerPixel)-1;
+  return slices;
+}
 
-  offY = 0;
-  for (uint32 i = 0; i < slices.size(); i++) {
-    RawSlice slice = slices[i];
-    UncompressedDecompressor u(*mFile, slice.offset, slice.count, mRaw,
-                               uncorrectedRawValues);
-    iPoint2D size(width, slice.h);
-    iPoint2D pos(0, offY);
-    bitPerPixel = (int)((uint64)((uint64)slice.count * 8u) / (slice.h * width));
-    try {
-      u.readUncompressedRaw(size, pos, width * bitPerPixel / 8, bitPerPixel,
-                            order);
-    } catch (RawDecoderException &e) {
-      if (i>0)
-        mRaw->setError(e.what());
-      else
-        throw;
-    } catch (IOException &e) {
-      if (i>0)
-        mRaw->setError(e.what());
-      else {
-        ThrowRDE("IO error occurred in first slice, unable to decode more. "
-                 "Error is: %s",
-                 e.what());
-      }
-    }
-    offY += slice.h;
-  }
+void RawDecoder::probeUncompressed(const TiffIFD* rawIFD) {
+  setUpUncompressed(rawIFD);
+  mRaw->createWithoutData();
 }
 
 void RawDecoder::askForSamples(const CameraMetaData* meta, const string& make,
@@ -182,11 +223,12 @@ void RawDecoder::setMetaData(const CameraMetaData* meta, const string& make,
     iPoint2D new_size = cam->cropSize;
 
     // If crop size is negative, use relative cropping
+    const iPoint2D cropDim = mRaw->getFullCrop().dim;
     if (new_size.x <= 0)
-      new_size.x = mRaw->dim.x - cam->cropPos.x + new_size.x;
+      new_size.x = cropDim.x - cam->cropPos.x + new_size.x;
 
     if (new_size.y <= 0)
-      new_size.y = mRaw->dim.y - cam->cropPos.y + new_size.y;
+      new_size.y = cropDim.y - cam->cropPos.y + new_size.y;
 
     mRaw->subFrame(iRectangle2D(cam->cropPos, new_size));
 
@@ -218,7 +260,7 @@ void RawDecoder::setMetaData(const CameraMetaData* meta, const string& make,
   // (the same order as the in the CFA tag)
   // A hint could be:
   // <Hint name="override_cfa_black" value="10,20,30,20"/>
-  string cfa_black = hints.get("override_cfa_black", string());
+  string cfa_black = hints.get(HINT_OVERRIDE_CFA_BLACK, string());
   if (!cfa_black.empty()) {
     vector<string> v = splitString(cfa_black, ',');
     if (v.size() != 4) {
@@ -234,6 +276,10 @@ void RawDecoder::setMetaData(const CameraMetaData* meta, const string& make,
 
 void *RawDecoderDecodeThread(void *_this) {
   auto *me = (RawDecoderThread *)_this;
+  TraceScope trace("RawDecoder::decodeThreaded");
+  trace.setPixels((uint64)(me->end_y - me->start_y) *
+                  me->parent->mRaw->getUnbinnedDim().x);
+  DecodeCountersScope counters(&me->parent->mRaw->counters);
   try {
      me->parent->decodeThreaded(me);
   } catch (RawDecoderException &ex) {
@@ -244,62 +290,145 @@ void *RawDecoderDecodeThread(void *_this) {
   return nullptr;
 }
 
-void RawDecoder::startThreads() {
-#ifndef HAVE_PTHREAD
-  uint32 threads = 1;
-  RawDecoderThread t(this);
-  t.start_y = 0;
-  t.end_y = mRaw->dim.y;
-  RawDecoderDecodeThread(&t);
-#else
-  uint32 threads;
-  bool fail = false;
-  threads = min((unsigned)mRaw->dim.y, getThreadCount());
-  int y_offset = 0;
-  int y_per_thread = (mRaw->dim.y + threads - 1) / threads;
+void RawDecoder::startThreads(uint32 pixelCost) {
+  // Binned images are produced in whole blocks of rows, see RowBinner
+  const iPoint2D dim = mRaw->getUnbinnedDim();
+  const uint32 block = mRaw->getBinningBlock();
+  const WorkSplit split =
+      splitWork("RawDecoder::startThreads", (dim.y + block - 1) / block,
+                (uint64)dim.x * mRaw->getCpp() * pixelCost * block,
+                getThreadCount(threadCount));
+  uint32 threads = split.threads;
+
+  // Not worth starting any threads
+  if (threads == 1) {
+    RawDecoderThread t(this);
+    t.start_y = 0;
+    t.end_y = dim.y;
+    RawDecoderDecodeThread(&t);
+  } else {
+#ifdef HAVE_PTHREAD
+    bool fail = false;
+    int y_offset = 0;
+    int y_per_thread = split.itemsPerThread * block;
 
-  vector<RawDecoderThread> t(threads, RawDecoderThread(this));
+    vector<RawDecoderThread> t(threads, RawDecoderThread(this));
 
-  /* Initialize and set thread detached attribute */
-  pthread_attr_t attr;
-  pthread_attr_init(&attr);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+    /* Initialize and set thread detached attribute */
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
-  for (uint32 i = 0; i < threads; i++) {
-    t[i].start_y = y_offset;
-    t[i].end_y = min(y_offset + y_per_thread, mRaw->dim.y);
-    if (pthread_create(&t[i].threadid, &attr, RawDecoderDecodeThread, &t[i]) != 0) {
-      // If a failure occurs, we need to wait for the already created threads to finish
-      threads = i-1;
-      fail = true;
+    for (uint32 i = 0; i < threads; i++) {
+      t[i].start_y = y_offset;
+      t[i].end_y = min(y_offset + y_per_thread, dim.y);
+      if (pthread_create(&t[i].threadid, &attr, RawDecoderDecodeThread, &t[i]) != 0) {
+        // If a failure occurs, we need to wait for the already created threads to finish
+        threads = i-1;
+        fail = true;
+      }
+      y_offset = t[i].end_y;
     }
-    y_offset = t[i].end_y;
-  }
 
-  for (uint32 i = 0; i < threads; i++) {
-    pthread_join(t[i].threadid, nullptr);
-  }
-  pthread_attr_destroy(&attr);
+    for (uint32 i = 0; i < threads; i++) {
+      pthread_join(t[i].threadid, nullptr);
+    }
+    pthread_attr_destroy(&attr);
 
-  if (fail) {
-    ThrowRDE("Unable to start threads");
-  }
+    if (fail) {
+      ThrowRDE("Unable to start threads");
+    }
 #endif
+  }
 
   if (mRaw->errors.size() >= threads)
     ThrowRDE("All threads reported errors. Cannot load image.");
 }
 
+// Start of the window at pos, at a multiple of grain that is even
+static int windowStart(int pos, int grain) {
+  int start = pos - pos % grain;
+  if (start & 1)
+    start -= grain;
+  return start;
+}
+
+iRectangle2D RawDecoder::createWindow(const iPoint2D& fullDim,
+                                      const iPoint2D& grain) {
+  if (grain.x <= 0 || grain.y <= 0)
+    ThrowRDE("Invalid tile or strip size %d x %d", grain.x, grain.y);
+
+  iRectangle2D window(iPoint2D(0, 0), fullDim);
+
+  if (roi.hasPositiveArea()) {
+    const iRectangle2D wanted = roi.getOverlap(window);
+    if (!wanted.hasPositiveArea())
+      ThrowRDE("Region of interest is outside of the image.");
+    const iPoint2D br = wanted.getBottomRight();
+    window.setAbsolute(windowStart(wanted.pos.x, grain.x),
+                       windowStart(wanted.pos.y, grain.y),
+                       min((int)roundUp(br.x, grain.x), fullDim.x),
+                       min((int)roundUp(br.y, grain.y), fullDim.y));
+  }
+
+  mRaw->dim = window.dim;
+  mRaw->createData();
+  mRaw->setWindow(window, fullDim);
+  return window;
+}
+
+bool RawDecoder::createBinnedData() {
+  if (binning == 1 || roi.hasPositiveArea())
+    return false;
+
+  mRaw->setBinning(binning);
+  mRaw->createData();
+  return true;
+}
+
+void RawDecoder::decodeBlackAreas(const iRectangle2D& rect) {
+  TraceScope trace("RawDecoder::decodeBlackAreas");
+  RawImage image = mRaw;
+  const iRectangle2D imageRoi = roi;
+  RawImageAllocator* imageAllocator = allocator;
+
+  // A window of its own, the allocator is for the image only
+  roi = rect;
+  allocator = nullptr;
+  mRaw = RawImage::create(image->getDataType());
+  mRaw->threadCount = threadCount;
+  try {
+    RawImage black = decodeRawInternal();
+    image->calculateBlackAreasFrom(black.get());
+  } catch (RawspeedException& e) {
+    // The black level is then estimated from the image, as before
+    image->setError(e.what());
+  }
+
+  mRaw = image;
+  roi = imageRoi;
+  allocator = imageAllocator;
+}
+
 void RawDecoder::decodeThreaded(RawDecoderThread * t) {
   ThrowRDE("This class does not support threaded decoding");
 }
 
 RawSpeed::RawImage RawDecoder::decodeRaw()
 {
+  TraceScope trace("RawDecoder::decodeRaw");
+  // decodeRawInternal() may replace mRaw, the threads count into the new one
+  DecodeCountersScope counters;
   try {
+    mRaw->setAllocator(allocator);
+    mRaw->threadCount = threadCount;
     RawImage raw = decodeRawInternal();
+    counters.setTarget(&raw->counters);
+    trace.setBytes(mFile->getSize());
+    trace.setPixels(raw->dim.area());
+    raw->threadCount = threadCount;
     raw->metadata.pixelAspectRatio =
-        hints.get("pixel_aspect_ratio", raw->metadata.pixelAspectRatio);
+        hints.get(HINT_PIXEL_ASPECT_RATIO, raw->metadata.pixelAspectRatio);
     if (interpolateBadPixels)
       raw->fixBadPixels();
     return raw;
@@ -314,8 +443,26 @@ RawSpeed::RawImage RawDecoder::decodeRaw()
 }
 
 void RawDecoder::decodeMetaData(const CameraMetaData* meta) {
+  TraceScope trace("RawDecoder::decodeMetaData");
   try {
-    return decodeMetaDataInternal(meta);
+    decodeMetaDataInternal(meta);
+
+    // The black areas are usually outside of a region of interest, but the
+    // black levels have to be the same as for the whole image
+    if (mRaw->blackLevelSeparate[0] < 0) {
+      const iRectangle2D blackRect = mRaw->getBlackAreasRect();
+      if (blackRect.hasPositiveArea())
+        decodeBlackAreas(blackRect);
+    }
+    mRaw->applyWindow();
+
+    // Unless the decoder has binned the image already
+    if (binning > 1 && mRaw->getBinning() == 1) {
+      // The black areas are outside of the binned image
+      if (mRaw->blackLevelSeparate[0] < 0 && !mRaw->blackAreas.empty())
+        mRaw->calculateBlackAreas();
+      mRaw->bin(binning);
+    }
   } catch (TiffParserException &e) {
     ThrowRDE("%s", e.what());
   } catch (FileIOException &e) {
@@ -325,6 +472,29 @@ void RawDecoder::decodeMetaData(const CameraMetaData* meta) {
   }
 }
 
+void RawDecoder::probeRawInternal() {
+  ThrowRDE("Metadata only decoding is not supported for this format.");
+}
+
+RawImage RawDecoder::probeMetadata(const CameraMetaData* meta) {
+  try {
+    probeRawInternal();
+    decodeMetaDataInternal(meta);
+    mRaw->metadata.pixelAspectRatio =
+        hints.get(HINT_PIXEL_ASPECT_RATIO, mRaw->metadata.pixelAspectRatio);
+  } catch (TiffParserException &e) {
+    ThrowRDE("%s", e.what());
+  } catch (FileIOException &e) {
+    ThrowRDE("%s", e.what());
+  } catch (IOException &e) {
+    ThrowRDE("%s", e.what());
+  }
+
+  if (mRaw->isAllocated())
+    ThrowRDE("Image data was allocated while probing metadata.");
+  return mRaw;
+}
+
 void RawDecoder::checkSupport(const CameraMetaData* meta) {
   try {
     return checkSupportInternal(meta);
@@ -340,7 +510,7 @@ void RawDecoder::checkSupport(const CameraMetaData* meta) {
 void RawDecoder::startTasks( uint32 tasks )
 {
   uint32 threads;
-  threads = min(tasks, getThreadCount());
+  threads = min(tasks, getThreadCount(threadCount));
   int ctask = 0;
   vector<RawDecoderThread> t(threads, RawDecoderThread(this));
 
@@ -27,6 +27,7 @@
 #include "common/RawImage.h"  // for RawImage
 #include "metadata/Camera.h"  // for Hints
 #include <string>             // for string
+#include <vector>             // for vector
 
 #ifdef HAVE_PTHREAD
 #include <pthread.h>
@@ -42,6 +43,8 @@ class TiffIFD;
 
 class RawDecoder;
 
+class RawSlice;
+
 /* Class with information delivered to RawDecoder::decodeThreaded() */
 class RawDecoderThread
 {
@@ -88,6 +91,16 @@ public:
   /* compensation is not expected to be applied to the image */
   void decodeMetaData(const CameraMetaData* meta);
 
+  /* Only retrieve the metadata (make, model, ISO, white balance), CFA, */
+  /* crop and black/white levels, from the file headers and the camera */
+  /* database. Use this instead of decodeRaw() and decodeMetaData(). */
+  /* The returned image has the dimensions and crop of the raw image, but */
+  /* no data is allocated, and the image data in the file is never read. */
+  /* Levels are those of the data as stored, before any corrections */
+  /* decodeRaw() may apply to it. checkSupport() must have been called. */
+  /* A RawDecoderException will be thrown if the format can not do this. */
+  RawImage probeMetadata(const CameraMetaData* meta);
+
   /* Called function for filters that are capable of doing simple multi-threaded decode */
   /* The delivered class gives information on what part of the image should be decoded. */
   [[noreturn]] virtual void decodeThreaded(RawDecoderThread* t);
@@ -127,6 +140,45 @@ public:
   /* Should Fuji images be rotated? */
   bool fujiRotate;
 
+  /* Decode lossy (JPEG compressed) DNGs at 1/2, 1/4 or 1/8 resolution. */
+  /* libjpeg then only does the reduced IDCT, which is much faster when */
+  /* only a preview is needed. Dimensions and crop are scaled to match, */
+  /* DNG opcodes (given in full resolution coordinates) are not applied. */
+  /* Must be 1 (default), 2, 4 or 8. Has no effect on other images. */
+  uint32 lossyDngScale;
+
+  /* Decode into memory provided by the host application, instead of */
+  /* letting RawSpeed allocate (and own) the image data. */
+  /* Some decoders allocate a second image (e.g. rotated Fuji images), */
+  /* then the first buffer is released once it is no longer referenced. */
+  /* Set to NULL (default) to use the internal allocation. */
+  RawImageAllocator* allocator;
+
+  /* Only decode this region of interest (in uncropped image coordinates). */
+  /* Decoders that can address their data by region (tiled and striped */
+  /* DNG, uncompressed strips, ARW2) skip everything outside of it, and */
+  /* only allocate this window, widened to what can be decoded on its own */
+  /* (e.g. whole tiles). Crop, CFA and black areas are moved to the window */
+  /* by decodeMetaData(). Black areas outside of it are decoded on their */
+  /* own first, so the black levels are the same as for the whole image. */
+  /* Other decoders always decode the whole image. */
+  /* Leave empty (default) to decode the whole image. */
+  iRectangle2D roi;
+
+  /* Bin the image 2x2 or 4x4 (keeping a 2x2 CFA), for fast previews. */
+  /* Uncompressed strips, ARW2 (8 bit), RW2 and ARI are binned while they */
+  /* are decoded, so the full resolution image is never allocated, and */
+  /* every pass works on the binned image. Other decoders, and all of them */
+  /* if a roi is set, bin the cropped image in decodeMetaData(), after */
+  /* the bad pixels were fixed and the black levels were calculated from */
+  /* the black areas. Must be 1 (default), 2 or 4. */
+  uint32 binning;
+
+  /* Number of threads used to decode and process this image. */
+  /* 0 (default) uses getThreadCount(), which the host can define, */
+  /* and which otherwise respects CPU affinity and cgroup CPU quotas. */
+  uint32 threadCount;
+
   /* Retrieve the main RAW chunk */
   /* Returns NULL if unknown */
   virtual Buffer* getCompressedData() { return nullptr; }
@@ -140,11 +192,18 @@ protected:
   virtual void decodeMetaDataInternal(const CameraMetaData* meta) = 0;
   virtual void checkSupportInternal(const CameraMetaData* meta) = 0;
 
+  /* Set up mRaw like decodeRawInternal(), but from the file headers only, */
+  /* calling createWithoutData() where it would allocate the image. */
+  /* Decoders that support probeMetadata() must override this. */
+  [[noreturn]] virtual void probeRawInternal();
+
   /* Helper function for decoders - splits the image vertically and starts of decoder threads */
   /* The function returns when all threads are done */
   /* All errors are silently pushed into the "errors" array.*/
   /* If all threads report an error an exception will be thrown*/
-  void startThreads();
+  /* pixelCost is the estimated time to decode one pixel (component), in */
+  /* ns, from which it picks how many threads are worth starting. */
+  void startThreads(uint32 pixelCost);
 
   /* Helper function for decoders -  */
   /* The function returns when all tasks are done */
@@ -152,6 +211,24 @@ protected:
   /* If all threads report an error an exception will be thrown*/
   void startTasks(uint32 tasks);
 
+  /* Helper function for decoders - allocates mRaw for the region of */
+  /* interest of an image of size fullDim, widened to multiples of grain */
+  /* (but starting on an even position, so the CFA is not changed), or for */
+  /* the whole image if none was set. Returns the window allocated. */
+  iRectangle2D createWindow(const iPoint2D& fullDim, const iPoint2D& grain);
+
+  /* Helper function for decoders producing their rows through RowBinner - */
+  /* allocates mRaw for mRaw->dim binned by binning. Returns false without */
+  /* allocating anything if no binning or a region of interest was asked */
+  /* for, the image is then allocated (and binned) as usual. */
+  bool createBinnedData();
+
+  /* Decodes the part rect of the image on its own, and calculates the */
+  /* black levels of mRaw, holding a region of interest, from its black */
+  /* areas. Uses decodeRawInternal(), so it must be possible to call that */
+  /* again. */
+  void decodeBlackAreas(const iRectangle2D& rect);
+
   /* Ask for sample submisson, if makes sense */
   void askForSamples(const CameraMetaData* meta, const std::string& make,
                      const std::string& model, const std::string& mode) const;
@@ -172,6 +249,13 @@ protected:
   /* order: Order of the bits - see Common.h for possibilities. */
   void decodeUncompressed(const TiffIFD* rawIFD, BitOrder order);
 
+  /* Sets up mRaw like decodeUncompressed() does, for probeRawInternal() */
+  void probeUncompressed(const TiffIFD* rawIFD);
+
+  /* Reads the strips of an uncompressed image, and sets the full size and */
+  /* white point of mRaw. Only the strips within the file are returned. */
+  std::vector<RawSlice> setUpUncompressed(const TiffIFD* rawIFD);
+
   /* The Raw input file to be decoded */
   Buffer* mFile;
 
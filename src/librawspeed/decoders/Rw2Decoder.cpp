@@ -23,6 +23,7 @@
 #include "decoders/Rw2Decoder.h"
 #include "common/Common.h"                          // for uint32, uchar8
 #include "common/Point.h"                           // for iPoint2D
+#include "common/RowBinner.h"                       // for RowBinner
 #include "decoders/RawDecoder.h"                    // for RawDecoderThread
 #include "decoders/RawDecoderException.h"           // for RawDecoderExcept...
 #include "decompressors/UncompressedDecompressor.h" // for UncompressedDeco...
@@ -94,8 +95,7 @@ struct PanaBitpump
   }
 };
 
-RawImage Rw2Decoder::decodeRawInternal() {
-
+bool Rw2Decoder::setUpImage() {
   const TiffIFD* raw = nullptr;
   bool isOldPanasonic = ! mRootIFD->hasEntryRecursive(PANASONIC_STRIPOFFSET);
 
@@ -107,28 +107,39 @@ RawImage Rw2Decoder::decodeRawInternal() {
   uint32 height = raw->getEntry((TiffTag)3)->getU16();
   uint32 width = raw->getEntry((TiffTag)2)->getU16();
 
-  if (isOldPanasonic) {
-    TiffEntry *offsets = raw->getEntry(STRIPOFFSETS);
+  TiffEntry *offsets =
+      raw->getEntry(isOldPanasonic ? STRIPOFFSETS : PANASONIC_STRIPOFFSET);
 
-    if (offsets->count != 1) {
-      ThrowRDE("Multiple Strips found: %u", offsets->count);
-    }
-    offset = offsets->getU32();
-    if (!mFile->isValid(offset))
-      ThrowRDE("Invalid image data offset, cannot decode.");
+  if (offsets->count != 1) {
+    ThrowRDE("Multiple Strips found: %u", offsets->count);
+  }
 
-    mRaw->dim = iPoint2D(width, height);
-    mRaw->createData();
+  offset = offsets->getU32();
+
+  if (!mFile->isValid(offset))
+    ThrowRDE("Invalid image data offset, cannot decode.");
 
+  mRaw->dim = iPoint2D(width, height);
+  return isOldPanasonic;
+}
+
+RawImage Rw2Decoder::decodeRawInternal() {
+  bool isOldPanasonic = setUpImage();
+
+  if (isOldPanasonic) {
+    const uint32 width = mRaw->dim.x;
+    const uint32 height = mRaw->dim.y;
     uint32 size = mFile->getSize() - offset;
 
     UncompressedDecompressor u(ByteStream(mFile, offset), mRaw, uncorrectedRawValues);
 
     if (size >= width*height*2) {
       // It's completely unpacked little-endian
+      mRaw->createData();
       u.decode12BitRawUnpacked(width, height);
     } else if (size >= width*height*3/2) {
       // It's a packed format
+      mRaw->createData();
       u.decode12BitRawWithControl(width, height);
     } else {
       // It's using the new .RW2 decoding method
@@ -136,20 +147,6 @@ RawImage Rw2Decoder::decodeRawInternal() {
       DecodeRw2();
     }
   } else {
-
-    mRaw->dim = iPoint2D(width, height);
-    mRaw->createData();
-    TiffEntry *offsets = raw->getEntry(PANASONIC_STRIPOFFSET);
-
-    if (offsets->count != 1) {
-      ThrowRDE("Multiple Strips found: %u", offsets->count);
-    }
-
-    offset = offsets->getU32();
-
-    if (!mFile->isValid(offset))
-      ThrowRDE("Invalid image data offset, cannot decode.");
-
     load_flags = 0x2008;
     DecodeRw2();
   }
@@ -157,16 +154,29 @@ RawImage Rw2Decoder::decodeRawInternal() {
   return mRaw;
 }
 
+void Rw2Decoder::probeRawInternal() {
+  setUpImage();
+  mRaw->createWithoutData();
+}
+
 void Rw2Decoder::DecodeRw2() {
-  startThreads();
+  // The threads mark zero pixels straight in the bad pixel map. A binned
+  // image has no positions for them, they are averaged in.
+  if (!createBinnedData()) {
+    mRaw->createData();
+    if (!hints.has(HINT_ZERO_IS_NOT_BAD))
+      mRaw->createBadPixelMap();
+  }
+  startThreads(6); // bit packed blocks, ~6 ns per pixel
 }
 
 void Rw2Decoder::decodeThreaded(RawDecoderThread * t) {
   int x, i, j, sh = 0, pred[2], nonz[2];
-  int w = mRaw->dim.x / 14;
+  int w = mRaw->getUnbinnedDim().x / 14;
   uint32 y;
 
-  bool zero_is_bad = ! hints.has("zero_is_not_bad");
+  bool zero_is_bad =
+      !hints.has(HINT_ZERO_IS_NOT_BAD) && mRaw->getBinning() == 1;
 
   /* 9 + 1/7 bits per pixel */
   int skip = w * 14 * t->start_y * 9;
@@ -176,9 +186,9 @@ void Rw2Decoder::decodeThreaded(RawDecoderThread * t) {
   PanaBitpump bits(ByteStream(mFile, offset), load_flags);
   bits.skipBytes(skip);
 
-  vector<uint32> zero_pos;
+  RowBinner rows(mRaw);
   for (y = t->start_y; y < t->end_y; y++) {
-    auto *dest = (ushort16 *)mRaw->getData(0, y);
+    auto *dest = (ushort16 *)rows.getRow(y);
     for (x = 0; x < w; x++) {
       pred[0] = pred[1] = nonz[0] = nonz[1] = 0;
       int u = 0;
@@ -199,7 +209,7 @@ void Rw2Decoder::decodeThreaded(RawDecoderThread * t) {
           pred[0] = nonz[0] << 4 | bits.getBits(4);
         *dest++ = pred[0];
         if (zero_is_bad && 0 == pred[0])
-          zero_pos.push_back((y<<16) | (x*14+i));
+          mRaw->markBadPixel(x * 14 + i, y);
 
         // Odd pixels
         i++;
@@ -219,20 +229,12 @@ void Rw2Decoder::decodeThreaded(RawDecoderThread * t) {
           pred[1] = nonz[1] << 4 | bits.getBits(4);
         *dest++ = pred[1];
         if (zero_is_bad && 0 == pred[1])
-          zero_pos.push_back((y<<16) | (x*14+i));
+          mRaw->markBadPixel(x * 14 + i, y);
         u++;
       }
     }
   }
-  if (zero_is_bad && !zero_pos.empty()) {
-#ifdef HAVE_PTHREAD
-    pthread_mutex_lock(&mRaw->mBadPixelMutex);
-#endif
-    mRaw->mBadPixelPositions.insert(mRaw->mBadPixelPositions.end(), zero_pos.begin(), zero_pos.end());
-#ifdef HAVE_PTHREAD
-    pthread_mutex_unlock(&mRaw->mBadPixelMutex);
-#endif
-  }
+  rows.finish();
 }
 
 void Rw2Decoder::checkSupportInternal(const CameraMetaData* meta) {
@@ -43,6 +43,7 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   void checkSupportInternal(const CameraMetaData* meta) override;
 
@@ -51,6 +52,9 @@ protected:
   void decodeThreaded(RawDecoderThread *t) override;
 
 private:
+  // Checks the strip, remembers its offset and sets the image size. Returns
+  // whether this is an old Panasonic file, with regular TIFF strips.
+  bool setUpImage();
   void DecodeRw2();
   std::string guessMode();
   uint32 offset = 0;
@@ -44,65 +44,84 @@ using namespace std;
 
 namespace RawSpeed {
 
-RawImage SrwDecoder::decodeRawInternal() {
+SrwDecoder::SrwType SrwDecoder::setUpImage(const TiffIFD** rawIFD) {
   auto raw = mRootIFD->getIFDWithTag(STRIPOFFSETS);
+  *rawIFD = raw;
 
   int compression = raw->getEntry(COMPRESSION)->getU32();
-  int bits = raw->getEntry(BITSPERSAMPLE)->getU32();
 
   if (32769 != compression && 32770 != compression && 32772 != compression && 32773 != compression)
     ThrowRDE("Unsupported compression");
 
-  if (32769 == compression)
-  {
-    bool bit_order = hints.get("msb_override", false);
-    this->decodeUncompressed(raw, bit_order ? BitOrder_Jpeg : BitOrder_Plain);
-    return mRaw;
+  if (32769 == compression ||
+      (32770 == compression && !raw->hasEntry((TiffTag)40976))) {
+    setUpUncompressed(raw);
+    return SRW_UNCOMPRESSED;
   }
 
-  if (32770 == compression)
-  {
-    if (!raw->hasEntry ((TiffTag)40976)) {
-      bool bit_order = hints.get("msb_override", bits == 12);
-      this->decodeUncompressed(raw, bit_order ? BitOrder_Jpeg : BitOrder_Plain);
-      return mRaw;
-    }
+  if (32773 != compression) {
     uint32 nslices = raw->getEntry(STRIPOFFSETS)->count;
     if (nslices != 1)
       ThrowRDE("Only one slice supported, found %u", nslices);
+  }
+
+  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
+  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
+  mRaw->dim = iPoint2D(width, height);
+
+  if (32770 == compression)
+    return SRW_COMPRESSED;
+  if (32772 == compression)
+    return SRW_COMPRESSED2;
+  return SRW_COMPRESSED3;
+}
+
+RawImage SrwDecoder::decodeRawInternal() {
+  const TiffIFD* raw = nullptr;
+  const SrwType type = setUpImage(&raw);
+
+  int compression = raw->getEntry(COMPRESSION)->getU32();
+  int bits = raw->getEntry(BITSPERSAMPLE)->getU32();
+
+  switch (type) {
+  case SRW_UNCOMPRESSED: {
+    bool bit_order =
+        hints.get(HINT_MSB_OVERRIDE, 32770 == compression && bits == 12);
+    this->decodeUncompressed(raw, bit_order ? BitOrder_Jpeg : BitOrder_Plain);
+    break;
+  }
+  case SRW_COMPRESSED:
     try {
       decodeCompressed(raw);
     } catch (RawDecoderException& e) {
       mRaw->setError(e.what());
     }
-    return mRaw;
-  }
-  if (32772 == compression)
-  {
-    uint32 nslices = raw->getEntry(STRIPOFFSETS)->count;
-    if (nslices != 1)
-      ThrowRDE("Only one slice supported, found %u", nslices);
+    break;
+  case SRW_COMPRESSED2:
     try {
       decodeCompressed2(raw, bits);
     } catch (RawDecoderException& e) {
       mRaw->setError(e.what());
     }
-    return mRaw;
-  }
-  if (32773 == compression)
-  {
+    break;
+  case SRW_COMPRESSED3:
     decodeCompressed3(raw, bits);
-    return mRaw;
+    break;
   }
-  ThrowRDE("Unsupported compression");
   return mRaw;
 }
+
+void SrwDecoder::probeRawInternal() {
+  const TiffIFD* raw = nullptr;
+  setUpImage(&raw);
+  mRaw->createWithoutData();
+}
+
 // Decoder for compressed srw files (NX300 and later)
 void SrwDecoder::decodeCompressed( const TiffIFD* raw )
 {
-  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
-  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
-  mRaw->dim = iPoint2D(width, height);
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
   mRaw->createData();
   const uint32 offset = raw->getEntry(STRIPOFFSETS)->getU32();
   uint32 compressed_offset = raw->getEntry((TiffTag)40976)->getU32();
@@ -211,11 +230,10 @@ static int32 samsungDiff(BitPumpMSB& pump, vector<encTableItem> tbl);
 // Decoder for compressed srw files (NX3000 and later)
 void SrwDecoder::decodeCompressed2( const TiffIFD* raw, int bits)
 {
-  uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
-  uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
+  const uint32 width = mRaw->dim.x;
+  const uint32 height = mRaw->dim.y;
   uint32 offset = raw->getEntry(STRIPOFFSETS)->getU32();
 
-  mRaw->dim = iPoint2D(width, height);
   mRaw->createData();
 
   // This format has a variable length encoding of how many bits are needed
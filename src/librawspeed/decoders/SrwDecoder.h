@@ -40,11 +40,21 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
   void checkSupportInternal(const CameraMetaData* meta) override;
 
 private:
   int getDecoderVersion() const override { return 3; }
+  // How the raw data of an SRW is stored
+  enum SrwType {
+    SRW_UNCOMPRESSED,
+    SRW_COMPRESSED,  // NX300 and later
+    SRW_COMPRESSED2, // NX3000 and later
+    SRW_COMPRESSED3  // NX1
+  };
+  // Checks the headers and sets the image size. Returns the raw IFD.
+  SrwType setUpImage(const TiffIFD** rawIFD);
   void decodeCompressed(const TiffIFD* raw);
   void decodeCompressed2(const TiffIFD* raw, int bits);
   void decodeCompressed3(const TiffIFD* raw, int bits);
@@ -37,17 +37,21 @@ namespace RawSpeed {
 
 class CameraMetaData;
 
-RawImage ThreefrDecoder::decodeRawInternal() {
+uint32 ThreefrDecoder::setUpImage() {
   auto raw = mRootIFD->getIFDWithTag(STRIPOFFSETS, 1);
   uint32 width = raw->getEntry(IMAGEWIDTH)->getU32();
   uint32 height = raw->getEntry(IMAGELENGTH)->getU32();
-  uint32 off = raw->getEntry(STRIPOFFSETS)->getU32();
 
   mRaw->dim = iPoint2D(width, height);
+  return raw->getEntry(STRIPOFFSETS)->getU32();
+}
+
+RawImage ThreefrDecoder::decodeRawInternal() {
+  uint32 off = setUpImage();
   mRaw->createData();
 
   HasselbladDecompressor l(*mFile, off, mRaw);
-  int pixelBaseOffset = hints.get("pixelBaseOffset", 0);
+  int pixelBaseOffset = hints.get(HINT_PIXEL_BASE_OFFSET, 0);
 
   try {
     l.decode(pixelBaseOffset);
@@ -59,6 +63,11 @@ RawImage ThreefrDecoder::decodeRawInternal() {
   return mRaw;
 }
 
+void ThreefrDecoder::probeRawInternal() {
+  setUpImage();
+  mRaw->createWithoutData();
+}
+
 void ThreefrDecoder::decodeMetaDataInternal(const CameraMetaData* meta) {
   mRaw->cfa.setCFA(iPoint2D(2,2), CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE);
 
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include "common/Common.h"                // for uint32
 #include "common/RawImage.h"              // for RawImage
 #include "decoders/AbstractTiffDecoder.h" // for AbstractTiffDecoder
 #include "tiff/TiffIFD.h"                 // for TiffRootIFDOwner
@@ -40,10 +41,15 @@ public:
       : AbstractTiffDecoder(move(root), file) {}
 
   RawImage decodeRawInternal() override;
+  void probeRawInternal() override;
   void decodeMetaDataInternal(const CameraMetaData* meta) override;
 
 protected:
   int getDecoderVersion() const override { return 0; }
+
+private:
+  // Sets the image size and returns the offset of the raw data
+  uint32 setUpImage();
 };
 
 } // namespace RawSpeed
@@ -36,6 +36,7 @@
 #include <istream>                        // for basic_istream::operator>>
 #include <map>                            // for map, _Rb_tree_iterator
 #include <memory>                         // for unique_ptr
+#include <sstream>                        // for istringstream
 #include <string>                         // for string
 #include <utility>                        // for pair
 #include <vector>                         // for vector
@@ -298,7 +299,7 @@ void X3fDecoder::decompressSigma( X3fImage &image )
     for (int y = 0; y < mRaw->dim.y; y++) {
       line_offsets[y] = i2.getU32() + input.getPosition() + image.dataOffset;
     }
-    startThreads();
+    startThreads(10); // huffman decoding, ~10 ns per pixel
     return;
   }
   ThrowRDE("Unable to find decoder for format: %d", image.format);
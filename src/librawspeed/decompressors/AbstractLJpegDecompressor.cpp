@@ -52,6 +52,27 @@ void AbstractLJpegDecompressor::decode() {
   } while (m != M_EOI);
 }
 
+void AbstractLJpegDecompressor::parseFrameHeader() {
+  if (getNextMarker(false) != M_SOI)
+    ThrowRDE("Image did not start with SOI. Probably not an LJPEG");
+
+  JpegMarker m;
+  do {
+    m = getNextMarker(true);
+
+    switch (m) {
+    case M_DHT:  parseDHT(); break;
+    case M_SOF3: parseSOF(&frame); return;
+    case M_DQT:
+      ThrowRDE("Not a valid RAW file.");
+    default:  // Just let it skip to next marker
+      break;
+    }
+  } while (m != M_EOI);
+
+  ThrowRDE("No frame header found.");
+}
+
 void AbstractLJpegDecompressor::parseSOF(SOFInfo* sof) {
   uint32 headerLength = input.getU16();
   sof->prec = input.getByte();
@@ -147,6 +147,10 @@ public:
       : AbstractLJpegDecompressor(data, offset, data.getSize() - offset, img) {}
   virtual ~AbstractLJpegDecompressor() = default;
 
+  // Reads the markers up to the frame header, which sets the subsampling of
+  // the image. Nothing is decoded, the image needs no data.
+  void parseFrameHeader();
+
 protected:
   bool fixDng16Bug = false;  // DNG v1.0.x compatibility
   bool fullDecodeHT = true;  // FullDecode Huffman
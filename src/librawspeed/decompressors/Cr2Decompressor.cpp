@@ -22,6 +22,7 @@
 #include "decompressors/Cr2Decompressor.h"
 #include "common/Common.h"                // for unroll_loop, uint32, ushort16
 #include "common/Point.h"                 // for iPoint2D
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "io/BitPumpJPEG.h"               // for BitStream<>::getBufferPosi...
 #include "io/ByteStream.h"                // for ByteStream
@@ -79,8 +80,11 @@ void Cr2Decompressor::decodeScan()
 
 void Cr2Decompressor::decode(std::vector<int> slicesWidths_)
 {
+  TraceScope trace("Cr2Decompressor::decode");
   slicesWidths = move(slicesWidths_);
   AbstractLJpegDecompressor::decode();
+  trace.setBytes(input.getPosition());
+  trace.setPixels(mRaw->dim.area());
 }
 
 // N_COMP == number of components (2, 3 or 4)
@@ -25,9 +25,19 @@
 #include "decompressors/DeflateDecompressor.h"
 #include "common/Common.h"                // for uint32, ushort16
 #include "common/Point.h"                 // for iPoint2D
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "io/Endianness.h"                // for getHostEndianness, Endiann...
 #include <cstdio>                         // for size_t
+#include <cstring>                        // for memcpy
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // for __m128i, _mm_storeu_si128, _mm_loadu_si128
+#endif
+
+#if defined(__F16C__)
+#include <immintrin.h> // for _mm_cvtph_ps, _mm_storeu_ps, _cvtsh_ss
+#endif
 
 extern "C" {
 #include <zlib.h>
@@ -38,32 +48,188 @@ using namespace std;
 
 namespace RawSpeed {
 
+#if defined(__SSE2__)
+// Generic conversion of four small floats (sign, ExpBits exponent with the
+// usual IEEE-754 bias, FracBits fraction) held in the low bits of each 32-bit
+// lane into binary32. Subnormals are renormalized by the FPU: they are given
+// the smallest normal exponent and that implicit one is then subtracted again,
+// which is exact, so the result is bit-identical to the scalar code below.
+template <int ExpBits, int FracBits>
+static inline __m128i smallFloatToFloat_SSE2(__m128i in) {
+  const int bias = (1 << (ExpBits - 1)) - 1;
+  const int maxExp = (1 << ExpBits) - 1;
+
+  const __m128i noSignMask = _mm_set1_epi32((1 << (ExpBits + FracBits)) - 1);
+  const __m128i signMask = _mm_set1_epi32(1 << (ExpBits + FracBits));
+  const __m128i expMask = _mm_set1_epi32(maxExp << 23);
+  const __m128i expAdjust = _mm_set1_epi32((127 - bias) << 23);
+  const __m128i infNaNAdjust = _mm_set1_epi32((255 - maxExp - (127 - bias))
+                                              << 23);
+  const __m128i one = _mm_set1_epi32(1 << 23);
+  const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((127 - bias + 1) << 23));
+
+  __m128i out = _mm_slli_epi32(_mm_and_si128(in, noSignMask), 23 - FracBits);
+  const __m128i exp = _mm_and_si128(out, expMask);
+  out = _mm_add_epi32(out, expAdjust);
+
+  // exp = max: Infinity or NaN
+  const __m128i isInfNaN = _mm_cmpeq_epi32(exp, expMask);
+  out = _mm_add_epi32(out, _mm_and_si128(isInfNaN, infNaNAdjust));
+
+  // exp = 0: zero or subnormal
+  const __m128i isDenorm = _mm_cmpeq_epi32(exp, _mm_setzero_si128());
+  const __m128i denorm = _mm_castps_si128(
+      _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(out, one)), magic));
+  out = _mm_or_si128(_mm_andnot_si128(isDenorm, out),
+                     _mm_and_si128(isDenorm, denorm));
+
+  const __m128i sign = _mm_slli_epi32(_mm_and_si128(in, signMask),
+                                      31 - (ExpBits + FracBits));
+  return _mm_or_si128(out, sign);
+}
+
+// Running sum of bytes with a stride of 'factor' bytes inside one register.
+template <int factor> static inline __m128i prefixSumBytes(__m128i v) {
+  v = _mm_add_epi8(v, _mm_slli_si128(v, factor));
+  if (factor < 2)
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+  if (factor < 4)
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+  return _mm_add_epi8(v, _mm_slli_si128(v, 8));
+}
+
+// The last 'factor' already-decoded bytes, repeated over the whole register.
+template <int factor>
+static inline __m128i broadcastCarry(const unsigned char* src) {
+  switch (factor) {
+  case 1:
+    return _mm_set1_epi8(src[0]);
+  case 2: {
+    ushort16 v;
+    memcpy(&v, src, sizeof(v));
+    return _mm_set1_epi16(v);
+  }
+  default: {
+    uint32 v;
+    memcpy(&v, src, sizeof(v));
+    return _mm_set1_epi32(v);
+  }
+  }
+}
+
+template <int factor>
+static inline size_t decodeDeltaBytes_SSE2(unsigned char* src, size_t len) {
+  size_t col = factor;
+  for (; col + 16 <= len; col += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)&src[col]);
+    v = _mm_add_epi8(prefixSumBytes<factor>(v),
+                     broadcastCarry<factor>(&src[col - factor]));
+    _mm_storeu_si128((__m128i*)&src[col], v);
+  }
+  return col;
+}
+#endif
+
+static inline void decodeDeltaBytes(unsigned char* src, size_t len,
+                                    int factor) {
+  size_t col = factor;
+#if defined(__SSE2__)
+  switch (factor) {
+  case 1:
+    col = decodeDeltaBytes_SSE2<1>(src, len);
+    break;
+  case 2:
+    col = decodeDeltaBytes_SSE2<2>(src, len);
+    break;
+  case 4:
+    col = decodeDeltaBytes_SSE2<4>(src, len);
+    break;
+  default:
+    break;
+  }
+#endif
+  for (; col < len; ++col) {
+    src[col] += src[col - factor];
+  }
+}
+
 // decodeFPDeltaRow(): MIT License, copyright 2014 Javier Celaya
 // <jcelaya@gmail.com>
+// Note: for 24-bit data the output is one (native-endian) uint32 per pixel,
+// holding the binary24 value in the low bits, ready for expandFP24().
 static inline void decodeFPDeltaRow(unsigned char* src, unsigned char* dst,
                                     size_t tileWidth, size_t realTileWidth,
                                     unsigned int bytesps, int factor) {
-  // DecodeDeltaBytes
-  for (size_t col = factor; col < realTileWidth * bytesps; ++col) {
-    src[col] += src[col - factor];
-  }
+  decodeDeltaBytes(src, realTileWidth * bytesps, factor);
+
   // Reorder bytes into the image
   // 16 and 32-bit versions depend on local architecture, 24-bit does not
+  size_t col = 0;
   if (bytesps == 3) {
-    for (size_t col = 0; col < tileWidth; ++col) {
-      dst[col * 3] = src[col];
-      dst[col * 3 + 1] = src[col + realTileWidth];
-      dst[col * 3 + 2] = src[col + realTileWidth * 2];
+    auto* dst32 = (uint32*)dst;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; col + 16 <= tileWidth; col += 16) {
+      __m128i p0 = _mm_loadu_si128((const __m128i*)&src[col]);
+      __m128i p1 = _mm_loadu_si128((const __m128i*)&src[col + realTileWidth]);
+      __m128i p2 =
+          _mm_loadu_si128((const __m128i*)&src[col + realTileWidth * 2]);
+      __m128i lo12 = _mm_unpacklo_epi8(p2, p1);
+      __m128i hi12 = _mm_unpackhi_epi8(p2, p1);
+      __m128i lo0 = _mm_unpacklo_epi8(p0, zero);
+      __m128i hi0 = _mm_unpackhi_epi8(p0, zero);
+      auto* out = (__m128i*)&dst32[col];
+      _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo12, lo0));
+      _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo12, lo0));
+      _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi12, hi0));
+      _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi12, hi0));
+    }
+#endif
+    for (; col < tileWidth; ++col) {
+      dst32[col] = (src[col] << 16) | (src[col + realTileWidth] << 8) |
+                   src[col + realTileWidth * 2];
     }
   } else {
     if (getHostEndianness() == little) {
-      for (size_t col = 0; col < tileWidth; ++col) {
+#if defined(__SSE2__)
+      // Byte planes are transposed with interleaving unpacks, 16 pixels a time
+      if (bytesps == 2) {
+        for (; col + 16 <= tileWidth; col += 16) {
+          __m128i p0 = _mm_loadu_si128((const __m128i*)&src[col]);
+          __m128i p1 =
+              _mm_loadu_si128((const __m128i*)&src[col + realTileWidth]);
+          auto* out = (__m128i*)&dst[col * 2];
+          _mm_storeu_si128(out + 0, _mm_unpacklo_epi8(p1, p0));
+          _mm_storeu_si128(out + 1, _mm_unpackhi_epi8(p1, p0));
+        }
+      } else if (bytesps == 4) {
+        for (; col + 16 <= tileWidth; col += 16) {
+          __m128i p0 = _mm_loadu_si128((const __m128i*)&src[col]);
+          __m128i p1 =
+              _mm_loadu_si128((const __m128i*)&src[col + realTileWidth]);
+          __m128i p2 =
+              _mm_loadu_si128((const __m128i*)&src[col + realTileWidth * 2]);
+          __m128i p3 =
+              _mm_loadu_si128((const __m128i*)&src[col + realTileWidth * 3]);
+          __m128i lo32 = _mm_unpacklo_epi8(p3, p2);
+          __m128i hi32 = _mm_unpackhi_epi8(p3, p2);
+          __m128i lo10 = _mm_unpacklo_epi8(p1, p0);
+          __m128i hi10 = _mm_unpackhi_epi8(p1, p0);
+          auto* out = (__m128i*)&dst[col * 4];
+          _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(lo32, lo10));
+          _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(lo32, lo10));
+          _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(hi32, hi10));
+          _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(hi32, hi10));
+        }
+      }
+#endif
+      for (; col < tileWidth; ++col) {
         for (size_t byte = 0; byte < bytesps; ++byte)
           dst[col * bytesps + byte] =
               src[col + realTileWidth * (bytesps - byte - 1)];
       }
     } else {
-      for (size_t col = 0; col < tileWidth; ++col) {
+      for (; col < tileWidth; ++col) {
         for (size_t byte = 0; byte < bytesps; ++byte)
           dst[col * bytesps + byte] = src[col + realTileWidth * byte];
       }
@@ -109,12 +275,10 @@ static inline uint32 __attribute__((const)) fp16ToFloat(ushort16 fp16) {
     // binary16 equation: -1 ^ sign * 2 ^ -14 * 0.fraction, we can represent it
     // as a normalized value in binary32, we have to shift fraction until we get
     // 1.new_fraction and decrement exponent for each shift
-    fp32_exponent = -14 + 127;
-    while (!(fp32_fraction & (1 << 23))) {
-      fp32_exponent -= 1;
-      fp32_fraction <<= 1;
-    }
-    fp32_fraction &= ((1 << 23) - 1);
+    // (bit 23 is the implicit one, so the shift is the leading zero count - 8)
+    const int shift = __builtin_clz(fp32_fraction) - 8;
+    fp32_exponent = -14 + 127 - shift;
+    fp32_fraction = (fp32_fraction << shift) & ((1 << 23) - 1);
   }
   return (sign << 31) | (fp32_exponent << 23) | fp32_fraction;
 }
@@ -158,35 +322,77 @@ static inline uint32 __attribute__((const)) fp24ToFloat(uint32 fp24) {
     // binary24 equation: -1 ^ sign * 2 ^ -62 * 0.fraction, we can represent it
     // as a normalized value in binary32, we have to shift fraction until we get
     // 1.new_fraction and decrement exponent for each shift
-    fp32_exponent = -62 + 127;
-    while (!(fp32_fraction & (1 << 23))) {
-      fp32_exponent -= 1;
-      fp32_fraction <<= 1;
-    }
-    fp32_fraction &= ((1 << 23) - 1);
+    // (bit 23 is the implicit one, so the shift is the leading zero count - 8)
+    const int shift = __builtin_clz(fp32_fraction) - 8;
+    fp32_exponent = -62 + 127 - shift;
+    fp32_fraction = (fp32_fraction << shift) & ((1 << 23) - 1);
   }
   return (sign << 31) | (fp32_exponent << 23) | fp32_fraction;
 }
 
+#if defined(__SSE2__)
+static inline void storeFP16x8(uint32* dst, __m128i fp16) {
+#if defined(__F16C__)
+  _mm_storeu_ps((float*)dst, _mm_cvtph_ps(fp16));
+  _mm_storeu_ps((float*)(dst + 4), _mm_cvtph_ps(_mm_unpackhi_epi64(fp16, fp16)));
+#else
+  const __m128i zero = _mm_setzero_si128();
+  _mm_storeu_si128((__m128i*)dst, smallFloatToFloat_SSE2<5, 10>(
+                                      _mm_unpacklo_epi16(fp16, zero)));
+  _mm_storeu_si128((__m128i*)(dst + 4), smallFloatToFloat_SSE2<5, 10>(
+                                            _mm_unpackhi_epi16(fp16, zero)));
+#endif
+}
+#endif
+
+// Single values use F16C too if the blocks do, so that signalling NaNs are
+// quieted the same way in every column.
+static inline uint32 expandOneFP16(ushort16 fp16) {
+#if defined(__F16C__)
+  const float f = _cvtsh_ss(fp16);
+  uint32 v;
+  memcpy(&v, &f, sizeof(v));
+  return v;
+#else
+  return fp16ToFloat(fp16);
+#endif
+}
+
 static inline void expandFP16(unsigned char* dst, int width) {
   auto* dst16 = (ushort16*)dst;
   auto* dst32 = (uint32*)dst;
 
-  for (int x = width - 1; x >= 0; x--)
-    dst32[x] = fp16ToFloat(dst16[x]);
+  int x = width - 1;
+#if defined(__SSE2__)
+  // In-place, back to front: the odd tail first, then 8 values per step.
+  // A block is loaded before it is stored, and its output never reaches
+  // below its own input, so no not-yet-expanded value gets overwritten.
+  for (; x >= 0 && (x + 1) % 8; x--)
+    dst32[x] = expandOneFP16(dst16[x]);
+  for (; x >= 7; x -= 8)
+    storeFP16x8(&dst32[x - 7], _mm_loadu_si128((const __m128i*)&dst16[x - 7]));
+#endif
+  for (; x >= 0; x--)
+    dst32[x] = expandOneFP16(dst16[x]);
 }
 
 static inline void expandFP24(unsigned char* dst, int width) {
+  // decodeFPDeltaRow() already widened every binary24 value to 32 bits
   auto* dst32 = (uint32*)dst;
-  dst += (width - 1) * 3;
-  for (int x = width - 1; x >= 0; x--) {
-    dst32[x] = fp24ToFloat((dst[0] << 16) | (dst[1] << 8) | dst[2]);
-    dst -= 3;
+  int x = 0;
+#if defined(__SSE2__)
+  for (; x + 4 <= width; x += 4) {
+    auto* p = (__m128i*)&dst32[x];
+    _mm_storeu_si128(p, smallFloatToFloat_SSE2<7, 16>(_mm_loadu_si128(p)));
   }
+#endif
+  for (; x < width; x++)
+    dst32[x] = fp24ToFloat(dst32[x]);
 }
 
 void DeflateDecompressor::decode(unsigned char** uBuffer, int width, int height,
                                  uint32 offX, uint32 offY) {
+  TraceScope trace("DeflateDecompressor::decode");
   uLongf dstLen = width * height * 4UL;
 
   if (!*uBuffer)
@@ -194,6 +400,8 @@ void DeflateDecompressor::decode(unsigned char** uBuffer, int width, int height,
 
   const auto cSize = input.getRemainSize();
   const unsigned char* cBuffer = input.getData(cSize);
+  trace.setBytes(cSize);
+  trace.setPixels((uint64)width * height);
 
   int err = uncompress(*uBuffer, &dstLen, cBuffer, cSize);
   if (err != Z_OK) {
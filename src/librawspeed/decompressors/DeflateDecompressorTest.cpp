@@ -0,0 +1,193 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "rawspeedconfig.h"
+
+#ifdef HAVE_ZLIB
+
+#include "decompressors/DeflateDecompressor.h" // for DeflateDecompressor
+#include "common/Common.h"                     // for uint32, uchar8, ushort16
+#include "common/Point.h"                      // for iPoint2D
+#include "common/RawImage.h"                   // for RawImage, RawImageData
+#include "io/Buffer.h"                         // for Buffer
+#include <cstring>                             // for memcpy
+#include <gtest/gtest.h>                       // for Test, ASSERT_EQ, TEST
+#include <vector>                              // for vector
+
+extern "C" {
+#include <zlib.h> // for compressBound, compress, Z_OK
+// IWYU pragma: no_include <zconf.h>
+}
+
+using namespace std;
+using namespace RawSpeed;
+
+// The decoder undoes the predictor and expands FP16/FP24 with SSE2/F16C
+// where available, and with scalar code for the rest of each row. These
+// references are the plain scalar conversions it has to match bit by bit.
+
+static uint32 referenceFloat(uint32 value, int expBits, int fracBits) {
+  const uint32 bias = (1 << (expBits - 1)) - 1;
+  const uint32 maxExp = (1 << expBits) - 1;
+  uint32 sign = (value >> (expBits + fracBits)) & 1;
+  uint32 exponent = (value >> fracBits) & maxExp;
+  uint32 fraction = value & ((1 << fracBits) - 1);
+
+  uint32 fp32_exponent = exponent + 127 - bias;
+  uint32 fp32_fraction = fraction << (23 - fracBits);
+  if (exponent == maxExp) {
+    fp32_exponent = 255;
+#if defined(__F16C__)
+    // vcvtph2ps quiets signalling NaNs
+    if (fracBits == 10 && fp32_fraction)
+      fp32_fraction |= 1 << 22;
+#endif
+  } else if (exponent == 0 && fraction == 0) {
+    fp32_exponent = 0;
+  } else if (exponent == 0) {
+    fp32_exponent = 1 + 127 - bias;
+    while (!(fp32_fraction & (1 << 23))) {
+      fp32_exponent--;
+      fp32_fraction <<= 1;
+    }
+    fp32_fraction &= (1 << 23) - 1;
+  }
+  return (sign << 31) | (fp32_exponent << 23) | fp32_fraction;
+}
+
+// Stores the values as big endian byte planes per row, and applies the
+// horizontal byte difference predictor, like a floating point DNG tile.
+static vector<uchar8> encodeTile(const vector<uint32>& values, int width,
+                                 int bytesps, int factor) {
+  const int height = values.size() / width;
+  vector<uchar8> tile(values.size() * bytesps);
+  for (int y = 0; y < height; y++) {
+    uchar8* row = &tile[(size_t)y * width * bytesps];
+    for (int x = 0; x < width; x++) {
+      for (int b = 0; b < bytesps; b++)
+        row[x + width * b] =
+            values[(size_t)y * width + x] >> (8 * (bytesps - 1 - b));
+    }
+    for (int col = width * bytesps - 1; col >= factor; col--)
+      row[col] -= row[col - factor];
+  }
+  return tile;
+}
+
+static RawImage decodeTile(const vector<uchar8>& tile, int width, int height,
+                           int bps, int predictor) {
+  uLongf size = compressBound(tile.size());
+  vector<uchar8> compressed(size);
+  if (compress(compressed.data(), &size, tile.data(), tile.size()) != Z_OK)
+    return RawImage::create();
+
+  RawImage img = RawImage::create(TYPE_FLOAT32);
+  img->dim = iPoint2D(width, height);
+  img->createData();
+  const Buffer buf(compressed.data(), size);
+  DeflateDecompressor d(buf, 0, size, img, predictor, bps);
+  unsigned char* uBuffer = nullptr;
+  d.decode(&uBuffer, width, height, 0, 0);
+  delete[] uBuffer;
+  return img;
+}
+
+static void checkTile(const vector<uint32>& values, int width, int bps,
+                      int factor, int predictor) {
+  const int height = values.size() / width;
+  RawImage img = decodeTile(encodeTile(values, width, bps / 8, factor), width,
+                            height, bps, predictor);
+  ASSERT_EQ(iPoint2D(width, height), img->dim);
+  for (int y = 0; y < height; y++) {
+    const auto* row = (const uint32*)img->getData(0, y);
+    for (int x = 0; x < width; x++) {
+      const uint32 value = values[(size_t)y * width + x];
+      uint32 expected = value;
+      if (bps == 16)
+        expected = referenceFloat(value, 5, 10);
+      else if (bps == 24)
+        expected = referenceFloat(value, 7, 16);
+      ASSERT_EQ(expected, row[x]) << hex << "value " << value << " width "
+                                  << dec << width << " at " << x << ", " << y;
+    }
+  }
+}
+
+static const struct {
+  int factor;
+  int predictor;
+} predictors[] = {{1, 3}, {2, 34894}, {4, 34895}};
+
+// Widths that leave a scalar tail after the 4, 8 and 16 wide vector loops
+static const int widths[] = {1, 3, 7, 8, 15, 16, 17, 31, 33, 63, 100, 257};
+
+TEST(DeflateDecompressorTest, FP16AllValues) {
+  for (const auto& p : predictors) {
+    for (int width : {333, 512}) {
+      const int height = (65536 + width - 1) / width;
+      vector<uint32> values(width * height);
+      for (size_t i = 0; i < values.size(); i++)
+        values[i] = i & 0xffff;
+      checkTile(values, width, 16, p.factor, p.predictor);
+    }
+  }
+}
+
+TEST(DeflateDecompressorTest, FP24EdgeCases) {
+  const vector<uint32> special = {
+      0x000000, 0x800000, // +-0
+      0x000001, 0x800001, // smallest subnormals
+      0x008000, 0x00ffff, // subnormals
+      0x80ffff, 0x010000, // largest subnormal, smallest normal
+      0x3f0000, 0xbf8000, // 1.0, -1.5
+      0x7effff, 0xfeffff, // largest normals
+      0x7f0000, 0xff0000, // +-inf
+      0x7f0001, 0x7f8000, // NaNs
+      0xffffff, 0x7fffff};
+  for (const auto& p : predictors) {
+    for (int width : widths) {
+      vector<uint32> values(width * 3);
+      uint32 seed = 12345;
+      for (size_t i = 0; i < values.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        values[i] =
+            i % 3 ? special[(seed >> 8) % special.size()] : seed & 0xffffff;
+      }
+      checkTile(values, width, 24, p.factor, p.predictor);
+    }
+  }
+}
+
+// FP32 is stored as is, this only checks the predictor and the byte planes
+TEST(DeflateDecompressorTest, Predictor) {
+  for (const auto& p : predictors) {
+    for (int width : widths) {
+      for (int bps : {16, 24, 32}) {
+        vector<uint32> values(width * 2);
+        uint32 seed = width * bps;
+        for (auto& v : values) {
+          seed = seed * 1103515245 + 12345;
+          v = bps == 32 ? seed : (seed >> 4) & ((1U << bps) - 1);
+        }
+        checkTile(values, width, bps, p.factor, p.predictor);
+      }
+    }
+  }
+}
+
+#endif
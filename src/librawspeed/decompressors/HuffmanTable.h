@@ -21,6 +21,7 @@
 #pragma once
 
 #include "common/Common.h"                // for ushort16, uchar8, int32
+#include "common/DecodeCounters.h"        // for countDecode, DecodeCounters
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "io/Buffer.h"                    // for Buffer
 #include <algorithm>                      // for copy
@@ -237,6 +238,7 @@ public:
     // 32 is the absolute maximum combined length of code + diff
     // for processors supporting bmi2 instructions, using maxCodePlusDiffLength()
     // might be benifitial
+    countDecode(&DecodeCounters::huffmanDecodes);
     bs.fill(32);
     uint32 code = bs.peekBitsNoFill(LookupDepth);
 
@@ -255,6 +257,7 @@ public:
       return FULL_DECODE ? signExtended(bs.getBitsNoFill(l_diff), l_diff) : l_diff;
     }
 
+    countDecode(&DecodeCounters::huffmanSlowDecodes);
     uint32 code_l = LookupDepth;
     bs.skipBitsNoFill(code_l);
     while (code_l < maxCodeOL.size() && code > maxCodeOL[code_l]) {
@@ -27,9 +27,10 @@
 #include "common/Common.h"                // for uchar8, uint32, ushort16
 #include "common/Memory.h"                // for alignedFree, alignedMalloc...
 #include "common/Point.h"                 // for iPoint2D
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "io/ByteStream.h"                // for ByteStream
-#include <algorithm>                      // for min
+#include <algorithm>                      // for min, max
 #include <cstdio>                         // for size_t
 #include <memory>                         // for unique_ptr
 #include <vector>                         // for vector
@@ -108,45 +109,62 @@ struct JpegDecompressStruct : jpeg_decompress_struct {
   ~JpegDecompressStruct() { jpeg_destroy_decompress(this); }
 };
 
-void JpegDecompressor::decode(uint32 offX,
-                              uint32 offY) { /* Each slice is a JPEG image */
+void JpegDecompressor::decode(uint32 offX, uint32 offY,
+                              uint32 scale) { /* Each slice is a JPEG image */
+  TraceScope trace("JpegDecompressor::decode");
+  trace.setBytes(input.getRemainSize());
   struct JpegDecompressStruct dinfo;
 
-  vector<JSAMPROW> buffer(1);
-
   JPEG_MEMSRC(&dinfo, (unsigned char*)input.getData(input.getRemainSize()),
               input.getRemainSize());
 
   if (JPEG_HEADER_OK != jpeg_read_header(&dinfo, static_cast<boolean>(true)))
     ThrowRDE("Unable to read JPEG header");
 
+  if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+    ThrowRDE("Unsupported JPEG scale 1/%u", scale);
+
+  // Let libjpeg skip the IDCT work for the coefficients we would throw away
+  dinfo.scale_num = 1;
+  dinfo.scale_denom = scale;
+
   jpeg_start_decompress(&dinfo);
   if (dinfo.output_components != (int)mRaw->getCpp())
     ThrowRDE("Component count doesn't match");
   int row_stride = dinfo.output_width * dinfo.output_components;
 
-  unique_ptr<uchar8[], decltype(&alignedFree)> complete_buffer(
-      (uchar8*)alignedMallocArray<16>(dinfo.output_height, row_stride),
-      alignedFree);
-  while (dinfo.output_scanline < dinfo.output_height) {
-    buffer[0] = (JSAMPROW)(
-        &complete_buffer[(size_t)dinfo.output_scanline * row_stride]);
-    if (0 == jpeg_read_scanlines(&dinfo, &buffer[0], 1))
-      ThrowRDE("JPEG Error while decompressing image.");
-  }
-  jpeg_finish_decompress(&dinfo);
-
-  // Now the image is decoded, and we copy the image data
   int copy_w = min(mRaw->dim.x - offX, dinfo.output_width);
   int copy_h = min(mRaw->dim.y - offY, dinfo.output_height);
-  for (int y = 0; y < copy_h; y++) {
-    uchar8* src = &complete_buffer[(size_t)row_stride * y];
-    auto* dst = (ushort16*)mRaw->getData(offX, y + offY);
-    for (int x = 0; x < copy_w; x++) {
-      for (int c = 0; c < dinfo.output_components; c++)
-        *dst++ = (*src++);
+  trace.setPixels((uint64)copy_w * copy_h);
+
+  // Instead of buffering the whole tile, read as many rows as libjpeg
+  // produces per call and widen them straight into the image.
+  const int batch = max(dinfo.rec_outbuf_height, 1);
+  unique_ptr<uchar8[], decltype(&alignedFree)> rows(
+      (uchar8*)alignedMallocArray<16>(batch, row_stride), alignedFree);
+  vector<JSAMPROW> buffer(batch);
+  for (int i = 0; i < batch; i++)
+    buffer[i] = (JSAMPROW)(&rows[(size_t)i * row_stride]);
+
+  while ((int)dinfo.output_scanline < copy_h) {
+    const int y = dinfo.output_scanline;
+    const int lines = jpeg_read_scanlines(&dinfo, &buffer[0], batch);
+    if (0 == lines)
+      ThrowRDE("JPEG Error while decompressing image.");
+
+    for (int i = 0; i < lines && y + i < copy_h; i++) {
+      const uchar8* src = buffer[i];
+      auto* dst = (ushort16*)mRaw->getData(offX, y + i + offY);
+      for (int x = 0; x < copy_w * dinfo.output_components; x++)
+        dst[x] = src[x];
     }
   }
+
+  // Rows below the image are never needed, so do not decode them
+  if (dinfo.output_scanline < dinfo.output_height)
+    jpeg_abort_decompress(&dinfo);
+  else
+    jpeg_finish_decompress(&dinfo);
 }
 
 } // namespace RawSpeed
@@ -42,7 +42,10 @@ public:
       : JpegDecompressor(data, offset, data.getSize() - offset, img) {}
   virtual ~JpegDecompressor() = default;
 
-  void decode(uint32 offsetX, uint32 offsetY);
+  // offsetX/offsetY are in (possibly scaled) image coordinates.
+  // scale (1, 2, 4 or 8) lets libjpeg do a reduced-size IDCT, which yields
+  // an image 1/scale the size in each dimension.
+  void decode(uint32 offsetX, uint32 offsetY, uint32 scale = 1);
 
 protected:
   ByteStream input;
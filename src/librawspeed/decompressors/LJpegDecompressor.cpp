@@ -21,6 +21,7 @@
 #include "decompressors/LJpegDecompressor.h"
 #include "common/Common.h"                // for unroll_loop, uint32, ushort16
 #include "common/Point.h"                 // for iPoint2D
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "io/BitPumpJPEG.h"               // for BitStream<>::getBufferPosi...
 #include "io/ByteStream.h"                // for ByteStream
@@ -31,6 +32,7 @@ using namespace std;
 namespace RawSpeed {
 
 void LJpegDecompressor::decode(uint32 offsetX, uint32 offsetY, bool fixDng16Bug_) {
+  TraceScope trace("LJpegDecompressor::decode");
   if ((int)offsetX >= mRaw->dim.x)
     ThrowRDE("X offset outside of image");
   if ((int)offsetY >= mRaw->dim.y)
@@ -41,6 +43,9 @@ void LJpegDecompressor::decode(uint32 offsetX, uint32 offsetY, bool fixDng16Bug_
   fixDng16Bug = fixDng16Bug_;
 
   AbstractLJpegDecompressor::decode();
+
+  trace.setBytes(input.getPosition());
+  trace.setPixels((uint64)frame.w * frame.h * frame.cps / mRaw->getCpp());
 }
 
 void LJpegDecompressor::decodeScan()
@@ -22,6 +22,7 @@
 #include "common/Common.h"              // for uint32, ushort16, clampBits
 #include "common/Point.h"               // for iPoint2D
 #include "common/RawImage.h"            // for RawImage, RawImageData, RawI...
+#include "common/Trace.h"               // for TraceScope
 #include "decompressors/HuffmanTable.h" // for HuffmanTable
 #include "io/BitPumpMSB.h"              // for BitPumpMSB, BitStream<>::fil...
 #include "io/Buffer.h"                  // for Buffer
@@ -65,6 +66,10 @@ static HuffmanTable createHuffmanTable(uint32 huffSelect) {
 void decompressNikon(RawImage& mRaw, ByteStream&& data, ByteStream metadata,
                      const iPoint2D& size, uint32 bitsPS,
                      bool uncorrectedRawValues) {
+  TraceScope trace("decompressNikon");
+  trace.setBytes(data.getRemainSize());
+  trace.setPixels(size.area());
+
   uint32 v0 = metadata.getByte();
   uint32 v1 = metadata.getByte();
   uint32 huffSelect = 0;
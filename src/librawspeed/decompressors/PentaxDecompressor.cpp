@@ -22,6 +22,7 @@
 #include "common/Common.h"                // for uint32, uchar8, ushort16
 #include "common/Point.h"                 // for iPoint2D
 #include "common/RawImage.h"              // for RawImage, RawImageData
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "decompressors/HuffmanTable.h"   // for HuffmanTable
 #include "io/BitPumpMSB.h"                // for BitPumpMSB, BitStream<>::f...
@@ -43,6 +44,9 @@ static const uchar8 pentax_tree[][2][16] = {
 };
 
 void decodePentax(RawImage& mRaw, ByteStream&& data, TiffIFD* root) {
+  TraceScope trace("decodePentax");
+  trace.setBytes(data.getRemainSize());
+  trace.setPixels(mRaw->dim.area());
 
   HuffmanTable ht;
 
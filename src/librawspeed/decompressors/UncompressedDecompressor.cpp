@@ -22,6 +22,8 @@
 #include "decompressors/UncompressedDecompressor.h"
 #include "common/Common.h"                // for uint32, uchar8, ushort16
 #include "common/Point.h"                 // for iPoint2D
+#include "common/RowBinner.h"             // for RowBinner
+#include "common/Trace.h"                 // for TraceScope
 #include "decoders/RawDecoderException.h" // for ThrowRDE
 #include "io/BitPumpMSB.h"                // for BitPumpMSB
 #include "io/BitPumpMSB16.h"              // for BitPumpMSB16
@@ -31,6 +33,7 @@
 #include "io/Endianness.h"                // for getHostEndianness, Endiann...
 #include "io/IOException.h"               // for ThrowIOE
 #include <algorithm>                      // for min
+#include <cstring>                        // for memcpy
 
 using namespace std;
 
@@ -40,9 +43,19 @@ void UncompressedDecompressor::readUncompressedRaw(iPoint2D& size,
                                                    iPoint2D& offset,
                                                    int inputPitch,
                                                    int bitPerPixel,
-                                                   BitOrder order) {
+                                                   BitOrder order,
+                                                   RowBinner* binner) {
+  TraceScope trace("UncompressedDecompressor::readUncompressedRaw");
   uchar8* data = mRaw->getData();
   uint32 outPitch = mRaw->pitch;
+  const iPoint2D dim = mRaw->getUnbinnedDim();
+  const bool binned = mRaw->getBinning() > 1;
+  if (binned && !binner)
+    ThrowRDE("(internal) Binned images need a RowBinner");
+  // The rows go through the binner if the image is binned while decoding
+  auto row = [&](uint64 r) {
+    return binned ? binner->getRow((int)r) : &data[r * outPitch];
+  };
   uint64 w = size.x;
   uint64 h = size.y;
   uint32 cpp = mRaw->getCpp();
@@ -61,20 +74,32 @@ void UncompressedDecompressor::readUncompressedRaw(iPoint2D& size,
     ThrowRDE("Unsupported bit depth");
 
   uint32 skipBits = inputPitch - w * cpp * bitPerPixel / 8; // Skip per line
-  if (oy > (uint64)mRaw->dim.y)
+  if (oy > (uint64)dim.y)
     ThrowRDE("Invalid y offset");
-  if (ox + size.x > (uint64)mRaw->dim.x)
+  if (ox + size.x > (uint64)dim.x)
     ThrowRDE("Invalid x offset");
 
   uint64 y = oy;
-  h = min(h + oy, (uint64)mRaw->dim.y);
+  h = min(h + oy, (uint64)dim.y);
+  trace.setBytes(inputPitch * (h - y));
+  trace.setPixels(w * (h - y));
+
+  // Copies the input rows as they are, to byte xOff of the output rows
+  auto copyRows = [&](uint64 xOff) {
+    const uchar8* in = input.getData(inputPitch * (h - y));
+    if (!binned) {
+      copyPixels(&data[xOff + y * outPitch], outPitch, in, inputPitch,
+                 w * mRaw->getBpp(), h - y);
+      return;
+    }
+    for (uint64 r = y; r < h; r++)
+      memcpy(&row(r)[xOff], &in[(r - y) * inputPitch], w * mRaw->getBpp());
+  };
 
   if (mRaw->getDataType() == TYPE_FLOAT32) {
     if (bitPerPixel != 32)
       ThrowRDE("Only 32 bit float point supported");
-    copyPixels(&data[offset.x * sizeof(float) * cpp + y * outPitch], outPitch,
-               input.getData(inputPitch * (h - y)), inputPitch,
-               w * mRaw->getBpp(), h - y);
+    copyRows(offset.x * sizeof(float) * cpp);
     return;
   }
 
@@ -82,8 +107,7 @@ void UncompressedDecompressor::readUncompressedRaw(iPoint2D& size,
     BitPumpMSB bits(input);
     w *= cpp;
     for (; y < h; y++) {
-      auto* dest =
-          (ushort16*)&data[offset.x * sizeof(ushort16) * cpp + y * outPitch];
+      auto* dest = (ushort16*)&row(y)[offset.x * sizeof(ushort16) * cpp];
       for (uint32 x = 0; x < w; x++) {
         uint32 b = bits.getBits(bitPerPixel);
         dest[x] = b;
@@ -94,8 +118,7 @@ void UncompressedDecompressor::readUncompressedRaw(iPoint2D& size,
     BitPumpMSB16 bits(input);
     w *= cpp;
     for (; y < h; y++) {
-      auto* dest =
-          (ushort16*)&data[offset.x * sizeof(ushort16) * cpp + y * outPitch];
+      auto* dest = (ushort16*)&row(y)[offset.x * sizeof(ushort16) * cpp];
       for (uint32 x = 0; x < w; x++) {
         uint32 b = bits.getBits(bitPerPixel);
         dest[x] = b;
@@ -106,8 +129,7 @@ void UncompressedDecompressor::readUncompressedRaw(iPoint2D& size,
     BitPumpMSB32 bits(input);
     w *= cpp;
     for (; y < h; y++) {
-      auto* dest =
-          (ushort16*)&data[offset.x * sizeof(ushort16) * cpp + y * outPitch];
+      auto* dest = (ushort16*)&row(y)[offset.x * sizeof(ushort16) * cpp];
       for (uint32 x = 0; x < w; x++) {
         uint32 b = bits.getBits(bitPerPixel);
         dest[x] = b;
@@ -116,20 +138,18 @@ void UncompressedDecompressor::readUncompressedRaw(iPoint2D& size,
     }
   } else {
     if (bitPerPixel == 16 && getHostEndianness() == little) {
-      copyPixels(&data[offset.x * sizeof(ushort16) * cpp + y * outPitch],
-                 outPitch, input.getData(inputPitch * (h - y)), inputPitch,
-                 w * mRaw->getBpp(), h - y);
+      copyRows(offset.x * sizeof(ushort16) * cpp);
       return;
     }
     if (bitPerPixel == 12 && (int)w == inputPitch * 8 / 12 &&
-        getHostEndianness() == little) {
+        getHostEndianness() == little && !binned) {
       decode12BitRaw(w, h);
       return;
     }
     BitPumpPlain bits(input);
     w *= cpp;
     for (; y < h; y++) {
-      auto* dest = (ushort16*)&data[offset.x * sizeof(ushort16) + y * outPitch];
+      auto* dest = (ushort16*)&row(y)[offset.x * sizeof(ushort16)];
       for (uint32 x = 0; x < w; x++) {
         uint32 b = bits.getBits(bitPerPixel);
         dest[x] = b;
@@ -32,6 +32,8 @@ namespace RawSpeed {
 
 class iPoint2D;
 
+class RowBinner;
+
 class UncompressedDecompressor {
 public:
   UncompressedDecompressor(ByteStream input_, const RawImage& img,
@@ -57,8 +59,10 @@ public:
   /* inputPitch: Number of bytes between each line in the input image */
   /* bitPerPixel: Number of bits to read for each input pixel. */
   /* order: Order of the bits - see Common.h for possibilities. */
+  /* binner: Where the rows go if the image is binned while decoding. */
   void readUncompressedRaw(iPoint2D& size, iPoint2D& offset, int inputPitch,
-                           int bitPerPixel, BitOrder order);
+                           int bitPerPixel, BitOrder order,
+                           RowBinner* binner = nullptr);
 
   /* Faster versions for unpacking 8 bit data */
   void decode8BitRaw(uint32 w, uint32 h);
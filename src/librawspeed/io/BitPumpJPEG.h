@@ -20,10 +20,11 @@
 
 #pragma once
 
-#include "common/Common.h" // for uchar8, uint32
-#include "io/BitStream.h"  // for BitStreamCacheRightInLeftOut, BitStream
-#include "io/Buffer.h"     // for Buffer::size_type
-#include "io/Endianness.h" // for getBE
+#include "common/Common.h"         // for uchar8, uint32
+#include "common/DecodeCounters.h" // for countDecode, DecodeCounters
+#include "io/BitStream.h"          // for BitStreamCacheRightInLeftOut, Bit...
+#include "io/Buffer.h"             // for Buffer::size_type
+#include "io/Endianness.h"         // for getBE
 
 namespace RawSpeed {
 
@@ -49,6 +50,7 @@ inline BitPumpJPEG::size_type BitPumpJPEG::fillCache(const uchar8* input)
     return 4;
   }
 
+  countDecode(&DecodeCounters::jpegByteFills);
   size_type p = 0;
   for (size_type i = 0; i < 4; ++i) {
     // Pre-execute most common case, where next byte is 'normal'/non-FF
@@ -61,6 +63,7 @@ inline BitPumpJPEG::size_type BitPumpJPEG::fillCache(const uchar8* input)
         // Found FF/xx with xx != 00. This is the end of stream marker.
         // Rewind pos to the FF byte, in case we get called again.
         // Fill the cache with zeros and keep on doing that from now on.
+        countDecode(&DecodeCounters::jpegMarkers);
         p -= 2;
         cache.cache &= ~0xFF;
         cache.cache <<= 64 - cache.fillLevel;
@@ -21,9 +21,10 @@
 
 #pragma once
 
-#include "common/Common.h" // for uint32, uchar8, uint64
-#include "io/Buffer.h"     // for Buffer::size_type, BUFFER_PADDING
-#include "io/ByteStream.h"  // for ByteStream
+#include "common/Common.h"         // for uint32, uchar8, uint64
+#include "common/DecodeCounters.h" // for countDecode, DecodeCounters
+#include "io/Buffer.h"             // for Buffer::size_type, BUFFER_PADDING
+#include "io/ByteStream.h"         // for ByteStream
 #include "io/IOException.h" // for IOException (ptr only), ThrowIOE
 #include <cassert>          // for assert
 #include <cstring>          // for memcpy
@@ -99,9 +100,11 @@ public:
   inline void fill(uint32 nbits = Cache::MaxGetBits) {
     assert(nbits <= Cache::MaxGetBits);
     if (cache.fillLevel < nbits) {
+      countDecode(&DecodeCounters::bitStreamFills);
 #if BUFFER_PADDING==0
       // disabling this run-time bounds check saves about 1% on intel x86-64
       if (pos + Cache::MaxGetBits/8 > size) {
+        countDecode(&DecodeCounters::bitStreamTailFills);
         if (pos < size) {
           uchar8 tmp[4] = {0, 0, 0, 0};
           memcpy(tmp, data + pos, size - pos);
@@ -75,6 +75,18 @@ Buffer& Buffer::operator=(const Buffer &rhs)
   return *this;
 }
 
+Buffer& Buffer::operator=(Buffer&& rhs) noexcept
+{
+  if (this == &rhs)
+    return *this;
+  this->~Buffer();
+  data = rhs.data;
+  size = rhs.size;
+  isOwner = rhs.isOwner;
+  rhs.isOwner = false;
+  return *this;
+}
+
 #if 0
 Buffer* Buffer::clone() {
   Buffer *new_map = new Buffer(size);
@@ -76,6 +76,8 @@ public:
   // Frees memory if owned
   ~Buffer();
   Buffer& operator=(const Buffer& rhs);
+  // Move data and ownership from rhs to this
+  Buffer& operator=(Buffer&& rhs) noexcept;
 
   Buffer getSubView(size_type offset, size_type size_) const {
     return Buffer(getData(offset, size_), size_);
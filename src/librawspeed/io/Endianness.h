@@ -98,6 +98,18 @@ template <typename T> inline T getByteSwapped(const void* data, bool bswap) {
   return bswap ? getByteSwapped(ret) : ret;
 }
 
+// Copies count values of type T from data to dst, swapping their byte order
+// if bswap is set. The swap is a plain loop, which the compiler vectorizes.
+template <typename T>
+inline void copyByteSwapped(T* dst, const void* data, size_t count,
+                            bool bswap) {
+  memcpy(dst, data, count * sizeof(T));
+  if (bswap) {
+    for (size_t i = 0; i < count; i++)
+      dst[i] = getByteSwapped(dst[i]);
+  }
+}
+
 // The following functions may be used to get a multi-byte sized tyoe from some
 // memory location converted to the native byte order of the host.
 // 'BE' suffix: source byte order is known to be big endian
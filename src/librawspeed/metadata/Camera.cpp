@@ -22,11 +22,14 @@
 #include "metadata/Camera.h"
 #include "common/Common.h"                    // for split_string, uint32
 #include "common/Point.h"                     // for iPoint2D
+#include "io/ByteStream.h"                    // for ByteStream
 #include "metadata/CameraMetadataException.h" // for ThrowCME
 #include <cctype>                             // for tolower
 #include <cstdio>                             // for size_t
+#include <iterator>                           // for distance
 #include <map>                                // for map
 #include <pugixml.hpp>                        // for xml_node, xml_attribute
+#include <sstream>                            // for istringstream
 #include <stdexcept>                          // for out_of_range
 #include <string>                             // for string, allocator, ope...
 #include <vector>                             // for vector
@@ -70,6 +73,58 @@ Camera::Camera(const Camera* camera, uint32 alias_num) : cfa(iPoint2D(0,0))
   canonical_aliases.clear();
 }
 
+static const map<string, HintKey> str2hint = {
+    {"bits", HINT_BITS},
+    {"coolpixmangled", HINT_COOLPIXMANGLED},
+    {"coolpixsplit", HINT_COOLPIXSPLIT},
+    {"double_width_unpacked", HINT_DOUBLE_WIDTH_UNPACKED},
+    {"easyshare_offset_hack", HINT_EASYSHARE_OFFSET_HACK},
+    {"filesize", HINT_FILESIZE},
+    {"force_new_sraw_hue", HINT_FORCE_NEW_SRAW_HUE},
+    {"force_uncompressed", HINT_FORCE_UNCOMPRESSED},
+    {"fuji_rotate", HINT_FUJI_ROTATE},
+    {"full_height", HINT_FULL_HEIGHT},
+    {"full_width", HINT_FULL_WIDTH},
+    {"invert_sraw_wb", HINT_INVERT_SRAW_WB},
+    {"jpeg32_bitorder", HINT_JPEG32_BITORDER},
+    {"msb_override", HINT_MSB_OVERRIDE},
+    {"nikon_wb_adjustment", HINT_NIKON_WB_ADJUSTMENT},
+    {"no_decompressed_lowbits", HINT_NO_DECOMPRESSED_LOWBITS},
+    {"offset", HINT_OFFSET},
+    {"old_sraw_hue", HINT_OLD_SRAW_HUE},
+    {"order", HINT_ORDER},
+    {"override_cfa_black", HINT_OVERRIDE_CFA_BLACK},
+    {"packed_with_control", HINT_PACKED_WITH_CONTROL},
+    {"pixel_aspect_ratio", HINT_PIXEL_ASPECT_RATIO},
+    {"pixelBaseOffset", HINT_PIXEL_BASE_OFFSET},
+    {"real_bpp", HINT_REAL_BPP},
+    {"sr2_format", HINT_SR2_FORMAT},
+    {"sraw_40d", HINT_SRAW_40D},
+    {"sraw_new", HINT_SRAW_NEW},
+    {"srf_format", HINT_SRF_FORMAT},
+    {"swapped_wb", HINT_SWAPPED_WB},
+    {"wb_mangle", HINT_WB_MANGLE},
+    {"wb_offset", HINT_WB_OFFSET},
+    {"zero_is_not_bad", HINT_ZERO_IS_NOT_BAD},
+};
+
+void Hints::add(const string& key, const string& value) {
+  // the first value given for a hint is the one that counts
+  if (find(key))
+    return;
+
+  Value hint;
+  hint.str = value;
+  istringstream(value) >> hint.asInt;
+  istringstream(value) >> hint.asFloat;
+
+  auto known = str2hint.find(key);
+  if (known != str2hint.end())
+    slots[known->second] = (char8)data.size();
+
+  data.emplace_back(key, hint);
+}
+
 static string name(const xml_node &a) {
   return string(a.name());
 }
@@ -302,6 +357,134 @@ void Camera::parseCameraChild(const xml_node &cur) {
   }
 }
 
+// The precompiled camera database stores everything the xml parser
+// produces, with all numbers as little endian 32 bit values and all
+// strings zero terminated, so reading it back needs no parsing at all.
+
+static string getString(ByteStream* bs) { return string(bs->getString()); }
+
+static void putU32(vector<uchar8>* out, uint32 v) {
+  for (int i = 0; i < 4; i++)
+    out->push_back((v >> (8 * i)) & 0xff);
+}
+
+static void putString(vector<uchar8>* out, const string& str) {
+  out->insert(out->end(), str.begin(), str.end());
+  out->push_back(0);
+}
+
+Camera::Camera(ByteStream* bs) : cfa(iPoint2D(0, 0)) {
+  make = getString(bs);
+  model = getString(bs);
+  mode = getString(bs);
+  canonical_make = getString(bs);
+  canonical_model = getString(bs);
+  canonical_alias = getString(bs);
+  canonical_id = getString(bs);
+
+  for (uint32 i = bs->getU32(); i > 0; i--) {
+    aliases.push_back(getString(bs));
+    canonical_aliases.push_back(getString(bs));
+  }
+
+  supported = bs->getU32() != 0;
+  decoderVersion = bs->getI32();
+
+  iPoint2D cfaSize;
+  cfaSize.x = bs->getU32();
+  cfaSize.y = bs->getU32();
+  if (cfaSize.x < 0 || cfaSize.y < 0 ||
+      (cfaSize.x && (uint32)cfaSize.y > bs->getRemainSize() / cfaSize.x))
+    ThrowCME("Invalid CFA size in camera %s %s", make.c_str(), model.c_str());
+  cfa.setSize(cfaSize);
+  for (int y = 0; y < cfaSize.y; y++) {
+    for (int x = 0; x < cfaSize.x; x++)
+      cfa.setColorAt(iPoint2D(x, y), (CFAColor)bs->getByte());
+  }
+
+  cropSize.x = bs->getI32();
+  cropSize.y = bs->getI32();
+  cropPos.x = bs->getI32();
+  cropPos.y = bs->getI32();
+
+  for (uint32 i = bs->getU32(); i > 0; i--) {
+    uint32 offset = bs->getU32();
+    uint32 size = bs->getU32();
+    blackAreas.emplace_back(offset, size, bs->getU32() != 0);
+  }
+
+  for (uint32 i = bs->getU32(); i > 0; i--) {
+    int black = bs->getI32();
+    int white = bs->getI32();
+    int min_iso = bs->getI32();
+    int max_iso = bs->getI32();
+    vector<int> black_colors;
+    for (uint32 j = bs->getU32(); j > 0; j--)
+      black_colors.push_back(bs->getI32());
+    sensorInfo.emplace_back(black, white, min_iso, max_iso, black_colors);
+  }
+
+  for (uint32 i = bs->getU32(); i > 0; i--) {
+    string name = getString(bs);
+    hints.add(name, getString(bs));
+  }
+}
+
+void Camera::serialize(vector<uchar8>* out) const {
+  putString(out, make);
+  putString(out, model);
+  putString(out, mode);
+  putString(out, canonical_make);
+  putString(out, canonical_model);
+  putString(out, canonical_alias);
+  putString(out, canonical_id);
+
+  putU32(out, aliases.size());
+  for (uint32 i = 0; i < aliases.size(); i++) {
+    putString(out, aliases[i]);
+    putString(out, canonical_aliases[i]);
+  }
+
+  putU32(out, supported);
+  putU32(out, decoderVersion);
+
+  putU32(out, cfa.getSize().x);
+  putU32(out, cfa.getSize().y);
+  for (int y = 0; y < cfa.getSize().y; y++) {
+    for (int x = 0; x < cfa.getSize().x; x++)
+      out->push_back(cfa.getColorAt(x, y));
+  }
+
+  putU32(out, cropSize.x);
+  putU32(out, cropSize.y);
+  putU32(out, cropPos.x);
+  putU32(out, cropPos.y);
+
+  putU32(out, blackAreas.size());
+  for (const auto& area : blackAreas) {
+    putU32(out, area.offset);
+    putU32(out, area.size);
+    putU32(out, area.isVertical);
+  }
+
+  putU32(out, sensorInfo.size());
+  for (const auto& sensor : sensorInfo) {
+    putU32(out, sensor.mBlackLevel);
+    putU32(out, sensor.mWhiteLevel);
+    putU32(out, sensor.mMinIso);
+    putU32(out, sensor.mMaxIso);
+    putU32(out, sensor.mBlackLevelSeparate.size());
+    for (int black : sensor.mBlackLevelSeparate)
+      putU32(out, black);
+  }
+
+  putU32(out, distance(hints.begin(), hints.end()));
+  for (const auto& hint : hints) {
+    putString(out, hint.first);
+    putString(out, hint.second.str);
+  }
+}
+
 const CameraSensorInfo* Camera::getSensorInfo(int iso) const {
   if (sensorInfo.empty()) {
     ThrowCME("Camera '%s' '%s', mode '%s' has no <Sensor> entries.",
@@ -20,14 +20,14 @@
 
 #pragma once
 
-#include "common/Common.h"             // for uint32
+#include "common/Common.h"             // for uint32, uchar8, int64, char8
 #include "common/Point.h"              // for iPoint2D
 #include "metadata/BlackArea.h"        // for BlackArea
 #include "metadata/CameraSensorInfo.h" // for CameraSensorInfo
 #include "metadata/ColorFilterArray.h" // for ColorFilterArray
-#include <map>                         // for map, _Rb_tree_const_iterator
-#include <sstream>                     // for istringstream, basic_istream
-#include <string>                      // for string, basic_string, operator>>
+#include <array>                       // for array
+#include <string>                      // for string, basic_string
+#include <type_traits>                 // for is_arithmetic, is_integral
 #include <utility>                     // for pair
 #include <vector>                      // for vector
 
@@ -37,36 +37,113 @@ class xml_node;
 
 namespace RawSpeed {
 
+class ByteStream;
+
+// The hints decoders look for. They are resolved to a slot when the hint is
+// added, so looking them up does not need to compare or allocate strings.
+enum HintKey {
+  HINT_BITS,
+  HINT_COOLPIXMANGLED,
+  HINT_COOLPIXSPLIT,
+  HINT_DOUBLE_WIDTH_UNPACKED,
+  HINT_EASYSHARE_OFFSET_HACK,
+  HINT_FILESIZE,
+  HINT_FORCE_NEW_SRAW_HUE,
+  HINT_FORCE_UNCOMPRESSED,
+  HINT_FUJI_ROTATE,
+  HINT_FULL_HEIGHT,
+  HINT_FULL_WIDTH,
+  HINT_INVERT_SRAW_WB,
+  HINT_JPEG32_BITORDER,
+  HINT_MSB_OVERRIDE,
+  HINT_NIKON_WB_ADJUSTMENT,
+  HINT_NO_DECOMPRESSED_LOWBITS,
+  HINT_OFFSET,
+  HINT_OLD_SRAW_HUE,
+  HINT_ORDER,
+  HINT_OVERRIDE_CFA_BLACK,
+  HINT_PACKED_WITH_CONTROL,
+  HINT_PIXEL_ASPECT_RATIO,
+  HINT_PIXEL_BASE_OFFSET,
+  HINT_REAL_BPP,
+  HINT_SR2_FORMAT,
+  HINT_SRAW_40D,
+  HINT_SRAW_NEW,
+  HINT_SRF_FORMAT,
+  HINT_SWAPPED_WB,
+  HINT_WB_MANGLE,
+  HINT_WB_OFFSET,
+  HINT_ZERO_IS_NOT_BAD,
+  HINT_COUNT
+};
+
 class Hints
 {
-  std::map<std::string, std::string> data;
 public:
-  void add(const std::string& key, const std::string& value)
-  {
-    data.insert({key, value});
-  }
+  // The value of a hint, converted to numbers once when it is added.
+  struct Value {
+    std::string str;
+    int64 asInt = 0;
+    double asFloat = 0;
+  };
+
+private:
+  std::vector<std::pair<std::string, Value>> data;
+  // index into data for each of the known hints, -1 if not set
+  std::array<char8, HINT_COUNT> slots;
 
-  bool has(const std::string& key) const
-  {
-    return data.find(key) != data.end();
+  const Value* find(HintKey key) const {
+    return slots[key] < 0 ? nullptr : &data[slots[key]].second;
   }
 
-  template <typename T>
-  T get(const std::string& key, T defaultValue) const
-  {
-    auto hint = data.find(key);
-    if (hint != data.end() && !hint->second.empty()) {
-      std::istringstream iss(hint->second);
-      iss >> defaultValue;
+  const Value* find(const std::string& key) const {
+    for (const auto& hint : data) {
+      if (hint.first == key)
+        return &hint.second;
     }
-    return defaultValue;
+    return nullptr;
   }
 
-  bool get(const std::string& key, bool defaultValue) const {
-    auto hint = data.find(key);
-    if (hint == data.end())
+  template <typename T>
+  static T getValue(const Value* hint, T defaultValue) {
+    static_assert(std::is_arithmetic<T>::value, "Unsupported hint type");
+    if (!hint || hint->str.empty())
       return defaultValue;
-    return "true" == hint->second;
+    return std::is_integral<T>::value ? (T)hint->asInt : (T)hint->asFloat;
+  }
+
+  static std::string getValue(const Value* hint,
+                              const std::string& defaultValue) {
+    return hint && !hint->str.empty() ? hint->str : defaultValue;
+  }
+
+  static bool getValue(const Value* hint, bool defaultValue) {
+    return hint ? "true" == hint->str : defaultValue;
+  }
+
+public:
+  Hints() { slots.fill(-1); }
+
+  void add(const std::string& key, const std::string& value);
+
+  bool has(HintKey key) const { return find(key); }
+
+  bool has(const std::string& key) const { return find(key); }
+
+  template <typename T> T get(HintKey key, T defaultValue) const {
+    return getValue(find(key), defaultValue);
+  }
+
+  template <typename T>
+  T get(const std::string& key, T defaultValue) const {
+    return getValue(find(key), defaultValue);
+  }
+
+  std::vector<std::pair<std::string, Value>>::const_iterator begin() const {
+    return data.begin();
+  }
+  std::vector<std::pair<std::string, Value>>::const_iterator end() const {
+    return data.end();
   }
 };
 
@@ -75,6 +152,9 @@ class Camera
 public:
   Camera(pugi::xml_node &camera);
   Camera(const Camera* camera, uint32 alias_num);
+  // reads a camera written by serialize(), see CameraMetaData::save()
+  Camera(ByteStream* bs);
+  void serialize(std::vector<uchar8>* out) const;
   const CameraSensorInfo* getSensorInfo(int iso) const;
   std::string make;
   std::string model;
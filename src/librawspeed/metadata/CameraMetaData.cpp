@@ -20,12 +20,16 @@
 
 #include "metadata/CameraMetaData.h"
 #include "common/Common.h"                    // for uint32, trimSpaces
+#include "io/Buffer.h"                        // for Buffer
+#include "io/ByteStream.h"                    // for ByteStream
+#include "io/Endianness.h"                    // for getHostEndianness, little
 #include "metadata/Camera.h"                  // for Camera
 #include "metadata/CameraMetadataException.h" // for ThrowCME
-#include <algorithm>                          // for find_if
 #include <map>                                // for _Rb_tree_iterator, map
+#include <set>                                // for set
 #include <pugixml.hpp>                        // for xml_document, xml_pars...
 #include <string>                             // for string, operator==
+#include <unordered_map>                      // for unordered_map, _Node...
 #include <utility>                            // for pair
 #include <vector>                             // for vector
 
@@ -35,7 +39,77 @@ namespace RawSpeed {
 
 using namespace pugi;
 
+static inline CameraId getId(const string& make, const string& model,
+                             const string& mode) {
+  CameraId id;
+  id.make = trimSpaces(make);
+  id.model = trimSpaces(model);
+  id.mode = trimSpaces(mode);
+
+  return id;
+}
+
+// Appends str without leading and trailing blanks, and a separator.
+// Same as trimSpaces(), but without creating a temporary string.
+static inline void appendKeyPart(string* key, const string& str) {
+  size_t startpos = str.find_first_not_of(" \t");
+  if (startpos != string::npos)
+    key->append(str, startpos, str.find_last_not_of(" \t") - startpos + 1);
+  key->push_back('\0');
+}
+
+static inline string getKey(const string& make, const string& model) {
+  string key;
+  key.reserve(make.size() + model.size() + 2);
+  appendKeyPart(&key, make);
+  appendKeyPart(&key, model);
+  return key;
+}
+
+static inline string getKey(const string& make, const string& model,
+                            const string& mode) {
+  string key = getKey(make, model);
+  appendKeyPart(&key, mode);
+  return key;
+}
+
+// The precompiled camera database is this header, followed by the cameras
+// as written by Camera::serialize(). Bump the version whenever that changes.
+static const char databaseMagic[8] = "RSCAMDB";
+static const uint32 databaseVersion = 1;
+
 CameraMetaData::CameraMetaData(const char *docname) {
+  try {
+    loadXML(docname);
+  } catch (...) {
+    // the destructor does not run if the constructor throws
+    clear();
+    throw;
+  }
+}
+
+CameraMetaData::CameraMetaData(const Buffer* database) {
+  ByteStream bs(*database, 0, getHostEndianness() == little);
+
+  if (!bs.skipPrefix(databaseMagic, sizeof(databaseMagic)))
+    ThrowCME("Not a camera database.");
+
+  uint32 version = bs.getU32();
+  if (version != databaseVersion)
+    ThrowCME("Unsupported camera database version %u.", version);
+
+  // aliases are stored as separate cameras, so no need to create them here
+  try {
+    for (uint32 i = bs.getU32(); i > 0; i--)
+      addCamera(new Camera(&bs));
+  } catch (...) {
+    // a truncated database; the destructor does not run if we throw
+    clear();
+    throw;
+  }
+}
+
+void CameraMetaData::loadXML(const char* docname) {
   xml_document doc;
   xml_parse_result result = doc.load_file(docname);
 
@@ -45,57 +119,65 @@ CameraMetaData::CameraMetaData(const char *docname) {
         result.description(), doc.child("node").attribute("attr").value());
   }
 
+  // Cameras from this document replace the ones loaded before, but
+  // duplicates within the document are skipped by addCamera() as usual.
+  set<CameraId> loaded;
+  auto add = [this, &loaded](Camera* cam) {
+    auto id = getId(cam->make, cam->model, cam->mode);
+    if (loaded.insert(id).second)
+      removeCamera(id);
+    return addCamera(cam);
+  };
+
   for (xml_node camera : doc.child("Cameras").children("Camera")) {
     auto *cam = new Camera(camera);
 
-    if (!addCamera(cam))
+    if (!add(cam))
       continue;
 
     // Create cameras for aliases.
     for (uint32 i = 0; i < cam->aliases.size(); i++) {
-      addCamera(new Camera(cam, i));
+      add(new Camera(cam, i));
     }
   }
 }
 
-CameraMetaData::~CameraMetaData() {
-  auto i = cameras.begin();
-  for (; i != cameras.end(); ++i) {
-    delete((*i).second);
+void CameraMetaData::save(vector<uchar8>* database) const {
+  database->insert(database->end(), databaseMagic,
+                   databaseMagic + sizeof(databaseMagic));
+
+  for (uint32 v : {databaseVersion, (uint32)cameras.size()}) {
+    for (int i = 0; i < 4; i++)
+      database->push_back((v >> (8 * i)) & 0xff);
   }
+
+  for (const auto& cam : cameras)
+    cam.second->serialize(database);
 }
 
-static inline CameraId getId(const string& make, const string& model,
-                             const string& mode) {
-  CameraId id;
-  id.make = trimSpaces(make);
-  id.model = trimSpaces(model);
-  id.mode = trimSpaces(mode);
+CameraMetaData::~CameraMetaData() { clear(); }
 
-  return id;
+void CameraMetaData::clear() {
+  auto i = cameras.begin();
+  for (; i != cameras.end(); ++i) {
+    delete((*i).second);
+  }
+  cameras.clear();
+  cameraIndex.clear();
+  modelIndex.clear();
+  chdkCameras.clear();
 }
 
 const Camera* CameraMetaData::getCamera(const string& make, const string& model,
                                         const string& mode) const {
-  auto camera = cameras.find(getId(make, model, mode));
-  return camera == cameras.end() ? nullptr : camera->second;
+  auto camera = cameraIndex.find(getKey(make, model, mode));
+  return camera == cameraIndex.end() ? nullptr : camera->second;
 }
 
 const Camera* CameraMetaData::getCamera(const string& make,
                                         const string& model) const {
-  auto id = getId(make, model, "");
-
-  auto iter = find_if(cameras.cbegin(), cameras.cend(),
-                      [&id](decltype(*cameras.cbegin())& i) -> bool {
-                        const auto& cid = i.first;
-                        return tie(id.make, id.model) ==
-                               tie(cid.make, cid.model);
-                      });
-
-  if (iter == cameras.end())
-    return nullptr;
-
-  return iter->second;
+  auto camera = modelIndex.find(getKey(make, model));
+  return camera == modelIndex.end() ? nullptr : camera->second;
 }
 
 bool CameraMetaData::hasCamera(const string& make, const string& model,
@@ -117,15 +199,19 @@ CameraMetaData::hasChdkCamera(uint32 filesize) const {
 bool CameraMetaData::addCamera( Camera* cam )
 {
   auto id = getId(cam->make, cam->model, cam->mode);
-  if (cameras.end() != cameras.find(id)) {
+  if (!cameraIndex.emplace(getKey(id.make, id.model, id.mode), cam).second) {
     writeLog(DEBUG_PRIO_WARNING, "CameraMetaData: Duplicate entry found for camera: %s %s, Skipping!\n", cam->make.c_str(), cam->model.c_str());
     delete cam;
     return false;
   }
   cameras[id] = cam;
 
+  auto model = modelIndex.emplace(getKey(id.make, id.model), cam);
+  if (!model.second && id.mode < trimSpaces(model.first->second->mode))
+    model.first->second = cam;
+
   if (string::npos != cam->mode.find("chdk")) {
-    auto filesize_hint = cam->hints.get("filesize", string());
+    auto filesize_hint = cam->hints.get(HINT_FILESIZE, string());
     if (filesize_hint.empty()) {
       writeLog(DEBUG_PRIO_WARNING, "CameraMetaData: CHDK camera: %s %s, no \"filesize\" hint set!\n", cam->make.c_str(), cam->model.c_str());
     } else {
@@ -136,6 +222,36 @@ bool CameraMetaData::addCamera( Camera* cam )
   return true;
 }
 
+void CameraMetaData::removeCamera(const CameraId& id) {
+  auto cam = cameras.find(id);
+  if (cam == cameras.end())
+    return;
+
+  const Camera* old = cam->second;
+  cameras.erase(cam);
+  cameraIndex.erase(getKey(id.make, id.model, id.mode));
+
+  // the make + model index moves on to the next camera with the lowest mode
+  auto model = modelIndex.find(getKey(id.make, id.model));
+  if (model != modelIndex.end() && model->second == old) {
+    auto next = cameras.lower_bound(CameraId{id.make, id.model, ""});
+    if (next != cameras.end() && next->first.make == id.make &&
+        next->first.model == id.model)
+      model->second = next->second;
+    else
+      modelIndex.erase(model);
+  }
+
+  for (auto chdk = chdkCameras.begin(); chdk != chdkCameras.end();) {
+    if (chdk->second == old)
+      chdk = chdkCameras.erase(chdk);
+    else
+      ++chdk;
+  }
+
+  delete old;
+}
+
 void CameraMetaData::disableMake(const string &make) {
   for (const auto& cam : cameras) {
     if (cam.second->make == make)
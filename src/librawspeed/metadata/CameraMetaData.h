@@ -20,13 +20,16 @@
 
 #pragma once
 
-#include "common/Common.h" // for uint32
+#include "common/Common.h" // for uint32, uchar8
 #include <map>             // for map
 #include <string>          // for string
 #include <tuple>           // for tuple
+#include <unordered_map>   // for unordered_map
+#include <vector>          // for vector
 
 namespace RawSpeed {
 
+class Buffer;
 class Camera;
 
 struct CameraId {
@@ -44,6 +47,8 @@ class CameraMetaData final {
 public:
   CameraMetaData() = default;
   CameraMetaData(const char *docname);
+  // loads a precompiled camera database, as written by save()
+  explicit CameraMetaData(const Buffer* database);
   ~CameraMetaData();
   std::map<CameraId, Camera*> cameras;
   std::map<uint32,Camera*> chdkCameras;
@@ -63,8 +68,23 @@ public:
   void disableMake(const std::string &make);
   void disableCamera(const std::string &make, const std::string &model);
 
+  // adds the cameras from a cameras.xml style file, replacing the ones
+  // already known with the same make, model and mode
+  void loadXML(const char* docname);
+
+  // writes all cameras in the precompiled camera database format
+  void save(std::vector<uchar8>* database) const;
+
 protected:
   bool addCamera(Camera* cam);
+  void removeCamera(const CameraId& id);
+  void clear();
+
+  // Hash indexes over cameras, keyed by the trimmed make, model and mode,
+  // and by make and model only. The latter holds the camera with the
+  // lowest mode, the first one in cameras.
+  std::unordered_map<std::string, const Camera*> cameraIndex;
+  std::unordered_map<std::string, const Camera*> modelIndex;
 };
 
 } // namespace RawSpeed
@@ -21,11 +21,14 @@
 
 #include "rawspeedconfig.h" // for CMAKE_SOURCE_DIR
 
+#include "common/Common.h"           // for uchar8
+#include "io/Buffer.h"               // for Buffer
 #include "metadata/Camera.h"         // for Camera
 #include "metadata/CameraMetaData.h" // for CameraMetaData
 #include <gtest/gtest.h>             // for Test, ASSERT_NO_THROW, GetTestTypeId
 #include <memory>                    // for unique_ptr
 #include <string>                    // for string
+#include <vector>                    // for vector
 
 using namespace std;
 using namespace RawSpeed;
@@ -77,3 +80,30 @@ TEST(CameraMetaDataTest, PrefixSearch) {
                              "NIKON D3-with-some-bogus-prefix"));
   });
 }
+
+TEST(CameraMetaDataTest, Database) {
+  ASSERT_NO_THROW({
+    CameraMetaData Xml(camfile.c_str());
+
+    vector<uchar8> database;
+    Xml.save(&database);
+
+    const Buffer buf(database.data(), database.size());
+    CameraMetaData Data(&buf);
+
+    ASSERT_EQ(Xml.cameras.size(), Data.cameras.size());
+    ASSERT_EQ(Xml.chdkCameras.size(), Data.chdkCameras.size());
+
+    vector<uchar8> again;
+    Data.save(&again);
+    ASSERT_EQ(database, again);
+
+    // a truncated database throws, and the cameras read so far are freed
+    const Buffer truncated(database.data(), database.size() / 2);
+    ASSERT_ANY_THROW({ CameraMetaData Data2(&truncated); });
+  });
+
+  vector<uchar8> bogus(16, 0);
+  const Buffer buf(bogus.data(), bogus.size());
+  ASSERT_ANY_THROW({ CameraMetaData Data(&buf); });
+}
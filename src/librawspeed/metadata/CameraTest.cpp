@@ -150,3 +150,28 @@ TEST_P(BoolHintTest, HintsBool) {
   ASSERT_TRUE(hints.has(key));
   ASSERT_FALSE(hints.get(key, true));
 }
+
+TEST(CameraTest, HintsKnownKey) {
+  Hints hints;
+  ASSERT_FALSE(hints.has(HINT_WB_OFFSET));
+  ASSERT_EQ(hints.get(HINT_WB_OFFSET, 120), 120);
+
+  hints.add("wb_offset", "142");
+  ASSERT_TRUE(hints.has(HINT_WB_OFFSET));
+  ASSERT_TRUE(hints.has("wb_offset"));
+  ASSERT_FALSE(hints.has(HINT_OFFSET));
+  ASSERT_EQ(hints.get(HINT_WB_OFFSET, 120), 142);
+  ASSERT_EQ(hints.get(HINT_WB_OFFSET, 0.0), 142.0);
+  ASSERT_EQ(hints.get(HINT_WB_OFFSET, string()), "142");
+
+  const Hints hints2 = hints;
+  ASSERT_EQ(hints2.get(HINT_WB_OFFSET, 120), 142);
+}
+
+TEST(CameraTest, HintsFirstValueWins) {
+  Hints hints;
+  hints.add("pixel_aspect_ratio", "0.5");
+  hints.add("pixel_aspect_ratio", "2");
+  ASSERT_EQ(hints.get(HINT_PIXEL_ASPECT_RATIO, 1.0), 0.5);
+  ASSERT_EQ(hints.get("pixel_aspect_ratio", 1.0), 0.5);
+}
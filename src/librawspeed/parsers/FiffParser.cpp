@@ -62,13 +62,11 @@ RawDecoder* FiffParser::getDecoder() {
         // the offset will be interpreted relative to the rootIFD where this
         // subIFD gets inserted
         uint32 rawOffset = second_ifd - first_ifd;
-        subIFD->add(
-            make_unique<TiffEntry>(FUJI_STRIPOFFSETS, TIFF_OFFSET, 1,
-                                   ByteStream::createCopy(&rawOffset, 4)));
+        subIFD->add(TiffEntry(FUJI_STRIPOFFSETS, TIFF_OFFSET, 1,
+                              ByteStream::createCopy(&rawOffset, 4)));
         uint32 max_size = mInput->getSize() - second_ifd;
-        subIFD->add(
-            make_unique<TiffEntry>(FUJI_STRIPBYTECOUNTS, TIFF_LONG, 1,
-                                   ByteStream::createCopy(&max_size, 4)));
+        subIFD->add(TiffEntry(FUJI_STRIPBYTECOUNTS, TIFF_LONG, 1,
+                              ByteStream::createCopy(&max_size, 4)));
       }
     }
 
@@ -94,9 +92,8 @@ RawDecoder* FiffParser::getDecoder() {
           type = TIFF_SHORT;
 
         uint32 count = type == TIFF_SHORT ? length / 2 : length;
-        subIFD->add(make_unique<TiffEntry>(
-            (TiffTag)tag, type, count,
-            bytes.getSubStream(bytes.getPosition(), length)));
+        subIFD->add(TiffEntry((TiffTag)tag, type, count,
+                              bytes.getSubStream(bytes.getPosition(), length)));
 
         bytes.skipBytes(length);
       }
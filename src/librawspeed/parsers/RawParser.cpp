@@ -20,12 +20,16 @@
 */
 
 #include "parsers/RawParser.h"
+#include "common/Common.h"                // for uint32, uchar8, ushort16
+#include "common/Point.h"                 // for iPoint2D
 #include "decoders/AriDecoder.h"          // for AriDecoder
 #include "decoders/MrwDecoder.h"          // for MrwDecoder
 #include "decoders/NakedDecoder.h"        // for NakedDecoder
 #include "decoders/RafDecoder.h"          // for RafDecoder
 #include "decoders/RawDecoderException.h" // for RawDecoderException, ThrowRDE
 #include "io/Buffer.h"                    // for Buffer
+#include "io/Endianness.h"                // for getU32BE, getU16BE, getU16LE
+#include "io/IOException.h"               // for IOException
 #include "metadata/CameraMetaData.h"      // for CameraMetaData
 #include "parsers/CiffParser.h"           // for CiffParser
 #include "parsers/CiffParserException.h"  // for CiffParserException
@@ -34,7 +38,18 @@
 #include "parsers/TiffParser.h"           // for makeDecoder, parseTiff
 #include "parsers/TiffParserException.h"  // for TiffParserException
 #include "parsers/X3fParser.h"            // for X3fParser
-#include "tiff/TiffEntry.h"               // IWYU pragma: keep
+#include "tiff/CiffEntry.h"               // for CiffEntry
+#include "tiff/CiffIFD.h"                 // for CiffIFD
+#include "tiff/CiffTag.h"                 // for CiffTag::CIFF_JPEGIMAGE
+#include "tiff/TiffEntry.h"               // for TiffEntry
+#include "tiff/TiffIFD.h"                 // for TiffIFD, TiffRootIFDOwner
+#include "tiff/TiffTag.h"                 // for TiffTag::COMPRESSION, ...
+#include <algorithm>                      // for sort, unique
+#include <cstring>                        // for memcmp
+#include <memory>                         // for unique_ptr
+#include <vector>                         // for vector
+
+using namespace std;
 
 namespace RawSpeed {
 
@@ -42,6 +57,81 @@ class Camera;
 
 class RawDecoder;
 
+// Container formats, as told by the first bytes of the file
+enum RawSignature {
+  SIGNATURE_UNKNOWN,
+  SIGNATURE_MRW,
+  SIGNATURE_ARI,
+  SIGNATURE_RAF,
+  SIGNATURE_TIFF, // incl. the ORF and RW2 variants of the header
+  SIGNATURE_X3F,
+  SIGNATURE_CIFF
+};
+
+static RawSignature getSignature(const Buffer& file) {
+  const uchar8* data = file.getData(0, 16);
+
+  if (!memcmp(data, "\0MRM", 4))
+    return SIGNATURE_MRW;
+  if (!memcmp(data, "ARRI\x12\x34\x56\x78", 8))
+    return SIGNATURE_ARI;
+  if (!memcmp(data, "FUJIFILMCCD-RAW ", 16))
+    return SIGNATURE_RAF;
+  if (!memcmp(data, "FOVb", 4))
+    return SIGNATURE_X3F;
+  if (!memcmp(data, "II", 2) && !memcmp(data + 6, "HEAPCCDR", 8))
+    return SIGNATURE_CIFF;
+
+  // Same magic numbers as parseTiff() accepts
+  ushort16 magic;
+  if (!memcmp(data, "II", 2))
+    magic = getU16LE(data + 2);
+  else if (!memcmp(data, "MM", 2))
+    magic = getU16BE(data + 2);
+  else
+    return SIGNATURE_UNKNOWN;
+  if (magic == 42 || magic == 0x4f52 || magic == 0x5352 || magic == 0x55)
+    return SIGNATURE_TIFF;
+
+  return SIGNATURE_UNKNOWN;
+}
+
+RawDecoder* RawParser::getDecoderBySignature(const CameraMetaData* meta) {
+  try {
+    switch (getSignature(*mInput)) {
+    case SIGNATURE_MRW:
+      return new MrwDecoder(mInput);
+    case SIGNATURE_ARI:
+      return new AriDecoder(mInput);
+    case SIGNATURE_RAF: {
+      FiffParser p(mInput);
+      return p.getDecoder();
+    }
+    case SIGNATURE_TIFF:
+      return makeDecoder(parseTiff(*mInput), *mInput);
+    case SIGNATURE_X3F: {
+      X3fParser parser(mInput);
+      return parser.getDecoder();
+    }
+    case SIGNATURE_CIFF: {
+      CiffParser p(mInput);
+      p.parseData();
+      return p.getDecoder();
+    }
+    case SIGNATURE_UNKNOWN:
+      // Detect camera on filesize (CHDK).
+      if (meta != nullptr && meta->hasChdkCamera(mInput->getSize()))
+        return new NakedDecoder(mInput, meta->getChdkCamera(mInput->getSize()));
+    }
+  } catch (RawDecoderException&) {
+  } catch (TiffParserException&) {
+  } catch (FiffParserException&) {
+  } catch (CiffParserException&) {
+  } catch (IOException&) {
+  }
+  return nullptr;
+}
+
 RawDecoder* RawParser::getDecoder(const CameraMetaData* meta) {
   // We need some data.
   // For now it is 104 bytes for RAF/FUJIFIM images.
@@ -49,6 +139,13 @@ RawDecoder* RawParser::getDecoder(const CameraMetaData* meta) {
   if (mInput->getSize() <=  104)
     ThrowRDE("File too small");
 
+  // Parsers give up by throwing, so rather than trying one after the
+  // other, pick the one matching the file signature. Only if that fails
+  // try all of them.
+  RawDecoder* decoder = getDecoderBySignature(meta);
+  if (decoder)
+    return decoder;
+
   // MRW images are easy to check for, let's try that first
   if (MrwDecoder::isMRW(mInput)) {
     try {
@@ -109,4 +206,141 @@ RawDecoder* RawParser::getDecoder(const CameraMetaData* meta) {
   return nullptr;
 }
 
+// Reads the size of the JPEG at offset from its frame header. Returns false
+// if the data is not a JPEG, or one that can not be shown (e.g. lossless JPEG
+// compressed raw data).
+static bool getJpegSize(const Buffer& file, uint32 offset, uint32 size,
+                        iPoint2D* dim) {
+  if (size < 4 || !file.isValid(offset, size))
+    return false;
+  const uchar8* data = file.getData(offset, size);
+  if (data[0] != 0xFF || data[1] != 0xD8)
+    return false;
+
+  uint32 pos = 2;
+  while (pos + 4 <= size) {
+    if (data[pos] != 0xFF)
+      return false;
+    const uchar8 marker = data[pos + 1];
+    if (marker == 0xFF) { // Fill byte
+      pos++;
+      continue;
+    }
+    const uint32 length = getU16BE(&data[pos + 2]);
+    if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+      if (pos + 9 > size)
+        return false;
+      *dim = iPoint2D(getU16BE(&data[pos + 7]), getU16BE(&data[pos + 5]));
+      return true;
+    }
+    // Any other frame type, or the image data before a frame header
+    if ((marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 &&
+         marker != 0xC8 && marker != 0xCC) ||
+        marker == 0xDA)
+      return false;
+    pos += 2 + length;
+  }
+  return false;
+}
+
+static void addJpegPreview(const Buffer& file, uint32 offset, uint32 size,
+                           vector<RawPreview>* previews) {
+  iPoint2D dim;
+  if (getJpegSize(file, offset, size, &dim))
+    previews->push_back({RawPreview::JPEG, dim, offset, size});
+}
+
+// Adds the JPEG and uncompressed RGB images in ifd and its sub IFDs
+static void findTiffPreviews(const Buffer& file, const TiffIFD* ifd,
+                             vector<RawPreview>* previews) {
+  // Offsets are relative to the (sub) TIFF the entry is part of
+  auto offsetOf = [&file](const TiffEntry* t) {
+    return (uint32)(t->getRootIfdData().begin() - file.begin()) + t->getU32();
+  };
+
+  if (ifd->hasEntry(JPEGINTERCHANGEFORMAT) &&
+      ifd->hasEntry(JPEGINTERCHANGEFORMATLENGTH)) {
+    addJpegPreview(file, offsetOf(ifd->getEntry(JPEGINTERCHANGEFORMAT)),
+                   ifd->getEntry(JPEGINTERCHANGEFORMATLENGTH)->getU32(),
+                   previews);
+  }
+
+  if (ifd->hasEntry(COMPRESSION) && ifd->hasEntry(STRIPOFFSETS) &&
+      ifd->hasEntry(STRIPBYTECOUNTS) &&
+      ifd->getEntry(STRIPOFFSETS)->count == 1) {
+    const uint32 compression = ifd->getEntry(COMPRESSION)->getU32();
+    const uint32 offset = offsetOf(ifd->getEntry(STRIPOFFSETS));
+    const uint32 size = ifd->getEntry(STRIPBYTECOUNTS)->getU32();
+
+    if (compression == 6 || compression == 7) {
+      addJpegPreview(file, offset, size, previews);
+    } else if (compression == 1 && ifd->hasEntry(BITSPERSAMPLE) &&
+               ifd->getEntry(BITSPERSAMPLE)->getU32() == 8 &&
+               ifd->hasEntry(SAMPLESPERPIXEL) &&
+               ifd->getEntry(SAMPLESPERPIXEL)->getU32() == 3 &&
+               ifd->hasEntry(PHOTOMETRICINTERPRETATION) &&
+               ifd->getEntry(PHOTOMETRICINTERPRETATION)->getU32() == 2 &&
+               ifd->hasEntry(IMAGEWIDTH) && ifd->hasEntry(IMAGELENGTH)) {
+      iPoint2D dim(ifd->getEntry(IMAGEWIDTH)->getU32(),
+                   ifd->getEntry(IMAGELENGTH)->getU32());
+      if (dim.area() > 0 && (uint64)dim.area() * 3 <= size &&
+          file.isValid(offset, size))
+        previews->push_back({RawPreview::RGB8, dim, offset, size});
+    }
+  }
+
+  for (const auto& sub : ifd->getSubIFDs())
+    findTiffPreviews(file, sub.get(), previews);
+}
+
+vector<RawPreview> RawParser::getPreviews() {
+  vector<RawPreview> previews;
+
+  try {
+    if (RafDecoder::isRAF(mInput)) {
+      // The header points to the JPEG, which also holds the metadata
+      const uchar8* data = mInput->getData(0, 0x5C);
+      addJpegPreview(*mInput, getU32BE(data + 0x54), getU32BE(data + 0x58),
+                     &previews);
+    } else if (!MrwDecoder::isMRW(mInput) && !AriDecoder::isARI(mInput)) {
+      TiffRootIFDOwner root;
+      try {
+        root = parseTiff(*mInput);
+      } catch (TiffParserException&) {
+      }
+
+      if (root) {
+        findTiffPreviews(*mInput, root.get(), &previews);
+      } else {
+        CiffParser p(mInput);
+        p.parseData();
+        CiffEntry* jpeg = p.RootIFD()->getEntryRecursive(CIFF_JPEGIMAGE);
+        if (jpeg)
+          addJpegPreview(*mInput, jpeg->data_offset, jpeg->bytesize, &previews);
+      }
+    }
+  } catch (TiffParserException&) {
+  } catch (CiffParserException&) {
+  } catch (IOException&) {
+  }
+
+  // The same data may be referenced from several IFDs
+  sort(previews.begin(), previews.end(),
+       [](const RawPreview& a, const RawPreview& b) {
+         if (a.dim.area() != b.dim.area())
+           return a.dim.area() > b.dim.area();
+         return a.offset < b.offset;
+       });
+  previews.erase(unique(previews.begin(), previews.end(),
+                        [](const RawPreview& a, const RawPreview& b) {
+                          return a.offset == b.offset;
+                        }),
+                 previews.end());
+  return previews;
+}
+
+Buffer RawParser::getPreviewData(const RawPreview& preview) const {
+  return mInput->getSubView(preview.offset, preview.size);
+}
+
 } // namespace RawSpeed
@@ -20,20 +20,47 @@
 
 #pragma once
 
-namespace RawSpeed {
+#include "common/Common.h" // for uint32
+#include "common/Point.h"  // for iPoint2D
+#include "io/Buffer.h"     // for Buffer
+#include <vector>          // for vector
 
-class Buffer;
+namespace RawSpeed {
 
 class CameraMetaData;
 
 class RawDecoder;
 
+// A preview image (or thumbnail) embedded in a raw file
+struct RawPreview {
+  enum Format {
+    JPEG, // A complete (baseline or progressive) JPEG file
+    RGB8  // Uncompressed, interleaved 8 bit RGB, rows without padding
+  };
+  Format format;
+  iPoint2D dim;  // (0, 0) if unknown
+  uint32 offset; // Position of the data in the file
+  uint32 size;   // Size of the data in bytes
+};
+
 class RawParser final {
 public:
   RawParser(Buffer* inputData) : mInput(inputData) {}
   RawDecoder* getDecoder(const CameraMetaData* meta = nullptr);
 
+  /* Lists the previews embedded in the file, largest first. Only the */
+  /* container structure is parsed, the raw data is not decoded. */
+  std::vector<RawPreview> getPreviews();
+
+  /* Returns a view of the (still encoded) data of a preview, */
+  /* without copying it. It is only valid as long as the input is. */
+  Buffer getPreviewData(const RawPreview& preview) const;
+
 protected:
+  /* Returns the decoder for the format the file signature indicates, */
+  /* NULL if there is none, or it can not be used. */
+  RawDecoder* getDecoderBySignature(const CameraMetaData* meta);
+
   Buffer* mInput;
 };
 
@@ -0,0 +1,82 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/BitStreamWriter.h"
+#include "common/Common.h" // for uint32, uchar8, BitOrder_Plain, BitO...
+#include <algorithm>       // for reverse
+#include <cassert>         // for assert
+#include <stdexcept>       // for invalid_argument
+#include <utility>         // for move
+
+namespace RawSpeed {
+
+BitStreamWriter::BitStreamWriter(BitOrder order_, bool jpegStuffing_)
+    : order(order_), jpegStuffing(jpegStuffing_) {
+  if (jpegStuffing && order != BitOrder_Jpeg)
+    throw std::invalid_argument("JPEG stuffing needs the JPEG bit order");
+}
+
+void BitStreamWriter::flushBytes() {
+  for (; fillLevel >= 8; fillLevel -= 8) {
+    uchar8 byte;
+    if (order == BitOrder_Plain) {
+      byte = cache & 0xff;
+      cache >>= 8;
+    } else
+      byte = (cache >> (fillLevel - 8)) & 0xff;
+
+    data.push_back(byte);
+    if (jpegStuffing && byte == 0xFF)
+      data.push_back(0x00);
+  }
+}
+
+void BitStreamWriter::put(uint32 value, uint32 nbits) {
+  assert(nbits <= 32);
+  assert(nbits == 32 || value < (1ULL << nbits));
+
+  if (order == BitOrder_Plain)
+    cache |= (uint64)value << fillLevel;
+  else
+    cache = cache << nbits | value;
+  fillLevel += nbits;
+
+  flushBytes();
+}
+
+std::vector<uchar8> BitStreamWriter::finish() {
+  if (fillLevel)
+    put(jpegStuffing ? (1U << (8 - fillLevel)) - 1 : 0, 8 - fillLevel);
+
+  uint32 wordSize = 1;
+  if (order == BitOrder_Jpeg16)
+    wordSize = 2;
+  else if (order == BitOrder_Jpeg32)
+    wordSize = 4;
+
+  while (data.size() % wordSize)
+    data.push_back(0);
+
+  // the bytes were written in big endian order
+  for (auto i = data.begin(); wordSize > 1 && i != data.end(); i += wordSize)
+    std::reverse(i, i + wordSize);
+
+  return std::move(data);
+}
+
+} // namespace RawSpeed
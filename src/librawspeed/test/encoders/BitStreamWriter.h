@@ -0,0 +1,53 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h" // for uint32, uchar8, uint64, BitOrder
+#include <vector>          // for vector
+
+namespace RawSpeed {
+
+// The counterpart of the BitPump* classes: packs values of up to 32 bits into
+// a byte stream, in the bit order the matching pump reads it in.
+//   BitOrder_Plain:  LSB first (BitPumpPlain)
+//   BitOrder_Jpeg:   MSB first (BitPumpMSB, BitPumpJPEG)
+//   BitOrder_Jpeg16: MSB first within little endian 16 bit words (BitPumpMSB16)
+//   BitOrder_Jpeg32: MSB first within little endian 32 bit words (BitPumpMSB32)
+class BitStreamWriter final {
+  BitOrder order;
+  bool jpegStuffing;
+  std::vector<uchar8> data;
+  uint64 cache = 0;
+  uint32 fillLevel = 0;
+
+  void flushBytes();
+
+public:
+  // If jpegStuffing is set, a 0x00 is inserted after each 0xFF byte, so the
+  // stream can be used as the entropy coded segment of a JPEG.
+  explicit BitStreamWriter(BitOrder order, bool jpegStuffing = false);
+
+  void put(uint32 value, uint32 nbits);
+
+  // Pads the last byte (with ones for JPEG streams, with zeros otherwise)
+  // and the last word of the MSB16/MSB32 orders and returns the stream.
+  std::vector<uchar8> finish();
+};
+
+} // namespace RawSpeed
@@ -0,0 +1,695 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "common/Common.h"                          // for uint32, ushort16
+#include "common/Point.h"                           // for iPoint2D
+#include "common/RawImage.h"                        // for RawImage, RawIma...
+#include "common/RowBinner.h"                       // for RowBinner
+#include "decoders/RawDecoder.h"                    // for RawDecoder
+#include "decompressors/Cr2Decompressor.h"          // for Cr2Decompressor
+#include "decompressors/LJpegDecompressor.h"        // for LJpegDecompressor
+#include "decompressors/NikonDecompressor.h"        // for decompressNikon
+#include "decompressors/PentaxDecompressor.h"       // for decodePentax
+#include "decompressors/UncompressedDecompressor.h" // for Uncompressed...
+#include "io/Buffer.h"                              // for Buffer
+#include "io/ByteStream.h"                          // for ByteStream
+#include "metadata/CameraMetaData.h"                // for CameraMetaData
+#include "metadata/ColorFilterArray.h"              // for CFAColor::CFA_RED
+#include "parsers/RawParser.h"                      // for RawParser
+#include "test/encoders/ImageGenerator.h"           // for generateImage
+#include "test/encoders/LJpegEncoder.h"             // for encodeLJpeg, enc...
+#include "test/encoders/NikonEncoder.h"             // for encodeNikon
+#include "test/encoders/OlympusEncoder.h"           // for encodeOlympus
+#include "test/encoders/PanasonicEncoder.h"         // for encodePanasonic
+#include "test/encoders/PentaxEncoder.h"            // for encodePentax
+#include "test/encoders/SonyArw2Encoder.h"          // for encodeArw2
+#include "test/encoders/TiffBuilder.h"              // for TiffBuilder
+#include "test/encoders/UncompressedEncoder.h"      // for encodeUncompressed
+#include "tiff/TiffEntry.h"                         // for TiffEntry
+#include "tiff/TiffIFD.h"                           // for TiffIFD
+#include "tiff/TiffTag.h"                           // for TiffTag, MAKE
+#include <algorithm>                                // for min
+#include <cstdint>                                  // for uintptr_t
+#include <functional>                               // for function
+#include <gtest/gtest.h>                            // for AssertionResult
+#include <memory>                                   // for unique_ptr
+#include <vector>                                   // for vector
+
+using namespace std;
+using namespace RawSpeed;
+
+// The encoders are checked by decoding their output again, so these are round
+// trip tests of the encoders and the decompressors.
+
+static ::testing::AssertionResult sameImage(const RawImage& expected,
+                                            const RawImage& actual) {
+  if (expected->dim != actual->dim ||
+      expected->getCpp() != actual->getCpp())
+    return ::testing::AssertionFailure() << "different image layout";
+
+  const uint32 w = expected->dim.x * expected->getCpp();
+  for (int y = 0; y < expected->dim.y; y++) {
+    const auto* a = (const ushort16*)expected->getData(0, y);
+    const auto* b = (const ushort16*)actual->getData(0, y);
+    for (uint32 x = 0; x < w; x++) {
+      if (a[x] != b[x])
+        return ::testing::AssertionFailure()
+               << "sample " << x << " of row " << y << " is " << b[x]
+               << " instead of " << a[x];
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
+static Buffer toBuffer(const vector<uchar8>& data) {
+  return Buffer(data.data(), data.size());
+}
+
+// Binning while decoding has to give the same as binning the decoded image
+static void binImage(const RawImage& img, uint32 factor) {
+  img->cfa.setCFA(iPoint2D(2, 2), CFA_RED, CFA_GREEN, CFA_GREEN, CFA_BLUE);
+  img->bin(factor);
+}
+
+class LJpegEncoderTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(LJpegEncoderTest, LJpegRoundTrip) {
+  const uint32 nComp = GetParam();
+  for (uint32 noise : {0, 6, 14}) {
+    const RawImage img = generateImage({48, 20}, 1, 14, noise);
+    const vector<uchar8> data = encodeLJpeg(img, 14, nComp);
+
+    RawImage out = RawImage::create(img->dim);
+    LJpegDecompressor d(toBuffer(data), 0, out);
+    ASSERT_NO_THROW(d.decode(0, 0, false));
+    EXPECT_TRUE(sameImage(img, out));
+  }
+}
+
+TEST_P(LJpegEncoderTest, LJpegWithComponents) {
+  const uint32 nComp = GetParam();
+  const RawImage img = generateImage({24, 10}, nComp, 12, 4);
+  const vector<uchar8> data = encodeLJpeg(img, 12, nComp);
+
+  RawImage out = RawImage::create(img->dim, TYPE_USHORT16, nComp);
+  LJpegDecompressor d(toBuffer(data), 0, out);
+  ASSERT_NO_THROW(d.decode(0, 0, false));
+  EXPECT_TRUE(sameImage(img, out));
+}
+
+INSTANTIATE_TEST_CASE_P(Components, LJpegEncoderTest,
+                        ::testing::Values(2, 3, 4));
+
+class Cr2EncoderTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(Cr2EncoderTest, RoundTrip) {
+  const uint32 nComp = GetParam();
+  const RawImage img = generateImage({96, 64}, 1, 12, 5);
+
+  for (const auto& slices :
+       vector<vector<int>>{{}, {96}, {32, 32, 32}, {40, 40, 16}}) {
+    const vector<uchar8> data = encodeCr2(img, 12, nComp, slices);
+
+    RawImage out = RawImage::create(img->dim);
+    Cr2Decompressor d(toBuffer(data), 0, out);
+    ASSERT_NO_THROW(d.decode(slices));
+    EXPECT_TRUE(sameImage(img, out));
+  }
+}
+
+TEST_P(Cr2EncoderTest, DoubleWidthHalfHeight) {
+  const uint32 nComp = GetParam();
+  const RawImage img = generateImage({128, 24}, 1, 14, 7);
+  const vector<int> slices = {64, 64};
+  const vector<uchar8> data = encodeCr2(img, 14, nComp, slices);
+
+  RawImage out = RawImage::create(img->dim);
+  Cr2Decompressor d(toBuffer(data), 0, out);
+  ASSERT_NO_THROW(d.decode(slices));
+  EXPECT_TRUE(sameImage(img, out));
+}
+
+INSTANTIATE_TEST_CASE_P(Components, Cr2EncoderTest, ::testing::Values(2, 4));
+
+class Cr2sRawEncoderTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(Cr2sRawEncoderTest, RoundTrip) {
+  const uint32 superV = GetParam();
+  RawImage img = generateImage({96, 32}, 3, 15, 8);
+  img->isCFA = false;
+
+  // the header widths, the decompressor scales them by 3/2 for sRaw2
+  const vector<int> slices =
+      superV == 1 ? vector<int>{64, 64, 64} : vector<int>{144, 144};
+  const vector<uchar8> data = encodeCr2sRaw(img, 15, superV, slices);
+
+  // the frame header alone gives the subsampling, probing has no image data
+  RawImage probed = RawImage::create();
+  Cr2Decompressor header(toBuffer(data), 0, probed);
+  ASSERT_NO_THROW(header.parseFrameHeader());
+  EXPECT_EQ(iPoint2D(2, superV), probed->metadata.subsampling);
+  EXPECT_FALSE(probed->isAllocated());
+
+  RawImage out = RawImage::create(img->dim, TYPE_USHORT16, 3);
+  out->isCFA = false;
+  Cr2Decompressor d(toBuffer(data), 0, out);
+  ASSERT_NO_THROW(d.decode(slices));
+
+  // only Y of the odd pixels and the odd rows of sRaw1 is decoded
+  for (int y = 0; y < img->dim.y; y++) {
+    const auto* a = (const ushort16*)img->getData(0, y);
+    const auto* b = (const ushort16*)out->getData(0, y);
+    for (int x = 0; x < img->dim.x * 3; x++) {
+      const bool decoded = y % superV == 0 ? x % 6 < 4 : x % 3 == 0;
+      if (decoded) {
+        ASSERT_EQ(a[x], b[x]) << "sample " << x << " of row " << y;
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Subsampling, Cr2sRawEncoderTest,
+                        ::testing::Values(1, 2));
+
+using UncompressedType = std::tr1::tuple<int, BitOrder>;
+class UncompressedEncoderTest
+    : public ::testing::TestWithParam<UncompressedType> {};
+
+TEST_P(UncompressedEncoderTest, RoundTrip) {
+  const int bits = std::tr1::get<0>(GetParam());
+  const BitOrder order = std::tr1::get<1>(GetParam());
+  const RawImage img = generateImage({64, 8}, 1, bits, bits);
+  const vector<uchar8> data = encodeUncompressed(img, bits, order);
+
+  RawImage out = RawImage::create(img->dim);
+  UncompressedDecompressor u(toBuffer(data), 0, out, false);
+  iPoint2D size = img->dim;
+  iPoint2D pos(0, 0);
+  ASSERT_NO_THROW(
+      u.readUncompressedRaw(size, pos, size.x * bits / 8, bits, order));
+  EXPECT_TRUE(sameImage(img, out));
+}
+
+TEST_P(UncompressedEncoderTest, Binned) {
+  const int bits = std::tr1::get<0>(GetParam());
+  const BitOrder order = std::tr1::get<1>(GetParam());
+  const RawImage img = generateImage({64, 12}, 1, bits, bits);
+  const vector<uchar8> data = encodeUncompressed(img, bits, order);
+  const int pitch = img->dim.x * bits / 8;
+
+  RawImage out = RawImage::create();
+  out->dim = img->dim;
+  out->setBinning(2);
+  out->createData();
+  // two slices, the first one ends within a block
+  RowBinner rows(out);
+  for (int y : {0, 6}) {
+    UncompressedDecompressor u(toBuffer(data), y * pitch, out, false);
+    iPoint2D size(img->dim.x, 6);
+    iPoint2D pos(0, y);
+    ASSERT_NO_THROW(
+        u.readUncompressedRaw(size, pos, pitch, bits, order, &rows));
+  }
+  rows.finish();
+
+  binImage(img, 2);
+  EXPECT_TRUE(sameImage(img, out));
+}
+
+INSTANTIATE_TEST_CASE_P(
+    BitsAndOrders, UncompressedEncoderTest,
+    ::testing::Combine(::testing::Values(10, 12, 14, 16),
+                       ::testing::Values(BitOrder_Plain, BitOrder_Jpeg,
+                                         BitOrder_Jpeg16, BitOrder_Jpeg32)));
+
+TEST(NikonEncoderTest, RoundTrip) {
+  for (uint32 bits : {12, 14}) {
+    for (uint32 noise : {0U, 7U, bits}) {
+      const RawImage img = generateImage({64, 16}, 1, bits, noise);
+      vector<uchar8> meta;
+      const vector<uchar8> data = encodeNikon(img, bits, &meta);
+
+      RawImage out = RawImage::create(img->dim);
+      ASSERT_NO_THROW(decompressNikon(out, ByteStream(toBuffer(data), 0),
+                                      ByteStream(toBuffer(meta), 0), img->dim,
+                                      bits, true));
+      EXPECT_TRUE(sameImage(img, out));
+    }
+  }
+}
+
+TEST(PentaxEncoderTest, RoundTrip) {
+  for (uint32 noise : {0, 7, 12}) {
+    const RawImage img = generateImage({64, 16}, 1, 12, noise);
+    const vector<uchar8> data = encodePentax(img);
+
+    RawImage out = RawImage::create(img->dim);
+    TiffIFD root;
+    ASSERT_NO_THROW(decodePentax(out, ByteStream(toBuffer(data), 0), &root));
+    EXPECT_TRUE(sameImage(img, out));
+  }
+}
+
+// setup can change the decoder options before decoding
+static RawImage
+decodeFile(const vector<uchar8>& file,
+           const function<void(RawDecoder*)>& setup = nullptr) {
+  Buffer buf = toBuffer(file);
+  RawParser parser(&buf);
+  unique_ptr<RawDecoder> decoder(parser.getDecoder());
+  decoder->uncorrectedRawValues = true;
+  if (setup)
+    setup(decoder.get());
+  return decoder->decodeRaw();
+}
+
+static function<void(RawDecoder*)> withBinning(uint32 factor) {
+  return [factor](RawDecoder* d) { d->binning = factor; };
+}
+
+// Encodes img as an ARW2 file, expected is what it decodes to
+static vector<uchar8> buildArw2(const RawImage& img, RawImage* expected) {
+  const vector<uchar8> data = encodeArw2(img, expected);
+
+  TiffBuilder tiff;
+  tiff.addString(MAKE, "SONY");
+  tiff.addString(MODEL, "synthetic");
+  tiff.addLongs(IMAGEWIDTH, {(uint32)img->dim.x});
+  tiff.addLongs(IMAGELENGTH, {(uint32)img->dim.y});
+  tiff.addShorts(BITSPERSAMPLE, {8});
+  tiff.addShorts(COMPRESSION, {32767});
+  tiff.addLongs(STRIPBYTECOUNTS, {(uint32)data.size()});
+  tiff.addShorts(SONY_CURVE, {0, 0, 0, 0});
+  return tiff.build(STRIPOFFSETS, data);
+}
+
+TEST(SonyArw2EncoderTest, RoundTrip) {
+  for (uint32 noise : {0, 6, 12}) {
+    const RawImage img = generateImage({96, 16}, 1, 12, noise);
+    RawImage expected = RawImage::create();
+    const vector<uchar8> file = buildArw2(img, &expected);
+
+    RawImage out = RawImage::create();
+    ASSERT_NO_THROW(out = decodeFile(file));
+    EXPECT_TRUE(sameImage(expected, out));
+  }
+}
+
+TEST(SonyArw2EncoderTest, Binned) {
+  for (uint32 factor : {2, 4}) {
+    const RawImage img = generateImage({96, 20}, 1, 12, 12);
+    RawImage expected = RawImage::create();
+    const vector<uchar8> file = buildArw2(img, &expected);
+
+    RawImage out = RawImage::create();
+    ASSERT_NO_THROW(out = decodeFile(file, withBinning(factor)));
+    EXPECT_EQ(factor, out->getBinning());
+    binImage(expected, factor);
+    EXPECT_TRUE(sameImage(expected, out));
+  }
+}
+
+// Encodes img as an RW2 file, expected is what it decodes to
+static vector<uchar8> buildRw2(const RawImage& img, RawImage* expected) {
+  const vector<uchar8> data = encodePanasonic(img, 0x2008, expected);
+
+  TiffBuilder tiff(0x55);
+  tiff.addString(MAKE, "Panasonic");
+  tiff.addString(MODEL, "synthetic");
+  tiff.addShorts((TiffTag)2, {(ushort16)img->dim.x});
+  tiff.addShorts((TiffTag)3, {(ushort16)img->dim.y});
+  return tiff.build(PANASONIC_STRIPOFFSET, data);
+}
+
+TEST(PanasonicEncoderTest, RoundTrip) {
+  for (uint32 noise : {0, 6, 12}) {
+    const RawImage img = generateImage({112, 16}, 1, 12, noise);
+    RawImage expected = RawImage::create();
+    const vector<uchar8> file = buildRw2(img, &expected);
+
+    RawImage out = RawImage::create();
+    ASSERT_NO_THROW(out = decodeFile(file));
+    EXPECT_TRUE(sameImage(expected, out));
+  }
+}
+
+TEST(PanasonicEncoderTest, Binned) {
+  for (uint32 factor : {2, 4}) {
+    const RawImage img = generateImage({112, 20}, 1, 12, 12);
+    RawImage expected = RawImage::create();
+    const vector<uchar8> file = buildRw2(img, &expected);
+
+    RawImage out = RawImage::create();
+    ASSERT_NO_THROW(out = decodeFile(file, withBinning(factor)));
+    EXPECT_EQ(factor, out->getBinning());
+    binImage(expected, factor);
+    EXPECT_TRUE(sameImage(expected, out));
+  }
+}
+
+static vector<uchar8> buildOrf(const RawImage& img) {
+  const vector<uchar8> data = encodeOlympus(img);
+
+  TiffBuilder tiff(0x4f52);
+  tiff.addString(MAKE, "OLYMPUS IMAGING CORP.");
+  tiff.addString(MODEL, "synthetic");
+  tiff.addLongs(IMAGEWIDTH, {(uint32)img->dim.x});
+  tiff.addLongs(IMAGELENGTH, {(uint32)img->dim.y});
+  tiff.addShorts(COMPRESSION, {1});
+  tiff.addLongs(STRIPBYTECOUNTS, {(uint32)data.size()});
+  return tiff.build(STRIPOFFSETS, data);
+}
+
+TEST(OlympusEncoderTest, RoundTrip) {
+  for (uint32 bits : {12, 16}) {
+    for (uint32 noise : {0U, 6U, bits}) {
+      const RawImage img = generateImage({64, 16}, 1, bits, noise);
+
+      RawImage out = RawImage::create();
+      ASSERT_NO_THROW(out = decodeFile(buildOrf(img)));
+      EXPECT_TRUE(sameImage(img, out));
+    }
+  }
+}
+
+// Hands out 16 byte aligned buffers (plus misalign) with pitch rows, and
+// counts how often each of them is released
+class TestAllocator final : public RawImageAllocator {
+  struct Allocation {
+    unique_ptr<uchar8[]> memory;
+    uchar8* data;
+    size_t size;
+    int releases;
+  };
+
+public:
+  uint32 pitch = 0; // 0: the default pitch, plus 32 bytes
+  uint32 misalign = 0;
+  vector<Allocation> allocations;
+
+  uint32 getPitch(const iPoint2D& dim, uint32 rowBytes) override {
+    return pitch ? pitch : roundUp(rowBytes, 16) + 32;
+  }
+
+  uchar8* allocate(const iPoint2D& dim, uint32 rowPitch) override {
+    const size_t size = (size_t)dim.y * rowPitch;
+    Allocation a;
+    a.memory.reset(new uchar8[size + 32]);
+    a.data = a.memory.get() + (16 - (uintptr_t)a.memory.get() % 16) + misalign;
+    a.size = size;
+    a.releases = 0;
+    allocations.push_back(move(a));
+    return allocations.back().data;
+  }
+
+  void release(uchar8* data) override {
+    for (auto& a : allocations) {
+      if (a.data == data)
+        a.releases++;
+    }
+  }
+
+  bool owns(const uchar8* p) const {
+    for (const auto& a : allocations) {
+      if (p >= a.data && p < a.data + a.size)
+        return true;
+    }
+    return false;
+  }
+
+  ::testing::AssertionResult allReleasedOnce() const {
+    for (const auto& a : allocations) {
+      if (a.releases != 1)
+        return ::testing::AssertionFailure()
+               << "buffer released " << a.releases << " times";
+    }
+    return ::testing::AssertionSuccess();
+  }
+};
+
+TEST(RawImageAllocatorTest, Validation) {
+  const iPoint2D dim(64, 8); // 128 bytes per row
+  {
+    TestAllocator a;
+    a.pitch = 112; // less than a row
+    ASSERT_ANY_THROW(RawImage::create(dim, TYPE_USHORT16, 1, &a));
+    a.pitch = 136; // not a multiple of 16
+    ASSERT_ANY_THROW(RawImage::create(dim, TYPE_USHORT16, 1, &a));
+    EXPECT_TRUE(a.allocations.empty());
+  }
+  {
+    TestAllocator a;
+    a.misalign = 8;
+    ASSERT_ANY_THROW(RawImage::create(dim, TYPE_USHORT16, 1, &a));
+    ASSERT_EQ(1U, a.allocations.size());
+    EXPECT_TRUE(a.allReleasedOnce());
+  }
+  {
+    TestAllocator a;
+    {
+      RawImage img = RawImage::create(dim, TYPE_USHORT16, 1, &a);
+      EXPECT_EQ(160U, img->pitch);
+      EXPECT_TRUE(a.owns(img->getData(0, 0)));
+      EXPECT_TRUE(a.owns(img->getData(dim.x - 1, dim.y - 1)));
+      ASSERT_EQ(1U, a.allocations.size());
+      EXPECT_EQ(0, a.allocations[0].releases);
+    }
+    EXPECT_TRUE(a.allReleasedOnce());
+  }
+}
+
+TEST(RawImageAllocatorTest, Decode) {
+  const RawImage img = generateImage({96, 16}, 1, 12, 12);
+  RawImage expected = RawImage::create();
+  const vector<uchar8> file = buildArw2(img, &expected);
+
+  TestAllocator a;
+  {
+    RawImage out = RawImage::create();
+    ASSERT_NO_THROW(out = decodeFile(
+                        file, [&a](RawDecoder* d) { d->allocator = &a; }));
+    EXPECT_TRUE(sameImage(expected, out));
+    ASSERT_EQ(1U, a.allocations.size());
+    EXPECT_EQ(0, a.allocations[0].releases);
+    EXPECT_EQ(roundUp(img->dim.x * 2, 16) + 32, out->pitch);
+    for (int y = 0; y < out->dim.y; y++)
+      ASSERT_TRUE(a.owns(out->getData(0, y)));
+
+    // binning replaces the buffer with a new one from the same allocator
+    binImage(out, 2);
+    ASSERT_EQ(2U, a.allocations.size());
+    EXPECT_EQ(1, a.allocations[0].releases);
+    EXPECT_TRUE(a.owns(out->getData(0, 0)));
+  }
+  EXPECT_TRUE(a.allReleasedOnce());
+}
+
+static RawImage decodeRegion(const vector<uchar8>& file,
+                             const iRectangle2D& roi) {
+  Buffer buf = toBuffer(file);
+  RawParser parser(&buf);
+  unique_ptr<RawDecoder> decoder(parser.getDecoder());
+  decoder->uncorrectedRawValues = true;
+  decoder->roi = roi;
+  RawImage raw = decoder->decodeRaw();
+  const CameraMetaData meta;
+  decoder->decodeMetaData(&meta);
+  return raw;
+}
+
+// The window covers roi inside of the crop, and holds the same pixels and
+// CFA as the same part of the whole image
+static ::testing::AssertionResult sameWindow(const RawImage& full,
+                                             const RawImage& window,
+                                             const iRectangle2D& roi) {
+  const iRectangle2D fullCrop(full->getWindowPos() + full->getCropOffset(),
+                              full->dim);
+  const iRectangle2D crop(window->getWindowPos() + window->getCropOffset(),
+                          window->dim);
+  if (!crop.isThisInside(fullCrop))
+    return ::testing::AssertionFailure() << "window outside of the crop";
+  if (!roi.getOverlap(fullCrop).isThisInside(crop))
+    return ::testing::AssertionFailure() << "window does not cover the roi";
+
+  const iPoint2D shift = crop.pos - fullCrop.pos;
+  for (int y = 0; y < 2; y++) {
+    for (int x = 0; x < 2; x++) {
+      if (window->cfa.getColorAt(x, y) !=
+          full->cfa.getColorAt(x + shift.x, y + shift.y))
+        return ::testing::AssertionFailure() << "different CFA at " << x
+                                             << ", " << y;
+    }
+  }
+
+  for (int y = 0; y < window->dim.y; y++) {
+    const auto* a = (const ushort16*)full->getData(shift.x, y + shift.y);
+    const auto* b = (const ushort16*)window->getData(0, y);
+    for (int x = 0; x < window->dim.x; x++) {
+      if (a[x] != b[x])
+        return ::testing::AssertionFailure()
+               << "pixel " << x << " of row " << y << " is " << b[x]
+               << " instead of " << a[x];
+    }
+  }
+  return ::testing::AssertionSuccess();
+}
+
+TEST(RegionOfInterestTest, SonyArw2) {
+  const RawImage img = generateImage({160, 24}, 1, 12, 12);
+  RawImage expected = RawImage::create();
+  const vector<uchar8> file = buildArw2(img, &expected);
+
+  RawImage full = RawImage::create();
+  ASSERT_NO_THROW(full = decodeRegion(file, iRectangle2D()));
+  EXPECT_TRUE(sameImage(expected, full));
+
+  for (const iRectangle2D& roi :
+       {iRectangle2D(37, 5, 50, 9), iRectangle2D(64, 0, 32, 24),
+        iRectangle2D(1, 1, 1, 1), iRectangle2D(101, 13, 80, 20)}) {
+    RawImage window = RawImage::create();
+    ASSERT_NO_THROW(window = decodeRegion(file, roi));
+    EXPECT_TRUE(sameWindow(full, window, roi));
+    // only whole 32 pixel groups are decoded
+    EXPECT_GT(full->getUncroppedDim().x, window->getUncroppedDim().x);
+  }
+}
+
+// An uncompressed 16 bit DNG of img, in strips, with the top rows masked
+static vector<uchar8> buildDng(const RawImage& img, uint32 rowsPerStrip,
+                               uint32 maskedRows) {
+  const vector<uchar8> data = encodeUncompressed(img, 16, BitOrder_Plain);
+  const uint32 pitch = img->dim.x * 2;
+
+  vector<vector<uchar8>> strips;
+  vector<uint32> counts;
+  for (uint32 y = 0; y < (uint32)img->dim.y; y += rowsPerStrip) {
+    const uint32 rows = min(rowsPerStrip, img->dim.y - y);
+    strips.emplace_back(data.begin() + y * pitch,
+                        data.begin() + (y + rows) * pitch);
+    counts.push_back(rows * pitch);
+  }
+
+  const uint32 w = img->dim.x;
+  const uint32 h = img->dim.y;
+  TiffBuilder tiff;
+  tiff.addBytes(DNGVERSION, {1, 4, 0, 0});
+  tiff.addString(MAKE, "synthetic");
+  tiff.addString(MODEL, "dng");
+  tiff.addLongs(IMAGEWIDTH, {w});
+  tiff.addLongs(IMAGELENGTH, {h});
+  tiff.addShorts(BITSPERSAMPLE, {16});
+  tiff.addShorts(COMPRESSION, {1});
+  tiff.addShorts(PHOTOMETRICINTERPRETATION, {32803});
+  tiff.addShorts(SAMPLESPERPIXEL, {1});
+  tiff.addLongs(ROWSPERSTRIP, {rowsPerStrip});
+  tiff.addLongs(STRIPBYTECOUNTS, counts);
+  tiff.addShorts(CFAREPEATPATTERNDIM, {2, 2});
+  tiff.addBytes(CFAPATTERN, {0, 1, 1, 2});
+  // top, left, bottom, right; the active area starts at an odd column
+  tiff.addLongs(ACTIVEAREA, {maskedRows, 3, h - 2, w - 3});
+  tiff.addLongs(MASKEDAREAS, {0, 0, maskedRows, w});
+  return tiff.build(STRIPOFFSETS, strips);
+}
+
+TEST(RegionOfInterestTest, DngStrips) {
+  const uint32 masked = 4;
+  const RawImage img = generateImage({64, 48}, 1, 12, 12);
+  // a different black level for each CFA color, with some noise
+  for (uint32 y = 0; y < masked; y++) {
+    auto* row = (ushort16*)img->getData(0, y);
+    for (int x = 0; x < img->dim.x; x++)
+      row[x] = 60 + 8 * (y & 1) + 3 * (x & 1) + (x * 5 + y) % 4;
+  }
+  const vector<uchar8> file = buildDng(img, 8, masked);
+
+  RawImage full = RawImage::create();
+  ASSERT_NO_THROW(full = decodeRegion(file, iRectangle2D()));
+  ASSERT_FALSE(full->blackAreas.empty());
+  // as scaleBlackWhite() does, unless the decoder has set them
+  auto blackLevels = [](const RawImage& raw) {
+    if (raw->blackLevelSeparate[0] < 0)
+      raw->calculateBlackAreas();
+    return vector<int>(raw->blackLevelSeparate, raw->blackLevelSeparate + 4);
+  };
+  const vector<int> black = blackLevels(full);
+
+  for (const iRectangle2D& roi :
+       {iRectangle2D(13, 21, 20, 15), iRectangle2D(0, 0, 64, 48),
+        iRectangle2D(5, 2, 10, 10), iRectangle2D(40, 33, 30, 30)}) {
+    RawImage window = RawImage::create();
+    ASSERT_NO_THROW(window = decodeRegion(file, roi));
+    EXPECT_TRUE(sameWindow(full, window, roi));
+    EXPECT_TRUE(window->errors.empty());
+    EXPECT_EQ(black, blackLevels(window));
+  }
+}
+
+// A single strip of uncompressed 16 bit data, for the NEF and SRW decoders
+static vector<uchar8> buildUncompressed(const RawImage& img, const char* make,
+                                        ushort16 compression) {
+  const vector<uchar8> data = encodeUncompressed(img, 16, BitOrder_Plain);
+
+  TiffBuilder tiff;
+  tiff.addString(MAKE, make);
+  tiff.addString(MODEL, "synthetic");
+  tiff.addLongs(IMAGEWIDTH, {(uint32)img->dim.x});
+  tiff.addLongs(IMAGELENGTH, {(uint32)img->dim.y});
+  tiff.addShorts(BITSPERSAMPLE, {16});
+  tiff.addShorts(COMPRESSION, {compression});
+  tiff.addLongs(ROWSPERSTRIP, {(uint32)img->dim.y});
+  tiff.addLongs(STRIPBYTECOUNTS, {(uint32)data.size()});
+  tiff.addShorts(CFAREPEATPATTERNDIM, {2, 2});
+  tiff.addBytes(CFAPATTERN, {0, 1, 1, 2});
+  return tiff.build(STRIPOFFSETS, data);
+}
+
+// probeMetadata() sets up the same image as decoding does, without pixels
+TEST(ProbeMetadataTest, NeverAllocates) {
+  const RawImage img = generateImage({96, 16}, 1, 12, 12);
+  RawImage expected = RawImage::create();
+  const vector<uchar8> files[] = {
+      buildArw2(img, &expected),
+      buildRw2(generateImage({112, 16}, 1, 12, 12), &expected),
+      buildOrf(img),
+      buildDng(generateImage({64, 48}, 1, 12, 12), 8, 4),
+      buildUncompressed(img, "NIKON CORPORATION", 1),
+      buildUncompressed(img, "SAMSUNG", 32769)};
+  const CameraMetaData meta;
+
+  for (const auto& file : files) {
+    Buffer buf = toBuffer(file);
+    RawParser parser(&buf);
+    unique_ptr<RawDecoder> probing(parser.getDecoder());
+    TestAllocator a;
+    probing->allocator = &a;
+    RawImage probed = RawImage::create();
+    ASSERT_NO_THROW(probed = probing->probeMetadata(&meta));
+    EXPECT_FALSE(probed->isAllocated());
+    EXPECT_TRUE(a.allocations.empty());
+
+    unique_ptr<RawDecoder> decoding(parser.getDecoder());
+    decoding->uncorrectedRawValues = true;
+    RawImage decoded = RawImage::create();
+    ASSERT_NO_THROW(decoded = decoding->decodeRaw());
+    ASSERT_NO_THROW(decoding->decodeMetaData(&meta));
+    EXPECT_EQ(decoded->getUncroppedDim(), probed->getUncroppedDim());
+    EXPECT_EQ(decoded->dim, probed->dim);
+    EXPECT_EQ(decoded->getCpp(), probed->getCpp());
+    EXPECT_EQ(decoded->isCFA, probed->isCFA);
+  }
+}
@@ -0,0 +1,158 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/HuffmanEncoder.h"
+#include "common/Common.h"                 // for uint32, uchar8, uint64
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include <algorithm>                       // for copy
+#include <cstdlib>                         // for abs
+#include <stdexcept>                       // for invalid_argument
+
+namespace RawSpeed {
+
+HuffmanEncoder::HuffmanEncoder(const std::array<uchar8, 16>& nCodesPerLength_,
+                               const std::vector<uchar8>& codeValues_)
+    : nCodesPerLength(nCodesPerLength_), codeValues(codeValues_) {
+  codeLengths.fill(0);
+
+  // Figure C.1 and C.2: generate the codes
+  uint32 code = 0;
+  uint32 i = 0;
+  for (uint32 l = 1; l <= 16; l++) {
+    for (uint32 n = 0; n < nCodesPerLength[l - 1]; n++, i++) {
+      if (i >= codeValues.size() || codeValues[i] > 16)
+        throw std::invalid_argument("Invalid Huffman table description");
+      codes[codeValues[i]] = code++;
+      codeLengths[codeValues[i]] = l;
+    }
+    code <<= 1;
+  }
+}
+
+HuffmanEncoder HuffmanEncoder::optimal(std::array<uint64, 17> histogram) {
+  // symbol 17 is reserved, so no code consists of only ones
+  std::array<uint64, 18> freq;
+  std::copy(histogram.begin(), histogram.end(), freq.begin());
+  freq[17] = 1;
+
+  // an unused table still needs one code
+  bool empty = true;
+  for (uint32 i = 0; i < 17; i++)
+    empty &= freq[i] == 0;
+  if (empty)
+    freq[0] = 1;
+
+  // Figure K.1: find the code sizes
+  std::array<int, 18> codeSize;
+  std::array<int, 18> others;
+  codeSize.fill(0);
+  others.fill(-1);
+
+  while (true) {
+    // the two least frequent symbols, on ties the higher one
+    int v1 = -1;
+    int v2 = -1;
+    for (int i = 0; i < 18; i++) {
+      if (!freq[i])
+        continue;
+      if (v1 < 0 || freq[i] <= freq[v1]) {
+        v2 = v1;
+        v1 = i;
+      } else if (v2 < 0 || freq[i] <= freq[v2])
+        v2 = i;
+    }
+    if (v2 < 0)
+      break;
+
+    freq[v1] += freq[v2];
+    freq[v2] = 0;
+
+    for (codeSize[v1]++; others[v1] >= 0; codeSize[v1]++)
+      v1 = others[v1];
+    others[v1] = v2;
+    for (codeSize[v2]++; others[v2] >= 0; codeSize[v2]++)
+      v2 = others[v2];
+  }
+
+  // Figure K.2 and K.3: count the sizes and limit them to 16 bits
+  std::array<uint32, 33> bits;
+  bits.fill(0);
+  for (int size : codeSize)
+    bits[size]++;
+  bits[0] = 0;
+
+  for (int i = 32; i > 16; i--) {
+    while (bits[i] > 0) {
+      int j = i - 2;
+      while (bits[j] == 0)
+        j--;
+      bits[i] -= 2;
+      bits[i - 1]++;
+      bits[j + 1] += 2;
+      bits[j]--;
+    }
+  }
+
+  // remove the reserved code, it is one of the longest
+  int longest = 16;
+  while (bits[longest] == 0)
+    longest--;
+  bits[longest]--;
+
+  std::array<uchar8, 16> nCodes;
+  for (int l = 1; l <= 16; l++)
+    nCodes[l - 1] = bits[l];
+
+  // Figure K.4: the values ordered by code size, the limiting above only
+  // moved codes between the sizes, so the order is kept.
+  std::vector<uchar8> values;
+  for (int size = 1; size <= 32; size++) {
+    for (int i = 0; i < 17; i++) {
+      if (codeSize[i] == size)
+        values.push_back(i);
+    }
+  }
+
+  return HuffmanEncoder(nCodes, values);
+}
+
+uint32 __attribute__((const)) HuffmanEncoder::diffLength(int diff) {
+  uint32 len = 0;
+  for (uint32 d = std::abs(diff); d; d >>= 1)
+    len++;
+  return len;
+}
+
+void HuffmanEncoder::encode(BitStreamWriter* bs, int diff) const {
+  const uint32 len = diffLength(diff);
+
+  // HuffmanTable only decodes 16 bit differences in the DNG compatible way
+  // when they are not in its lookup table, do not generate them at all.
+  if (len > 15)
+    throw std::invalid_argument("Difference does not fit into 15 bits");
+  if (!codeLengths[len])
+    throw std::invalid_argument("No Huffman code for difference length");
+
+  bs->put(codes[len], codeLengths[len]);
+
+  // negative differences are stored as one's complement
+  if (len)
+    bs->put((diff < 0 ? diff - 1 : diff) & ((1U << len) - 1), len);
+}
+
+} // namespace RawSpeed
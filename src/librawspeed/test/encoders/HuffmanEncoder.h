@@ -0,0 +1,62 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h" // for uchar8, uint32, uint64
+#include <array>           // for array
+#include <vector>          // for vector
+
+namespace RawSpeed {
+
+class BitStreamWriter;
+
+// The counterpart of HuffmanTable::decodeNext(): writes a difference as the
+// Huffman code of its bit length (the "ssss" value of the JPEG spec),
+// followed by the difference bits.
+class HuffmanEncoder final {
+  // index is length of code - 1, like in the DHT segment
+  std::array<uchar8, 16> nCodesPerLength;
+  std::vector<uchar8> codeValues;
+
+  // index is the ssss value, a length of 0 means the value has no code
+  std::array<uint32, 17> codes;
+  std::array<uchar8, 17> codeLengths;
+
+public:
+  // The same description as in a DHT segment: the number of codes of each
+  // length, followed by the coded values, ordered by code length.
+  HuffmanEncoder(const std::array<uchar8, 16>& nCodesPerLength,
+                 const std::vector<uchar8>& codeValues);
+
+  // An optimal table for the given ssss histogram, with codes of at most 16
+  // bits and no all-ones code (JPEG Annex K.2 and K.3).
+  static HuffmanEncoder optimal(std::array<uint64, 17> histogram);
+
+  // the ssss value of a difference
+  static uint32 __attribute__((const)) diffLength(int diff);
+
+  const std::array<uchar8, 16>& getNCodesPerLength() const {
+    return nCodesPerLength;
+  }
+  const std::vector<uchar8>& getCodeValues() const { return codeValues; }
+
+  void encode(BitStreamWriter* bs, int diff) const;
+};
+
+} // namespace RawSpeed
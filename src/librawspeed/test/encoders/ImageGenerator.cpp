@@ -0,0 +1,56 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/ImageGenerator.h"
+#include "common/Common.h"   // for uint32, ushort16, make_unique
+#include "common/Point.h"    // for iPoint2D
+#include "common/RawImage.h" // for RawImage, RawImageData, TYPE_USHORT16
+#include <memory>            // for unique_ptr
+#include <random>            // for mt19937, uniform_int_distribution
+#include <stdexcept>         // for invalid_argument
+
+namespace RawSpeed {
+
+RawImage generateImage(const iPoint2D& dim, uint32 cpp, uint32 bits,
+                       uint32 noiseBits, uint32 seed) {
+  if (bits < 1 || bits > 16 || noiseBits > bits)
+    throw std::invalid_argument("Invalid bit depth");
+
+  RawImage img = RawImage::create(dim, TYPE_USHORT16, cpp);
+
+  const uint32 noiseMax = (1U << noiseBits) - 1;
+  const uint32 rampMax = (1U << bits) - 1 - noiseMax;
+
+  // the state of mt19937 is ~5 KiB, too much for the stack
+  auto gen = make_unique<std::mt19937>(seed);
+  std::uniform_int_distribution<uint32> noise(0, noiseMax);
+
+  for (int y = 0; y < dim.y; y++) {
+    auto* dest = (ushort16*)img->getDataUncropped(0, y);
+    for (uint32 x = 0; x < dim.x * cpp; x++) {
+      // a triangle wave, so there are no steps in the ramp
+      const uint32 t = (x / cpp + 2 * y) % 1024;
+      const uint32 ramp = (t < 512 ? t : 1023 - t) * rampMax / 511;
+      dest[x] = ramp + noise(*gen);
+    }
+  }
+
+  return img;
+}
+
+} // namespace RawSpeed
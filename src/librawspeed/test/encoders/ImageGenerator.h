@@ -0,0 +1,35 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h"   // for uint32
+#include "common/RawImage.h" // for RawImage
+
+namespace RawSpeed {
+
+class iPoint2D;
+
+// A deterministic image of cpp components of the given bit depth: a smooth
+// ramp, with uniformly distributed noise of noiseBits bits on top. The noise
+// sets the entropy of the image, from a ramp that compresses very well
+// (noiseBits == 0) up to random data (noiseBits == bits).
+RawImage generateImage(const iPoint2D& dim, uint32 cpp, uint32 bits,
+                       uint32 noiseBits, uint32 seed = 0);
+
+} // namespace RawSpeed
@@ -0,0 +1,313 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/LJpegEncoder.h"
+#include "common/Common.h"                 // for uint32, ushort16, uchar8
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include "test/encoders/HuffmanEncoder.h"  // for HuffmanEncoder
+#include <algorithm>                       // for copy_n
+#include <array>                           // for array
+#include <stdexcept>                       // for invalid_argument
+
+using namespace std;
+
+namespace RawSpeed {
+
+namespace {
+
+struct Frame {
+  uint32 w;
+  uint32 h;
+  uint32 cps;
+  // of the first component, the others are never subsampled
+  uint32 superH = 1;
+  uint32 superV = 1;
+};
+
+// Turns the samples of the scan into differences and codes them. The scan is
+// traversed twice: the first pass only collects the histograms of the
+// difference lengths, from which the Huffman tables for the second pass are
+// built.
+class ScanCoder final {
+  const uint32 precision;
+  array<array<uint64, 17>, 4> histograms{};
+  vector<HuffmanEncoder> tables;
+  BitStreamWriter bs{BitOrder_Jpeg, true};
+
+public:
+  explicit ScanCoder(uint32 precision_) : precision(precision_) {}
+
+  void code(uint32 comp, ushort16* pred, ushort16 value) {
+    if (value >> precision)
+      throw invalid_argument("Sample does not fit into precision");
+
+    const int diff = value - *pred;
+    *pred = value;
+
+    if (tables.empty())
+      histograms[comp][HuffmanEncoder::diffLength(diff)]++;
+    else
+      tables[comp].encode(&bs, diff);
+  }
+
+  const vector<HuffmanEncoder>& buildTables(uint32 cps) {
+    for (uint32 i = 0; i < cps; i++)
+      tables.push_back(HuffmanEncoder::optimal(histograms[i]));
+    return tables;
+  }
+
+  vector<uchar8> finish() { return bs.finish(); }
+};
+
+void putMarker(vector<uchar8>* out, uchar8 marker) {
+  out->push_back(0xFF);
+  out->push_back(marker);
+}
+
+void putU16(vector<uchar8>* out, uint32 value) {
+  out->push_back(value >> 8);
+  out->push_back(value & 0xff);
+}
+
+template <typename Traversal>
+vector<uchar8> writeLJpeg(const Frame& frame, uint32 precision,
+                          Traversal traverse) {
+  if (precision < 2 || precision > 15)
+    throw invalid_argument("Unsupported precision");
+
+  ScanCoder coder(precision);
+  traverse(&coder);
+  const auto& tables = coder.buildTables(frame.cps);
+  traverse(&coder);
+  const vector<uchar8> scan = coder.finish();
+
+  vector<uchar8> out;
+  putMarker(&out, 0xD8); // SOI
+
+  for (uint32 i = 0; i < frame.cps; i++) {
+    const auto& nCodes = tables[i].getNCodesPerLength();
+    const auto& values = tables[i].getCodeValues();
+    putMarker(&out, 0xC4); // DHT
+    putU16(&out, 2 + 1 + 16 + values.size());
+    out.push_back(i); // class 0, destination i
+    out.insert(out.end(), nCodes.begin(), nCodes.end());
+    out.insert(out.end(), values.begin(), values.end());
+  }
+
+  putMarker(&out, 0xC3); // SOF3
+  putU16(&out, 8 + frame.cps * 3);
+  out.push_back(precision);
+  putU16(&out, frame.h);
+  putU16(&out, frame.w);
+  out.push_back(frame.cps);
+  for (uint32 i = 0; i < frame.cps; i++) {
+    out.push_back(i + 1); // component id
+    out.push_back(i ? 0x11 : frame.superH << 4 | frame.superV);
+    out.push_back(0); // Tq
+  }
+
+  putMarker(&out, 0xDA); // SOS
+  putU16(&out, 6 + frame.cps * 2);
+  out.push_back(frame.cps);
+  for (uint32 i = 0; i < frame.cps; i++) {
+    out.push_back(i + 1); // component id
+    out.push_back(i << 4); // table i
+  }
+  out.push_back(1); // predictor
+  out.push_back(0); // Se
+  out.push_back(0); // Ah, Al (point transform)
+
+  out.insert(out.end(), scan.begin(), scan.end());
+  putMarker(&out, 0xD9); // EOI
+
+  return out;
+}
+
+// The slice widths as Cr2Decompressor ends up with them, checked to tile the
+// image.
+vector<int> cr2Slices(const RawImage& img, const Frame& frame,
+                      vector<int> slicesWidths, uint32 groupSize) {
+  if (slicesWidths.empty())
+    slicesWidths.push_back(frame.w * frame.cps);
+
+  // see Cr2Decompressor::decodeN_X_Y()
+  if (frame.superH == 2 && frame.superV == 1) {
+    for (auto& sliceWidth : slicesWidths)
+      sliceWidth = sliceWidth * 3 / 2;
+  }
+
+  uint32 total = 0;
+  for (uint32 i = 0; i < slicesWidths.size(); i++) {
+    if (slicesWidths[i] <= 0 || slicesWidths[i] % groupSize ||
+        (i + 1 < slicesWidths.size() && slicesWidths[i] != slicesWidths[0]))
+      throw invalid_argument("Invalid slice widths");
+    total += slicesWidths[i];
+  }
+  if (total != img->dim.x * img->getCpp())
+    throw invalid_argument("Slices do not cover the image width");
+
+  return slicesWidths;
+}
+
+} // namespace
+
+vector<uchar8> encodeLJpeg(const RawImage& img, uint32 precision,
+                           uint32 nComp) {
+  const uint32 cpp = img->getCpp();
+
+  if (nComp < 2 || nComp > 4 || img->dim.x * cpp % nComp)
+    throw invalid_argument("Unsupported number of components");
+
+  Frame frame;
+  frame.w = img->dim.x * cpp / nComp;
+  frame.h = img->dim.y;
+  frame.cps = nComp;
+
+  // see LJpegDecompressor::decodeN()
+  return writeLJpeg(frame, precision, [&](ScanCoder* coder) {
+    array<ushort16, 4> pred;
+    pred.fill(1 << (precision - 1));
+    const ushort16* predNext = pred.data();
+
+    for (uint32 y = 0; y < frame.h; y++) {
+      const auto* src = (const ushort16*)img->getDataUncropped(0, y);
+      copy_n(predNext, nComp, pred.data());
+      predNext = src;
+
+      for (uint32 x = 0; x < frame.w * nComp; x++)
+        coder->code(x % nComp, &pred[x % nComp], src[x]);
+    }
+  });
+}
+
+vector<uchar8> encodeCr2(const RawImage& img, uint32 precision, uint32 nComp,
+                         const vector<int>& slicesWidths) {
+  const iPoint2D dim = img->dim;
+  const uint32 cpp = img->getCpp();
+
+  if ((nComp != 2 && nComp != 4) || dim.x * cpp % nComp)
+    throw invalid_argument("Unsupported number of components");
+
+  Frame frame;
+  frame.w = dim.x * cpp / nComp;
+  frame.h = dim.y;
+  frame.cps = nComp;
+
+  // the decompressor doubles the height of such frames, the width stays
+  // doubled, it still is the interval of the predictor updates
+  uint32 sliceHeight = frame.h;
+  if (frame.w * frame.cps > 2 * frame.h) {
+    if (frame.h % 2)
+      throw invalid_argument("Wide image needs an even height");
+    frame.w *= 2;
+    frame.h /= 2;
+  }
+
+  const vector<int> slices = cr2Slices(img, frame, slicesWidths, nComp);
+
+  // see Cr2Decompressor::decodeN_X_Y()
+  return writeLJpeg(frame, precision, [&](ScanCoder* coder) {
+    array<ushort16, 4> pred;
+    pred.fill(1 << (precision - 1));
+    auto predNext = (const ushort16*)img->getDataUncropped(0, 0);
+
+    uint32 processedPixels = 0;
+    uint32 processedLineSlices = 0;
+    for (uint32 sliceWidth : slices) {
+      for (uint32 y = 0; y < sliceHeight; y++) {
+        const uint32 destY = processedLineSlices % dim.y;
+        const uint32 destX = processedLineSlices / dim.y * slices[0] / cpp;
+        auto src = (const ushort16*)img->getDataUncropped(destX, destY);
+
+        for (uint32 x = 0; x < sliceWidth; x += nComp) {
+          if (processedPixels == frame.w) {
+            copy_n(predNext, nComp, pred.data());
+            predNext = src;
+            processedPixels = 0;
+          }
+          for (uint32 i = 0; i < nComp; i++)
+            coder->code(i, &pred[i], *src++);
+          processedPixels++;
+        }
+        processedLineSlices++;
+      }
+    }
+  });
+}
+
+vector<uchar8> encodeCr2sRaw(const RawImage& img, uint32 precision,
+                             uint32 superV, const vector<int>& slicesWidths) {
+  const iPoint2D dim = img->dim;
+
+  if (img->getCpp() != 3 || img->isCFA)
+    throw invalid_argument("sRaw images have 3 components and no CFA");
+  if (superV != 1 && superV != 2)
+    throw invalid_argument("Unsupported subsampling");
+  if (dim.x % 2 || dim.y % superV)
+    throw invalid_argument("Image size is not a multiple of the subsampling");
+  if (dim.y > dim.x)
+    throw invalid_argument("sRaw images can not be higher than wide");
+
+  Frame frame;
+  frame.w = dim.x;
+  frame.h = dim.y;
+  frame.cps = 3;
+  frame.superH = 2;
+  frame.superV = superV;
+
+  const vector<int> slices = cr2Slices(img, frame, slicesWidths, 6);
+  const uint32 pixelPitch = img->pitch / 2;
+
+  // see Cr2Decompressor::decodeN_X_Y()
+  return writeLJpeg(frame, precision, [&](ScanCoder* coder) {
+    array<ushort16, 4> pred;
+    pred.fill(1 << (precision - 1));
+    auto predNext = (const ushort16*)img->getDataUncropped(0, 0);
+
+    uint32 processedPixels = 0;
+    uint32 processedLineSlices = 0;
+    for (uint32 sliceWidth : slices) {
+      for (uint32 y = 0; y < frame.h; y += superV) {
+        const uint32 destY = processedLineSlices % dim.y;
+        const uint32 destX = processedLineSlices / dim.y * slices[0] / 3;
+        auto src = (const ushort16*)img->getDataUncropped(destX, destY);
+
+        for (uint32 x = 0; x < sliceWidth; x += 6) {
+          if (processedPixels == frame.w) {
+            copy_n(predNext, 3, pred.data());
+            predNext = src;
+            processedPixels = 0;
+          }
+          for (uint32 i = 0; i < superV; i++) {
+            coder->code(0, &pred[0], src[0 + i * pixelPitch]);
+            coder->code(0, &pred[0], src[3 + i * pixelPitch]);
+          }
+          coder->code(1, &pred[1], src[1]);
+          coder->code(2, &pred[2], src[2]);
+          src += 6;
+          processedPixels += 2;
+        }
+        processedLineSlices += superV;
+      }
+    }
+  });
+}
+
+} // namespace RawSpeed
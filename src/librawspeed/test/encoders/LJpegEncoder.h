@@ -0,0 +1,54 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h"   // for uint32, uchar8
+#include "common/RawImage.h" // for RawImage
+#include <vector>            // for vector
+
+namespace RawSpeed {
+
+// Lossless JPEG (SOF3, predictor 1) writers for the subset of the format that
+// AbstractLJpegDecompressor supports. The scan is traversed exactly like the
+// decompressor traverses it, quirks included, and coded with one optimal
+// Huffman table per component. The precision is at most 15 bits.
+
+// For LJpegDecompressor::decode(0, 0, ...), with nComp (2 to 4) components,
+// i.e. a frame width of dim.x * cpp / nComp.
+std::vector<uchar8> encodeLJpeg(const RawImage& img, uint32 precision,
+                                uint32 nComp);
+
+// For Cr2Decompressor::decode(slicesWidths), with nComp (2 or 4) components.
+// Images more than twice as wide as high get the doubled frame width and
+// halved frame height of some Canon cameras.
+std::vector<uchar8> encodeCr2(const RawImage& img, uint32 precision,
+                              uint32 nComp,
+                              const std::vector<int>& slicesWidths);
+
+// For Cr2Decompressor::decode(slicesWidths) of sRaw images, the image has 3
+// components (Y, Cb, Cr) and is no CFA. There are two luma samples per chroma
+// sample for superV == 1 (sRaw2), four for superV == 2 (sRaw1/mRaw). Only the
+// samples that the decompressor writes are coded, i.e. Y, Cb and Cr of the
+// even pixels and Y of the odd pixels, and for superV == 2 only Y of the odd
+// rows.
+std::vector<uchar8> encodeCr2sRaw(const RawImage& img, uint32 precision,
+                                  uint32 superV,
+                                  const std::vector<int>& slicesWidths);
+
+} // namespace RawSpeed
@@ -0,0 +1,78 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/NikonEncoder.h"
+#include "common/Common.h"                 // for uint32, ushort16, uchar8
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include "test/encoders/HuffmanEncoder.h"  // for HuffmanEncoder
+#include <array>                           // for array
+#include <stdexcept>                       // for invalid_argument
+
+namespace RawSpeed {
+
+// the lossless trees of NikonDecompressor.cpp
+static HuffmanEncoder createEncoder(uint32 bitsPS) {
+  if (bitsPS == 12)
+    return HuffmanEncoder({{0, 1, 4, 2, 3, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0}},
+                          {5, 4, 6, 3, 7, 2, 8, 1, 9, 0, 10, 11, 12});
+  return HuffmanEncoder({{0, 1, 4, 2, 2, 3, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0}},
+                        {7, 6, 8, 5, 9, 4, 10, 3, 11, 12, 2, 0, 1, 13, 14});
+}
+
+std::vector<uchar8> encodeNikon(const RawImage& img, uint32 bitsPS,
+                                std::vector<uchar8>* metadata) {
+  if (bitsPS != 12 && bitsPS != 14)
+    throw std::invalid_argument("Unsupported bit depth");
+  if (img->getCpp() != 1 || img->dim.x % 2)
+    throw std::invalid_argument("Unsupported image layout");
+
+  // v0, v1, 4 initial predictions, curve size
+  metadata->assign(2 + 4 * 2 + 2, 0);
+  (*metadata)[0] = 0x46;
+  (*metadata)[1] = 0x30;
+
+  const HuffmanEncoder ht = createEncoder(bitsPS);
+  BitStreamWriter bs(BitOrder_Jpeg);
+
+  // see decompressNikon()
+  std::array<int, 2> pUp1 = {{0, 0}};
+  std::array<int, 2> pUp2 = {{0, 0}};
+  for (int y = 0; y < img->dim.y; y++) {
+    const auto* src = (const ushort16*)img->getData(0, y);
+    int pLeft1 = pUp1[y & 1];
+    int pLeft2 = pUp2[y & 1];
+    for (int x = 0; x < img->dim.x; x += 2) {
+      if (src[x] >> bitsPS || src[x + 1] >> bitsPS)
+        throw std::invalid_argument("Value does not fit into bit depth");
+      ht.encode(&bs, src[x] - pLeft1);
+      ht.encode(&bs, src[x + 1] - pLeft2);
+      pLeft1 = src[x];
+      pLeft2 = src[x + 1];
+      if (x == 0) {
+        pUp1[y & 1] = pLeft1;
+        pUp2[y & 1] = pLeft2;
+      }
+    }
+  }
+
+  return bs.finish();
+}
+
+} // namespace RawSpeed
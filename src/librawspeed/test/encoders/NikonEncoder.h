@@ -0,0 +1,34 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h"   // for uint32, uchar8
+#include "common/RawImage.h" // for RawImage
+#include <vector>            // for vector
+
+namespace RawSpeed {
+
+// Codes the image like a lossless compressed NEF, for decompressNikon() with
+// uncorrectedRawValues set, the curve would dither the values otherwise.
+// bitsPS is 12 or 14. The matching metadata (version 0x46, no initial
+// predictions, no curve) is stored in metadata.
+std::vector<uchar8> encodeNikon(const RawImage& img, uint32 bitsPS,
+                                std::vector<uchar8>* metadata);
+
+} // namespace RawSpeed
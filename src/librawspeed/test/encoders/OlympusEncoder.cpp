@@ -0,0 +1,141 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#include "test/encoders/OlympusEncoder.h"
+#include "common/Common.h"                 // for uchar8, ushort16, uint32
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include <cstdlib>                         // for abs
+#include <stdexcept>                       // for invalid_argument
+
+using namespace std;
+
+namespace RawSpeed {
+
+namespace {
+
+// the decoder state of the even or the odd columns
+struct Channel {
+  int carry[3] = {0, 0, 0};
+  int left = 0;
+  int nw = 0;
+};
+
+// The prediction of the decoder for column x. Also updates the neighbours
+// of the channel for the next pixel, which will be value.
+int predict(Channel* c, const ushort16* up, int x, bool yBorder, bool border,
+            int value) {
+  int pred;
+  if (border) {
+    if (yBorder && x < 2)
+      pred = 0;
+    else if (yBorder)
+      pred = c->left;
+    else {
+      pred = up[x];
+      c->nw = pred;
+    }
+  } else {
+    const int leftMinusNw = c->left - c->nw;
+    const int upMinusNw = up[x] - c->nw;
+    if ((leftMinusNw < 0) != (upMinusNw < 0) && leftMinusNw != 0 &&
+        upMinusNw != 0) {
+      if (abs(leftMinusNw) > 32 || abs(upMinusNw) > 32)
+        pred = c->left + upMinusNw;
+      else
+        pred = (c->left + up[x]) >> 1;
+    } else
+      pred = abs(leftMinusNw) > abs(upMinusNw) ? c->left : up[x];
+    c->nw = up[x];
+  }
+  c->left = value;
+  return pred;
+}
+
+// Codes value - pred the way the decoder reads it back
+void codeDiff(Channel* c, int value, int pred, BitStreamWriter* bs) {
+  const int i = 2 * (c->carry[2] < 3);
+  int nbits = 2 + i;
+  while ((ushort16)c->carry[0] >> (nbits + i))
+    nbits++;
+
+  // the 2 low bits of the difference are stored as they are, the rest
+  // relative to the running average in carry[1]
+  const int diff = (value - pred) >> 2;
+  const int low = (value - pred) & 3;
+  const int m = diff - c->carry[1];
+  const int sign = m < 0;
+  const int mag = sign ? ~m : m;
+  const int high = mag >> nbits;
+
+  bs->put(sign, 1);
+  bs->put(low, 2);
+  if (high < 12) {
+    // high zeros, terminated by a one
+    bs->put(1, high + 1);
+  } else {
+    if (nbits >= 15 || high >= 1 << (15 - nbits))
+      throw invalid_argument("Difference too large");
+    bs->put(0, 12);
+    bs->put(high << 1, 16 - nbits);
+  }
+  bs->put(mag & ((1 << nbits) - 1), nbits);
+
+  c->carry[0] = mag;
+  c->carry[1] = (diff * 3 + c->carry[1]) >> 5;
+  c->carry[2] = mag > 16 ? 0 : c->carry[2] + 1;
+}
+
+} // namespace
+
+vector<uchar8> encodeOlympus(const RawImage& img) {
+  const iPoint2D dim = img->dim;
+
+  if (img->getCpp() != 1 || dim.x % 2)
+    throw invalid_argument("Unsupported image layout");
+
+  // see OrfDecoder::decodeCompressed(), which skips the first 7 bytes
+  BitStreamWriter bs(BitOrder_Jpeg);
+  for (int i = 0; i < 7; i++)
+    bs.put(0, 8);
+
+  Channel channels[2];
+  for (int y = 0; y < dim.y; y++) {
+    const auto* src = (const ushort16*)img->getData(0, y);
+    // the prediction is from the row of the same color, 2 rows up
+    const auto* up = y >= 2 ? (const ushort16*)img->getData(0, y - 2) : nullptr;
+    const bool yBorder = y < 2;
+
+    for (Channel& c : channels) {
+      for (int& carry : c.carry)
+        carry = 0;
+    }
+
+    for (int x = 0; x < dim.x; x++) {
+      Channel* c = &channels[x & 1];
+      const int pred = predict(c, up, x, yBorder, yBorder || x < 2, src[x]);
+      codeDiff(c, src[x], pred, &bs);
+    }
+  }
+
+  return bs.finish();
+}
+
+} // namespace RawSpeed
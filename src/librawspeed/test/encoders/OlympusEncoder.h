@@ -0,0 +1,33 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+
+#pragma once
+
+#include "common/Common.h"   // for uchar8
+#include "common/RawImage.h" // for RawImage
+#include <vector>            // for vector
+
+namespace RawSpeed {
+
+// Codes the image like a compressed ORF, as decoded by
+// OrfDecoder::decodeCompressed(). The image must have a single component and
+// an even width. The coding is lossless.
+std::vector<uchar8> encodeOlympus(const RawImage& img);
+
+} // namespace RawSpeed
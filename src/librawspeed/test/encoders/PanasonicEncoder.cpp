@@ -0,0 +1,150 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/PanasonicEncoder.h"
+#include "common/Common.h"                 // for uint32, ushort16, uchar8
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include <algorithm>                       // for max, min, reverse
+#include <cstdlib>                         // for abs
+#include <stdexcept>                       // for invalid_argument
+
+using namespace std;
+
+namespace RawSpeed {
+
+namespace {
+
+// the decoder state of one of the two colors of a block
+struct Channel {
+  int pred = 0;
+  int nonz = 0;
+};
+
+// Codes one pixel the way the decoder will read it back, returns the value
+// the decoder reconstructs. Without bs, only the error is evaluated.
+int codePixel(Channel* c, int value, int sh, BitStreamWriter* bs) {
+  if (!c->nonz) {
+    // a zero would make the decoder skip the low bits
+    value = max(value, 16);
+    c->nonz = value >> 4;
+    c->pred = value;
+    if (bs) {
+      bs->put(c->nonz, 8);
+      bs->put(value & 0xf, 4);
+    }
+    return c->pred;
+  }
+
+  int base = c->pred - (0x80 << sh);
+  if (base < 0 || sh == 4)
+    base &= (1 << sh) - 1;
+
+  const int j = min(max((value - base + (1 << sh >> 1)) >> sh, 1), 255);
+  const int candidate = base + (j << sh);
+
+  // a zero keeps the prediction
+  const bool keep = abs(value - c->pred) <= abs(value - candidate);
+  if (!keep)
+    c->pred = candidate;
+  if (bs)
+    bs->put(keep ? 0 : j, 8);
+
+  return c->pred;
+}
+
+// the values of sh the 2 bit codes stand for
+const int shifts[4] = {0, 1, 2, 4};
+
+} // namespace
+
+vector<uchar8> encodePanasonic(const RawImage& img, uint32 loadFlags,
+                               RawImage* decoded) {
+  static constexpr uint32 BufSize = 0x4000;
+  const iPoint2D dim = img->dim;
+
+  if (img->getCpp() != 1 || dim.x % 14)
+    throw invalid_argument("Unsupported image layout");
+  if (loadFlags >= BufSize)
+    throw invalid_argument("Invalid load flags");
+
+  if (decoded)
+    *decoded = RawImage::create(dim);
+
+  // every block of 14 pixels is a 128 bit little endian integer, which is
+  // read from the most significant bit
+  BitStreamWriter bs(BitOrder_Jpeg);
+
+  // see Rw2Decoder::decodeThreaded()
+  for (int y = 0; y < dim.y; y++) {
+    const auto* src = (const ushort16*)img->getData(0, y);
+    auto* dst = decoded ? (ushort16*)(*decoded)->getData(0, y) : nullptr;
+
+    for (int x = 0; x < dim.x; x += 14) {
+      Channel channels[2];
+      int sh = 0;
+      for (int i = 0; i < 14; i++) {
+        if (src[x + i] >> 12)
+          throw invalid_argument("Value does not fit into 12 bits");
+
+        // a new shift for the next 3 pixels before pixels 2, 5, 8 and 11,
+        // the one with the smallest error
+        if (i % 3 == 2) {
+          int best = 0;
+          int bestError = -1;
+          for (int b = 0; b < 4; b++) {
+            int error = 0;
+            Channel c[2] = {channels[0], channels[1]};
+            for (int k = i; k < i + 3; k++)
+              error += abs(src[x + k] - codePixel(&c[k & 1], src[x + k],
+                                                  shifts[b], nullptr));
+            if (bestError < 0 || error < bestError) {
+              best = b;
+              bestError = error;
+            }
+          }
+          bs.put(best, 2);
+          sh = shifts[best];
+        }
+
+        const int value = codePixel(&channels[i & 1], src[x + i], sh, &bs);
+        if (dst)
+          dst[x + i] = value;
+      }
+    }
+  }
+
+  vector<uchar8> blocks = bs.finish();
+  for (auto i = blocks.begin(); i != blocks.end(); i += 16)
+    reverse(i, i + 16);
+
+  // The decoder reads the stream in chunks of BufSize bytes, of which the
+  // first loadFlags bytes are the end of the chunk.
+  blocks.resize(roundUp(blocks.size(), BufSize));
+  vector<uchar8> out;
+  out.reserve(blocks.size());
+  for (auto i = blocks.begin(); i != blocks.end(); i += BufSize) {
+    out.insert(out.end(), i + loadFlags, i + BufSize);
+    out.insert(out.end(), i, i + loadFlags);
+  }
+
+  return out;
+}
+
+} // namespace RawSpeed
@@ -0,0 +1,36 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h"   // for uint32, uchar8
+#include "common/RawImage.h" // for RawImage
+#include <vector>            // for vector
+
+namespace RawSpeed {
+
+// Codes the 12 bit image like a compressed RW2, as decoded by
+// Rw2Decoder::decodeThreaded(). loadFlags is 0x2008 for files with a
+// PANASONIC_STRIPOFFSET tag, 0 for the older ones. The width must be a
+// multiple of 14. The format codes steps of more than 127 with fewer bits and
+// the first pixel of each color in a block of 14 can not be below 16, so it is
+// lossy. If given, decoded receives the values the decoder will reconstruct.
+std::vector<uchar8> encodePanasonic(const RawImage& img, uint32 loadFlags,
+                                    RawImage* decoded = nullptr);
+
+} // namespace RawSpeed
@@ -0,0 +1,63 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/PentaxEncoder.h"
+#include "common/Common.h"                 // for ushort16, uchar8
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include "test/encoders/HuffmanEncoder.h"  // for HuffmanEncoder
+#include <array>                           // for array
+#include <stdexcept>                       // for invalid_argument
+
+namespace RawSpeed {
+
+std::vector<uchar8> encodePentax(const RawImage& img) {
+  if (img->getCpp() != 1 || img->dim.x % 2)
+    throw std::invalid_argument("Unsupported image layout");
+
+  // the legacy tree of PentaxDecompressor.cpp
+  const HuffmanEncoder ht({{0, 2, 3, 1, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0, 0, 0}},
+                          {3, 4, 2, 5, 1, 6, 0, 7, 8, 9, 10, 11, 12});
+  BitStreamWriter bs(BitOrder_Jpeg);
+
+  // see decodePentax()
+  std::array<int, 2> pUp1 = {{0, 0}};
+  std::array<int, 2> pUp2 = {{0, 0}};
+  for (int y = 0; y < img->dim.y; y++) {
+    const auto* src = (const ushort16*)img->getData(0, y);
+    int pLeft1 = pUp1[y & 1];
+    int pLeft2 = pUp2[y & 1];
+    for (int x = 0; x < img->dim.x; x += 2) {
+      if (src[x] >> 12 || src[x + 1] >> 12)
+        throw std::invalid_argument("Value does not fit into 12 bits");
+      ht.encode(&bs, src[x] - pLeft1);
+      ht.encode(&bs, src[x + 1] - pLeft2);
+      pLeft1 = src[x];
+      pLeft2 = src[x + 1];
+      if (x == 0) {
+        pUp1[y & 1] = pLeft1;
+        pUp2[y & 1] = pLeft2;
+      }
+    }
+  }
+
+  return bs.finish();
+}
+
+} // namespace RawSpeed
@@ -0,0 +1,91 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/SonyArw2Encoder.h"
+#include "common/Common.h"                 // for ushort16, uchar8
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include <algorithm>                       // for min
+#include <stdexcept>                       // for invalid_argument
+
+namespace RawSpeed {
+
+std::vector<uchar8> encodeArw2(const RawImage& img, RawImage* decoded) {
+  const iPoint2D dim = img->dim;
+
+  if (img->getCpp() != 1 || dim.x % 32)
+    throw std::invalid_argument("Unsupported image layout");
+
+  if (decoded)
+    *decoded = RawImage::create(dim);
+
+  BitStreamWriter bs(BitOrder_Plain);
+
+  // see ArwDecoder::decodeThreaded()
+  for (int y = 0; y < dim.y; y++) {
+    const auto* src = (const ushort16*)img->getData(0, y);
+    auto* dst = decoded ? (ushort16*)(*decoded)->getData(0, y) : nullptr;
+
+    // 32 pixels, i.e. one block of even and one of odd pixels, at a time
+    for (int x = 0; x < dim.x; x += x & 1 ? 31 : 1) {
+      int p[16];
+      int imax = 0;
+      int imin = 0;
+      for (int i = 0; i < 16; i++) {
+        if (src[x + i * 2] >> 12)
+          throw std::invalid_argument("Value does not fit into 12 bits");
+        p[i] = src[x + i * 2] >> 1;
+        if (p[i] > p[imax])
+          imax = i;
+        if (p[i] < p[imin])
+          imin = i;
+      }
+      // both need to be stored, even if all the pixels are the same
+      if (imin == imax)
+        imin = imax ? 0 : 1;
+
+      const int max = p[imax];
+      const int min = p[imin];
+      int sh;
+      for (sh = 0; sh < 4 && 0x80 << sh <= max - min; sh++)
+        ;
+
+      bs.put(max, 11);
+      bs.put(min, 11);
+      bs.put(imax, 4);
+      bs.put(imin, 4);
+
+      for (int i = 0; i < 16; i++) {
+        int r = p[i];
+        if (i != imax && i != imin) {
+          const int offset =
+              std::min((p[i] - min + (1 << sh >> 1)) >> sh, 0x7f);
+          bs.put(offset, 7);
+          r = std::min((offset << sh) + min, 0x7ff);
+        }
+        if (dst)
+          dst[x + i * 2] = r << 1;
+      }
+    }
+  }
+
+  return bs.finish();
+}
+
+} // namespace RawSpeed
@@ -0,0 +1,37 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h"   // for uchar8
+#include "common/RawImage.h" // for RawImage
+#include <vector>            // for vector
+
+namespace RawSpeed {
+
+// Codes the 12 bit image like an 8 bit compressed ARW2, as decoded by
+// ArwDecoder::decodeThreaded(), one byte per pixel. The width must be a
+// multiple of 32. The format drops the lowest bit and, in each block of 16
+// pixels of one color, stores the maximum and the minimum exactly and the
+// other pixels as 7 bit offsets from the minimum, shifted by up to 4 bits.
+// So it is lossy, if given, decoded receives the values the decoder will
+// reconstruct (with uncorrectedRawValues set, the curve applies otherwise).
+std::vector<uchar8> encodeArw2(const RawImage& img,
+                               RawImage* decoded = nullptr);
+
+} // namespace RawSpeed
@@ -0,0 +1,134 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/TiffBuilder.h"
+#include "common/Common.h"  // for uchar8, ushort16, uint32
+#include "tiff/TiffEntry.h" // for TIFF_ASCII, TIFF_BYTE, TIFF_LONG, TIFF_...
+#include "tiff/TiffTag.h"   // for TiffTag
+#include <algorithm>        // for sort
+#include <utility>          // for move
+
+using namespace std;
+
+namespace RawSpeed {
+
+static void putU16(vector<uchar8>* out, uint32 value) {
+  out->push_back(value & 0xff);
+  out->push_back(value >> 8);
+}
+
+static void putU32(vector<uchar8>* out, uint32 value) {
+  putU16(out, value & 0xffff);
+  putU16(out, value >> 16);
+}
+
+TiffBuilder::TiffBuilder(ushort16 magic_) : magic(magic_) {}
+
+void TiffBuilder::add(TiffTag tag, ushort16 type, uint32 count,
+                      vector<uchar8> data) {
+  entries.push_back({tag, type, count, move(data)});
+}
+
+void TiffBuilder::addString(TiffTag tag, const string& value) {
+  vector<uchar8> data(value.begin(), value.end());
+  data.push_back(0);
+  const uint32 count = data.size();
+  add(tag, TIFF_ASCII, count, move(data));
+}
+
+void TiffBuilder::addBytes(TiffTag tag, const vector<uchar8>& values) {
+  add(tag, TIFF_BYTE, values.size(), values);
+}
+
+void TiffBuilder::addShorts(TiffTag tag, const vector<ushort16>& values) {
+  vector<uchar8> data;
+  for (ushort16 v : values)
+    putU16(&data, v);
+  add(tag, TIFF_SHORT, values.size(), move(data));
+}
+
+void TiffBuilder::addLongs(TiffTag tag, const vector<uint32>& values) {
+  vector<uchar8> data;
+  for (uint32 v : values)
+    putU32(&data, v);
+  add(tag, TIFF_LONG, values.size(), move(data));
+}
+
+vector<uchar8> TiffBuilder::build(TiffTag offsetTag,
+                                  const vector<uchar8>& imageData) const {
+  return build(offsetTag, vector<vector<uchar8>>{imageData});
+}
+
+vector<uchar8>
+TiffBuilder::build(TiffTag offsetTag,
+                   const vector<vector<uchar8>>& chunks) const {
+  vector<Entry> all = entries;
+  all.push_back({offsetTag, TIFF_LONG, (uint32)chunks.size(),
+                 vector<uchar8>(4 * chunks.size())});
+  sort(all.begin(), all.end(),
+       [](const Entry& a, const Entry& b) { return a.tag < b.tag; });
+
+  // header, IFD, then the values that do not fit into the entries
+  const uint32 ifdOffset = 8;
+  const uint32 ifdSize = 2 + all.size() * 12 + 4;
+  uint32 valuesSize = 0;
+  for (const auto& e : all)
+    valuesSize += e.data.size() > 4 ? roundUp(e.data.size(), 2) : 0;
+  const uint32 imageOffset = roundUp(ifdOffset + ifdSize + valuesSize, 16);
+
+  vector<uchar8> out;
+  out.push_back('I');
+  out.push_back('I');
+  putU16(&out, magic);
+  putU32(&out, ifdOffset);
+
+  putU16(&out, all.size());
+  vector<uchar8> values;
+  for (auto& e : all) {
+    if (e.tag == offsetTag) {
+      e.data.clear();
+      uint32 offset = imageOffset;
+      for (const auto& chunk : chunks) {
+        putU32(&e.data, offset);
+        offset += chunk.size();
+      }
+    }
+    putU16(&out, e.tag);
+    putU16(&out, e.type);
+    putU32(&out, e.count);
+    if (e.data.size() > 4) {
+      putU32(&out, ifdOffset + ifdSize + values.size());
+      values.insert(values.end(), e.data.begin(), e.data.end());
+      values.resize(roundUp(values.size(), 2));
+    } else {
+      vector<uchar8> field(e.data);
+      field.resize(4);
+      out.insert(out.end(), field.begin(), field.end());
+    }
+  }
+  putU32(&out, 0); // no next IFD
+
+  out.insert(out.end(), values.begin(), values.end());
+  out.resize(imageOffset);
+  for (const auto& chunk : chunks)
+    out.insert(out.end(), chunk.begin(), chunk.end());
+
+  return out;
+}
+
+} // namespace RawSpeed
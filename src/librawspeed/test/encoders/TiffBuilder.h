@@ -0,0 +1,64 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#pragma once
+
+#include "common/Common.h" // for uchar8, ushort16, uint32
+#include "tiff/TiffTag.h"  // for TiffTag
+#include <string>          // for string
+#include <vector>          // for vector
+
+namespace RawSpeed {
+
+// Wraps encoded image data into a minimal little endian TIFF file with a
+// single IFD, just enough for the TIFF based decoders to find the image.
+class TiffBuilder final {
+  struct Entry {
+    TiffTag tag;
+    ushort16 type;
+    uint32 count;
+    std::vector<uchar8> data;
+  };
+
+  ushort16 magic;
+  std::vector<Entry> entries;
+
+  void add(TiffTag tag, ushort16 type, uint32 count,
+           std::vector<uchar8> data);
+
+public:
+  // 42, or the 0x4f52 of ORF and the 0x55 of RW2
+  explicit TiffBuilder(ushort16 magic = 42);
+
+  void addString(TiffTag tag, const std::string& value);
+  void addBytes(TiffTag tag, const std::vector<uchar8>& values);
+  void addShorts(TiffTag tag, const std::vector<ushort16>& values);
+  void addLongs(TiffTag tag, const std::vector<uint32>& values);
+
+  // Appends the image data after the IFD and stores its offset in
+  // offsetTag, a single LONG.
+  std::vector<uchar8> build(TiffTag offsetTag,
+                            const std::vector<uchar8>& imageData) const;
+  // The same for several strips or tiles, one after the other, with their
+  // offsets stored in offsetTag.
+  std::vector<uchar8>
+  build(TiffTag offsetTag,
+        const std::vector<std::vector<uchar8>>& chunks) const;
+};
+
+} // namespace RawSpeed
@@ -0,0 +1,50 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "test/encoders/UncompressedEncoder.h"
+#include "common/Common.h"                 // for uint32, ushort16, uchar8
+#include "common/Point.h"                  // for iPoint2D
+#include "common/RawImage.h"               // for RawImage, RawImageData
+#include "test/encoders/BitStreamWriter.h" // for BitStreamWriter
+#include <stdexcept>                       // for invalid_argument
+
+namespace RawSpeed {
+
+std::vector<uchar8> encodeUncompressed(const RawImage& img, uint32 bits,
+                                       BitOrder order) {
+  const uint32 w = img->dim.x * img->getCpp();
+
+  if (bits < 1 || bits > 16)
+    throw std::invalid_argument("Invalid bit depth");
+  if (w * bits % 8)
+    throw std::invalid_argument("Rows do not fill whole bytes");
+
+  BitStreamWriter bs(order);
+  for (int y = 0; y < img->dim.y; y++) {
+    const auto* src = (const ushort16*)img->getData(0, y);
+    for (uint32 x = 0; x < w; x++) {
+      if (src[x] >> bits)
+        throw std::invalid_argument("Value does not fit into bit depth");
+      bs.put(src[x], bits);
+    }
+  }
+
+  return bs.finish();
+}
+
+} // namespace RawSpeed
@@ -32,6 +32,7 @@ enum CiffTag {
   CIFF_IMAGEINFO    = 0x1810,
   CIFF_DECODERTABLE = 0x1835,
   CIFF_RAWDATA      = 0x2005,
+  CIFF_JPEGIMAGE    = 0x2007,
   CIFF_SUBIFD       = 0x300a,
   CIFF_EXIF         = 0x300b,
 };
@@ -22,6 +22,7 @@
 
 #include "tiff/TiffEntry.h"
 #include "common/Common.h"               // for uint32, ushort16, int32
+#include "io/Endianness.h"               // for copyByteSwapped, getByteSwa...
 #include "parsers/TiffParserException.h" // for ThrowTPE
 #include "tiff/TiffIFD.h"                // for TiffIFD, TiffRootIFD
 #include "tiff/TiffTag.h"                // for ::DNGPRIVATEDATA, ::EXIFIFD...
@@ -122,6 +123,27 @@ ushort16 TiffEntry::getU16(uint32 index) const {
   return data.peek<ushort16>(index);
 }
 
+// Memory of count values of type T, starting at index
+template <typename T>
+static const uchar8* getArrayData(const ByteStream& data, uint32 count,
+                                  uint32 index) {
+  uint64 offset = data.getPosition() + (uint64)index * sizeof(T);
+  uint64 size = (uint64)count * sizeof(T);
+  if (offset + size > UINT32_MAX)
+    ThrowTPE("integer overflow in size calculation.");
+  return data.Buffer::getData(offset, size);
+}
+
+void TiffEntry::getU16Array(ushort16* dst, uint32 count_, uint32 index) const {
+  if (type != TIFF_SHORT && type != TIFF_UNDEFINED)
+    ThrowTPE("Wrong type %u encountered. Expected Short or Undefined on 0x%x",
+             type, tag);
+
+  if (count_)
+    copyByteSwapped(dst, getArrayData<ushort16>(data, count_, index), count_,
+                    !data.isInNativeByteOrder());
+}
+
 short16 TiffEntry::getI16(uint32 index) const {
   if (type != TIFF_SSHORT && type != TIFF_UNDEFINED)
     ThrowTPE("Wrong type %u encountered. Expected Short or Undefined on 0x%x",
@@ -144,6 +166,29 @@ uint32 TiffEntry::getU32(uint32 index) const {
   return data.peek<uint32>(index);
 }
 
+void TiffEntry::getU32Array(uint32* dst, uint32 count_, uint32 index) const {
+  if (!count_)
+    return;
+
+  if (type == TIFF_SHORT) {
+    const uchar8* src = getArrayData<ushort16>(data, count_, index);
+    const bool bswap = !data.isInNativeByteOrder();
+    for (uint32 i = 0; i < count_; i++)
+      dst[i] = getByteSwapped<ushort16>(src + i * sizeof(ushort16), bswap);
+    return;
+  }
+  if (!(type == TIFF_LONG || type == TIFF_OFFSET || type == TIFF_BYTE ||
+        type == TIFF_UNDEFINED || type == TIFF_RATIONAL ||
+        type == TIFF_SRATIONAL)) {
+    ThrowTPE("Wrong type %u encountered. Expected Long, Offset, Rational or "
+             "Undefined on 0x%x",
+             type, tag);
+  }
+
+  copyByteSwapped(dst, getArrayData<uint32>(data, count_, index), count_,
+                  !data.isInNativeByteOrder());
+}
+
 int32 TiffEntry::getI32(uint32 index) const {
   if (type == TIFF_SSHORT)
     return getI16(index);
@@ -90,14 +90,23 @@ public:
   float getFloat(uint32 index = 0) const;
   std::string getString() const;
 
+  // Bulk versions of getU16() and getU32(): copy count_ values, starting at
+  // index, to dst in one pass, with a single type and range check.
+  void getU16Array(ushort16* dst, uint32 count_, uint32 index = 0) const;
+  void getU32Array(uint32* dst, uint32 count_, uint32 index = 0) const;
+
   inline std::vector<ushort16> getU16Array(uint32 count_) const
   {
-    return getArray<ushort16, &TiffEntry::getU16>(count_);
+    std::vector<ushort16> res(count_);
+    getU16Array(res.data(), count_);
+    return res;
   }
 
   inline std::vector<uint32> getU32Array(uint32 count_) const
   {
-    return getArray<uint32, &TiffEntry::getU32>(count_);
+    std::vector<uint32> res(count_);
+    getU32Array(res.data(), count_);
+    return res;
   }
 
   inline std::vector<float> getFloatArray(uint32 count_) const
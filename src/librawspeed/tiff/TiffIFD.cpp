@@ -21,62 +21,95 @@
 */
 
 #include "tiff/TiffIFD.h"
-#include "common/Common.h"  // for getHostEndianness, uint32, make_unique
+#include "common/Common.h"  // for isIn, getHostEndianness, uint32, make_...
 #include "io/IOException.h" // for IOException
 #include "tiff/TiffEntry.h" // for TiffEntry
 #include "tiff/TiffTag.h"   // for TiffTag, ::DNGPRIVATEDATA, ::EXIFIFDPOINTER
-#include <algorithm>        // for move
+#include <algorithm>        // for lower_bound, stable_sort, unique
 #include <cstdint>          // for UINT32_MAX
-#include <map>              // for map, _Rb_tree_const_iterator, allocator
 #include <memory>           // for default_delete, unique_ptr
 #include <string>           // for operator==, string, basic_string
-#include <utility>          // for pair
+#include <type_traits>      // for is_nothrow_move_constructible
+#include <utility>          // for move
 #include <vector>           // for vector
 
 using namespace std;
 
 namespace RawSpeed {
 
-void TiffIFD::parseIFDEntry(ByteStream& bs) {
-  TiffEntryOwner t;
+// Tags whose data is parsed as (a list of) IFDs
+static bool isSubIFDTag(TiffTag tag) {
+  return isIn(tag, {DNGPRIVATEDATA, MAKERNOTE, MAKERNOTE_ALT, FUJI_RAW_IFD,
+                    SUBIFDS, EXIFIFDPOINTER});
+}
+
+// The entries are moved around while sorting, this must not copy them, as a
+// copy of an entry owning its data (see ByteStream::createCopy()) is a view.
+static_assert(std::is_nothrow_move_constructible<TiffEntry>::value,
+              "TiffEntry must be nothrow move constructible");
 
+static bool lessTag(const TiffEntry& a, const TiffEntry& b) {
+  return a.tag < b.tag;
+}
+
+void TiffIFD::parseIFDEntry(ByteStream& bs) {
   auto origPos = bs.getPosition();
 
   try {
-    t = make_unique<TiffEntry>(bs);
+    TiffEntry t(bs);
+    t.parent = this;
+    if (isSubIFDTag(t.tag))
+      subIFDEntries.push_back(move(t));
+    else
+      entries.push_back(move(t));
   } catch (IOException&) { // Ignore unparsable entry
     // fix probably broken position due to interruption by exception
     // i.e. setting it to the next entry.
     bs.setPosition(origPos + 12);
-    return;
   }
+}
 
-  try {
-    switch (t->tag) {
-    case DNGPRIVATEDATA:
-      add(parseDngPrivateData(t.get()));
-      break;
-
-    case MAKERNOTE:
-    case MAKERNOTE_ALT:
-      add(parseMakerNote(t.get()));
-      break;
-
-    case FUJI_RAW_IFD:
-    case SUBIFDS:
-    case EXIFIFDPOINTER:
-      for (uint32 j = 0; j < t->count; j++) {
-        add(make_unique<TiffIFD>(bs, t->getU32(j), this));
-        // if (getSubIFDs().back()->getNextIFD() != 0)
-        //   cerr << "detected chained subIFds" << endl;
-      }
-      break;
+void TiffIFD::parseSubIFDs() const {
+  // Parsing on demand does not change the tree as seen from the outside
+  auto* self = const_cast<TiffIFD*>(this);
+#ifdef HAVE_PTHREAD
+  call_once(subIFDsParsed, &TiffIFD::parsePendingSubIFDs, self);
+#else
+  if (subIFDsParsed)
+    return;
+  subIFDsParsed = true;
+  self->parsePendingSubIFDs();
+#endif
+}
 
-    default:
-      add(move(t));
+// Runs once per IFD, so nothing in here may look up sub IFDs of this IFD
+// (or of its parents, which would come back here).
+void TiffIFD::parsePendingSubIFDs() {
+  vector<TiffEntry> pending;
+  pending.swap(subIFDEntries);
+
+  for (auto& t : pending) {
+    try {
+      switch (t.tag) {
+      case DNGPRIVATEDATA:
+        addSubIFD(parseDngPrivateData(&t));
+        break;
+
+      case MAKERNOTE:
+      case MAKERNOTE_ALT:
+        addSubIFD(parseMakerNote(&t));
+        break;
+
+      default: // FUJI_RAW_IFD, SUBIFDS, EXIFIFDPOINTER
+        for (uint32 j = 0; j < t.count; j++) {
+          addSubIFD(make_unique<TiffIFD>(t.getRootIfdData(), t.getU32(j), this));
+          // if (getSubIFDs().back()->getNextIFD() != 0)
+          //   cerr << "detected chained subIFds" << endl;
+        }
+      }
+    } catch (...) { // Unparsable private data are kept as entries
+      subIFDEntries.push_back(move(t));
     }
-  } catch (...) { // Unparsable private data are added as entries
-    add(move(t));
   }
 }
 
@@ -92,10 +125,19 @@ TiffIFD::TiffIFD(const DataBuffer& data, uint32 offset, TiffIFD* parent_)
 
   auto numEntries = bs.getU16(); // Directory entries in this IFD
 
+  entries.reserve(numEntries);
   for (uint32 i = 0; i < numEntries; i++)
     parseIFDEntry(bs);
 
   nextIFD = bs.getU32();
+
+  // Sort by tag, if a tag is repeated the last one is used
+  stable_sort(entries.begin(), entries.end(), lessTag);
+  auto first = unique(entries.rbegin(), entries.rend(),
+                      [](const TiffEntry& a, const TiffEntry& b) {
+                        return a.tag == b.tag;
+                      });
+  entries.erase(entries.begin(), first.base());
 }
 
 TiffRootIFDOwner TiffIFD::parseDngPrivateData(TiffEntry* t) {
@@ -135,12 +177,12 @@ TiffRootIFDOwner TiffIFD::parseDngPrivateData(TiffEntry* t) {
 TiffRootIFDOwner TiffIFD::parseMakerNote(TiffEntry* t)
 {
   // go up the IFD tree and try to find the MAKE entry on each level.
-  // we can not go all the way to the top first because this partial tree
-  // is not yet added to the TiffRootIFD.
+  // Only the entries of each level are searched, the sub IFDs of this IFD
+  // are being parsed.
   TiffIFD* p = this;
   TiffEntry* makeEntry;
   do {
-    makeEntry = p->getEntryRecursive(MAKE);
+    makeEntry = p->findEntry(MAKE);
     p = p->parent;
   } while (!makeEntry && p);
   string make = makeEntry ? trimSpaces(makeEntry->getString()) : "";
@@ -206,10 +248,10 @@ TiffRootIFDOwner TiffIFD::parseMakerNote(TiffEntry* t)
 
 std::vector<const TiffIFD*> TiffIFD::getIFDsWithTag(TiffTag tag) const {
   vector<const TiffIFD*> matchingIFDs;
-  if (entries.find(tag) != entries.end()) {
+  if (hasEntry(tag)) {
     matchingIFDs.push_back(this);
   }
-  for (auto& i : subIFDs) {
+  for (auto& i : getSubIFDs()) {
     vector<const TiffIFD*> t = i->getIFDsWithTag(tag);
     matchingIFDs.insert(matchingIFDs.end(), t.begin(), t.end());
   }
@@ -224,13 +266,28 @@ const TiffIFD* TiffIFD::getIFDWithTag(TiffTag tag, uint32 index) const
   return ifds[index];
 }
 
-TiffEntry* __attribute__((pure)) TiffIFD::getEntryRecursive(TiffTag tag) const {
-  auto i = entries.find(tag);
-  if (i != entries.end()) {
-    return i->second.get();
+TiffEntry* TiffIFD::findEntry(TiffTag tag) const {
+  if (isSubIFDTag(tag)) {
+    parseSubIFDs();
+    for (auto i = subIFDEntries.rbegin(); i != subIFDEntries.rend(); ++i)
+      if (i->tag == tag)
+        return &*i;
+    return nullptr;
   }
-  for (auto &j : subIFDs) {
-    TiffEntry *entry = j->getEntryRecursive(tag);
+
+  auto i = lower_bound(entries.begin(), entries.end(), tag,
+                       [](const TiffEntry& e, TiffTag t) { return e.tag < t; });
+  if (i == entries.end() || i->tag != tag)
+    return nullptr;
+  return &*i;
+}
+
+TiffEntry* TiffIFD::getEntryRecursive(TiffTag tag) const {
+  TiffEntry* entry = findEntry(tag);
+  if (entry)
+    return entry;
+  for (auto &j : getSubIFDs()) {
+    entry = j->getEntryRecursive(tag);
     if (entry)
       return entry;
   }
@@ -238,6 +295,12 @@ TiffEntry* __attribute__((pure)) TiffIFD::getEntryRecursive(TiffTag tag) const {
 }
 
 void TiffIFD::add(TiffIFDOwner subIFD) {
+  // Sub IFDs from the entries come first
+  parseSubIFDs();
+  addSubIFD(move(subIFD));
+}
+
+void TiffIFD::addSubIFD(TiffIFDOwner subIFD) {
   TiffIFD* p = this;
   for (int i = 1; p; ++i, p = p->parent )
     if (i > 10)
@@ -248,16 +311,28 @@ void TiffIFD::add(TiffIFDOwner subIFD) {
   subIFDs.push_back(move(subIFD));
 }
 
-void TiffIFD::add(TiffEntryOwner entry) {
-  entry->parent = this;
-  entries[entry->tag] = move(entry);
+// Invalidates pointers to the entries of this IFD, so this is only used
+// while the IFD is built.
+void TiffIFD::add(TiffEntry entry) {
+  entry.parent = this;
+  if (isSubIFDTag(entry.tag)) {
+    parseSubIFDs();
+    subIFDEntries.push_back(move(entry));
+    return;
+  }
+
+  auto i = lower_bound(entries.begin(), entries.end(), entry, lessTag);
+  if (i != entries.end() && i->tag == entry.tag)
+    *i = move(entry);
+  else
+    entries.insert(i, move(entry));
 }
 
 TiffEntry* TiffIFD::getEntry(TiffTag tag) const {
-  auto i = entries.find(tag);
-  if (i == entries.end())
+  TiffEntry* entry = findEntry(tag);
+  if (!entry)
     ThrowTPE("Entry 0x%x not found.", tag);
-  return i->second.get();
+  return entry;
 }
 
 TiffID TiffRootIFD::getID() const
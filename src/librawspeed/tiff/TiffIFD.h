@@ -21,20 +21,23 @@
 
 #pragma once
 
+#include "rawspeedconfig.h"
 #include "common/Common.h"               // for uint32, ushort16
 #include "io/Buffer.h"                   // for Buffer (ptr only), DataBuffer
 #include "io/ByteStream.h"               // for ByteStream
 #include "io/Endianness.h"               // for getHostEndianness, Endianne...
 #include "parsers/TiffParserException.h" // for ThrowTPE
+#include "tiff/TiffEntry.h"              // for TiffEntry
 #include "tiff/TiffTag.h"                // for TiffTag
-#include <map>                           // for map, _Rb_tree_const_iterator
 #include <memory>                        // for unique_ptr
 #include <string>                        // for string
 #include <vector>                        // for vector
 
-namespace RawSpeed {
+#ifdef HAVE_PTHREAD
+#include <mutex> // for call_once, once_flag
+#endif
 
-class TiffEntry;
+namespace RawSpeed {
 
 class TiffIFD;
 
@@ -42,14 +45,28 @@ class TiffRootIFD;
 
 using TiffIFDOwner = std::unique_ptr<TiffIFD>;
 using TiffRootIFDOwner = std::unique_ptr<TiffRootIFD>;
-using TiffEntryOwner = std::unique_ptr<TiffEntry>;
 
 class TiffIFD
 {
   uint32 nextIFD = 0;
   TiffIFD* parent = nullptr;
-  std::vector<TiffIFDOwner> subIFDs;
-  std::map<TiffTag, TiffEntryOwner> entries;
+  // Sub IFDs, maker notes and DNG private data are parsed by the first
+  // lookup that can reach them (see parseSubIFDs()), once per IFD, also
+  // when several threads look up entries of the same tree.
+  mutable std::vector<TiffIFDOwner> subIFDs;
+  // Sorted by tag, for binary search. Stored by value, so pointers to the
+  // entries are only stable once the IFD is complete (see add()). Mutable,
+  // as lookups hand out non-const entries (reading moves their streams).
+  mutable std::vector<TiffEntry> entries;
+  // Entries pointing to sub IFDs. Before parseSubIFDs() these are pending,
+  // afterwards only those that could not be parsed, which are then
+  // regular entries.
+  mutable std::vector<TiffEntry> subIFDEntries;
+#ifdef HAVE_PTHREAD
+  mutable std::once_flag subIFDsParsed;
+#else
+  mutable bool subIFDsParsed = false;
+#endif
 
   friend class TiffEntry;
   friend class FiffParser;
@@ -60,10 +77,14 @@ class TiffIFD
   TiffIFD &operator=(const TiffIFD &) = delete; // NOLINT
 
   void add(TiffIFDOwner subIFD);
-  void add(TiffEntryOwner entry);
+  void add(TiffEntry entry);
+  void addSubIFD(TiffIFDOwner subIFD);
   TiffRootIFDOwner parseDngPrivateData(TiffEntry *t);
   TiffRootIFDOwner parseMakerNote(TiffEntry *t);
   void parseIFDEntry(ByteStream& bs);
+  void parseSubIFDs() const;
+  void parsePendingSubIFDs();
+  TiffEntry* findEntry(TiffTag tag) const;
 
 public:
   TiffIFD() = default;
@@ -73,14 +94,14 @@ public:
   std::vector<const TiffIFD*> getIFDsWithTag(TiffTag tag) const;
   const TiffIFD* getIFDWithTag(TiffTag tag, uint32 index = 0) const;
   TiffEntry* getEntry(TiffTag tag) const;
-  TiffEntry* __attribute__((pure)) getEntryRecursive(TiffTag tag) const;
-  bool __attribute__((pure)) hasEntry(TiffTag tag) const {
-    return entries.find(tag) != entries.end();
-  }
+  TiffEntry* getEntryRecursive(TiffTag tag) const;
+  bool hasEntry(TiffTag tag) const { return findEntry(tag) != nullptr; }
   bool hasEntryRecursive(TiffTag tag) const { return getEntryRecursive(tag) != nullptr; }
 
-  const std::vector<TiffIFDOwner>& getSubIFDs() const { return subIFDs; }
-//  const std::map<TiffTag, TiffEntry*>& getEntries() const { return entries; }
+  const std::vector<TiffIFDOwner>& getSubIFDs() const {
+    parseSubIFDs();
+    return subIFDs;
+  }
 };
 
 struct TiffID
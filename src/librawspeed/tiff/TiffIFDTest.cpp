@@ -0,0 +1,127 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "rawspeedconfig.h"
+#include "common/Common.h"      // for uchar8, uint32, ushort16
+#include "io/Buffer.h"          // for Buffer
+#include "parsers/TiffParser.h" // for parseTiff
+#include "tiff/TiffEntry.h"     // for TiffEntry
+#include "tiff/TiffIFD.h"       // for TiffIFD, TiffRootIFDOwner
+#include "tiff/TiffTag.h"       // for TiffTag, EXIFIFDPOINTER, ISOSPEEDRATINGS
+#include <array>                // for array
+#include <gtest/gtest.h>        // for Test, EXPECT_EQ, ASSERT_EQ, TEST
+#include <vector>               // for vector
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+using namespace std;
+using namespace RawSpeed;
+
+namespace {
+
+void putU16(vector<uchar8>* v, ushort16 x) {
+  v->push_back(x & 0xff);
+  v->push_back(x >> 8);
+}
+
+void putU32(vector<uchar8>* v, uint32 x) {
+  putU16(v, x & 0xffff);
+  putU16(v, x >> 16);
+}
+
+void putEntry(vector<uchar8>* v, TiffTag tag, ushort16 type, uint32 value) {
+  putU16(v, tag);
+  putU16(v, type);
+  putU32(v, 1);
+  putU32(v, value);
+}
+
+// Little endian TIFF: IFD0 at 8, with an EXIF IFD (holding ISO 400) at
+// exifOffset, which is where it is written.
+vector<uchar8> buildTiff(uint32 exifOffset) {
+  vector<uchar8> v = {'I', 'I'};
+  putU16(&v, 42);
+  putU32(&v, 8);
+
+  putU16(&v, 1);
+  putEntry(&v, EXIFIFDPOINTER, 4, exifOffset);
+  putU32(&v, 0);
+
+  putU16(&v, 1);
+  putEntry(&v, ISOSPEEDRATINGS, 3, 400);
+  putU32(&v, 0);
+  return v;
+}
+
+#ifdef HAVE_PTHREAD
+void* lookUpISO(void* root) {
+  return static_cast<TiffIFD*>(root)->getEntryRecursive(ISOSPEEDRATINGS);
+}
+#endif
+
+} // namespace
+
+TEST(TiffIFDTest, SubIFDsParsedOnLookup) {
+  const vector<uchar8> data = buildTiff(26);
+  const Buffer buf(data.data(), data.size());
+  TiffRootIFDOwner root = parseTiff(buf);
+  ASSERT_EQ(root->getSubIFDs().size(), 1U);
+  const TiffIFD* ifd0 = root->getSubIFDs()[0].get();
+
+  EXPECT_FALSE(ifd0->hasEntry(EXIFIFDPOINTER));
+  ASSERT_EQ(ifd0->getSubIFDs().size(), 1U);
+  TiffEntry* iso = root->getEntryRecursive(ISOSPEEDRATINGS);
+  ASSERT_NE(iso, nullptr);
+  EXPECT_EQ(iso->getU16(), 400);
+}
+
+#ifdef HAVE_PTHREAD
+TEST(TiffIFDTest, ConcurrentLookups) {
+  const vector<uchar8> data = buildTiff(26);
+  const Buffer buf(data.data(), data.size());
+  TiffRootIFDOwner root = parseTiff(buf);
+
+  array<pthread_t, 8> threads;
+  for (auto& t : threads)
+    ASSERT_EQ(pthread_create(&t, nullptr, lookUpISO, root.get()), 0);
+  array<void*, 8> found;
+  for (uint32 i = 0; i < threads.size(); i++)
+    pthread_join(threads[i], &found[i]);
+
+  ASSERT_NE(found[0], nullptr);
+  for (void* f : found)
+    EXPECT_EQ(f, found[0]);
+  EXPECT_EQ(static_cast<TiffEntry*>(found[0])->getU16(), 400);
+  EXPECT_EQ(root->getSubIFDs()[0]->getSubIFDs().size(), 1U);
+}
+#endif
+
+// A sub IFD which can not be parsed is kept as a regular entry
+TEST(TiffIFDTest, BrokenSubIFDKept) {
+  const vector<uchar8> data = buildTiff(0x10000);
+  const Buffer buf(data.data(), data.size());
+  TiffRootIFDOwner root = parseTiff(buf);
+  const TiffIFD* ifd0 = root->getSubIFDs()[0].get();
+
+  EXPECT_TRUE(ifd0->hasEntry(EXIFIFDPOINTER));
+  EXPECT_EQ(ifd0->getEntry(EXIFIFDPOINTER)->getU32(), 0x10000U);
+  EXPECT_TRUE(ifd0->getSubIFDs().empty());
+  EXPECT_FALSE(root->hasEntryRecursive(ISOSPEEDRATINGS));
+}
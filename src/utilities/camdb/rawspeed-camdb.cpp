@@ -0,0 +1,51 @@
+/*
+    RawSpeed - RAW file decoder.
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "common/Common.h"           // for uchar8
+#include "io/Buffer.h"               // for Buffer
+#include "io/FileWriter.h"           // for FileWriter
+#include "metadata/CameraMetaData.h" // for CameraMetaData
+#include <cstdio>                    // for fprintf, stderr
+#include <exception>                 // for exception
+#include <vector>                    // for vector
+
+using namespace RawSpeed;
+
+// Compiles cameras.xml into the precompiled camera database, which
+// CameraMetaData can load without any xml parsing.
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "Usage: %s <cameras.xml> <cameras.bin>\n", argv[0]);
+    return 2;
+  }
+
+  try {
+    const CameraMetaData meta(argv[1]);
+
+    std::vector<uchar8> database;
+    meta.save(&database);
+
+    Buffer buf(database.data(), database.size());
+    FileWriter(argv[2]).writeFile(&buf, buf.getSize());
+  } catch (std::exception& e) {
+    fprintf(stderr, "ERROR: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -19,6 +19,8 @@
 
 #include "RawSpeed-API.h" // for RawImage, RawImageData, iPoint2D, ImageMet...
 
+#include "common/RawspeedException.h" // for RawspeedException
+
 #include <cstddef>    // for size_t
 #include <cstdint>    // for uint16_t
 #include <cstdio>     // for fprintf, stdout, stderr, printf
@@ -26,102 +28,92 @@
 #include <memory>     // for unique_ptr
 #include <string>     // for string, operator+
 #include <sys/stat.h> // for stat
-
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
-// define this function, it is only declared in rawspeed:
-#ifdef _OPENMP
-int rawspeed_get_number_of_processor_cores() { return omp_get_num_procs(); }
-#else
-int __attribute__((const)) rawspeed_get_number_of_processor_cores() {
-  return 1;
-}
-#endif
+#include <vector>     // for vector
 
 using namespace RawSpeed;
 
-std::string find_cameras_xml(const char *argv0) {
+// Looks for the camera file name (cameras.xml or cameras.bin) where it is
+// installed, relative to argv[0], and in the build tree. Returns an empty
+// string if it is not found anywhere.
+std::string find_camera_file(const char *argv0, const char *name,
+                             const char *build_camfile) {
   struct stat statbuf;
+  std::vector<std::string> candidates;
 
-#ifdef RS_CAMERAS_XML_PATH
-  static const char set_camfile[] = RS_CAMERAS_XML_PATH;
-  if (stat(set_camfile, &statbuf)) {
-    fprintf(stderr, "WARNING: Couldn't find cameras.xml in '%s'\n",
-            set_camfile);
-  } else {
-    return set_camfile;
-  }
+#ifdef RS_CAMERAS_DIR
+  candidates.push_back(std::string(RS_CAMERAS_DIR "/") + name);
 #endif
 
   const std::string self(argv0);
 
-  // If we haven't been provided with a valid cameras.xml path on compile try
-  // relative to argv[0]
+  // If we haven't been provided with a valid path on compile try relative to
+  // argv[0]
   const std::size_t lastslash = self.find_last_of(R"(/\)");
   const std::string bindir(self.substr(0, lastslash));
 
-  std::string found_camfile(bindir +
-                            "/../share/darktable/rawspeed/cameras.xml");
-
-  if (stat(found_camfile.c_str(), &statbuf)) {
-#ifndef __APPLE__
-    fprintf(stderr, "WARNING: Couldn't find cameras.xml in '%s'\n",
-            found_camfile.c_str());
-#else
-    fprintf(stderr, "WARNING: Couldn't find cameras.xml in '%s'\n",
-            found_camfile.c_str());
-    found_camfile =
-        bindir + "/../Resources/share/darktable/rawspeed/cameras.xml";
-    if (stat(found_camfile.c_str(), &statbuf)) {
-      fprintf(stderr, "WARNING: Couldn't find cameras.xml in '%s'\n",
-              found_camfile.c_str());
-    }
+  candidates.push_back(bindir + "/../share/darktable/rawspeed/" + name);
+#ifdef __APPLE__
+  candidates.push_back(bindir + "/../Resources/share/darktable/rawspeed/" +
+                       name);
 #endif
-  }
 
   // running from build dir?
-  found_camfile = std::string(CMAKE_SOURCE_DIR "/data/cameras.xml");
-
-  if (stat(found_camfile.c_str(), &statbuf)) {
-#ifndef __APPLE__
-    fprintf(stderr, "ERROR: Couldn't find cameras.xml in '%s'\n",
-            found_camfile.c_str());
-    return nullptr;
-#else
-    fprintf(stderr, "WARNING: Couldn't find cameras.xml in '%s'\n",
-            found_camfile.c_str());
-    found_camfile =
-        bindir + "/../Resources/share/darktable/rawspeed/cameras.xml";
-    if (stat(found_camfile.c_str(), &statbuf)) {
-      fprintf(stderr, "ERROR: Couldn't find cameras.xml in '%s'\n",
-              found_camfile.c_str());
+  candidates.emplace_back(build_camfile);
+
+  for (const std::string &camfile : candidates) {
+    if (!stat(camfile.c_str(), &statbuf))
+      return camfile;
+  }
+
+  return "";
+}
+
+// Loads the precompiled camera database if there is one, cameras.xml
+// otherwise. The cameras of the overrides xml, if any, replace the known ones.
+std::unique_ptr<CameraMetaData> load_cameras(const char *argv0,
+                                             const char *overrides) {
+  std::unique_ptr<CameraMetaData> meta;
+
+  const std::string dbfile = find_camera_file(
+      argv0, "cameras.bin", CMAKE_BINARY_DIR "/data/cameras.bin");
+  if (!dbfile.empty()) {
+    try {
+      FileReader f(dbfile.c_str());
+      std::unique_ptr<Buffer> database(f.readFile());
+      meta = make_unique<CameraMetaData>(database.get());
+    } catch (RawspeedException &e) {
+      fprintf(stderr, "WARNING: Couldn't load '%s': %s\n", dbfile.c_str(),
+              e.what());
+    }
+  }
+
+  if (!meta) {
+    const std::string camfile = find_camera_file(
+        argv0, "cameras.xml", CMAKE_SOURCE_DIR "/data/cameras.xml");
+    if (camfile.empty()) {
+      fprintf(stderr, "ERROR: Couldn't find cameras.xml\n");
       return nullptr;
     }
-#endif
+    meta = make_unique<CameraMetaData>(camfile.c_str());
   }
 
-  return found_camfile;
+  if (overrides)
+    meta->loadXML(overrides);
+
+  return meta;
 }
 
 int main(int argc, char *argv[]) {
 
-  if (argc != 2) {
-    fprintf(stderr, "Usage: darktable-rs-identify <file>\n");
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr,
+            "Usage: darktable-rs-identify <file> [<cameras.xml overrides>]\n");
     return 0;
   }
 
-  const std::string camfile = find_cameras_xml(argv[0]);
-  if (camfile.empty()) {
-    // fprintf(stderr, "ERROR: Couldn't find cameras.xml\n");
-    return 2;
-  }
-  // fprintf(stderr, "Using cameras.xml from '%s'\n", camfile);
-
   try {
     std::unique_ptr<const CameraMetaData> meta(
-        new CameraMetaData(camfile.c_str()));
+        load_cameras(argv[0], argc == 3 ? argv[2] : nullptr));
 
     if (!meta.get()) {
       fprintf(stderr, "ERROR: Couldn't get a CameraMetaData instance\n");
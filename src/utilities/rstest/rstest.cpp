@@ -20,8 +20,13 @@
 
 #include "RawSpeed-API.h"
 
+#include "common/RawspeedException.h" // for RawspeedException
 #include "io/Endianness.h" // for getHostEndianness, BSWAP16, Endianness::l...
+#include <algorithm>       // for sort, transform
+#include <array>           // for array
+#include <cctype>          // for toupper
 #include <chrono>          // for milliseconds, steady_clock, duration, dur...
+#include <cmath>           // for ceil
 #include <cstdint>         // for uint8_t
 #include <cstdio>          // for snprintf, size_t, fclose, fopen, fprintf
 #include <cstdlib>         // for system
@@ -36,19 +41,7 @@
 #include <string>          // for string, char_traits, operator+, operator<<
 #include <type_traits>     // for enable_if<>::type
 #include <utility>         // for pair
-
-#ifdef _OPENMP
-#include <omp.h>
-#endif
-
-// define this function, it is only declared in rawspeed:
-#ifdef _OPENMP
-int rawspeed_get_number_of_processor_cores() { return omp_get_num_procs(); }
-#else
-int __attribute__((const)) rawspeed_get_number_of_processor_cores() {
-  return 1;
-}
-#endif
+#include <vector>          // for vector
 
 using namespace std;
 using namespace RawSpeed;
@@ -125,8 +118,8 @@ string img_hash(RawImage &r) {
   APPEND("pixel_aspect_ratio: %f\n", r->metadata.pixelAspectRatio);
 
   APPEND("badPixelPositions: ");
-  for (uint32 p : r->mBadPixelPositions)
-    APPEND("%d, ", p);
+  for (const auto& p : r->mBadPixelPositions)
+    APPEND("%dx%d, ", p.x, p.y);
 
   APPEND("\n");
 
@@ -247,6 +240,218 @@ size_t process(const string& filename, const CameraMetaData* metadata,
 
 #pragma GCC diagnostic pop
 
+// The stages of decoding a file, as timed by the benchmark mode. decodeRaw()
+// is timed without the interpolation of the bad pixels, which is timed on its
+// own as fixBadPixels.
+enum BenchmarkStage {
+  STAGE_READ,
+  STAGE_PARSE,
+  STAGE_DECODE_RAW,
+  STAGE_FIX_BAD_PIXELS,
+  STAGE_DECODE_METADATA,
+  STAGE_TOTAL,
+  STAGE_COUNT
+};
+
+static const char* const stageNames[STAGE_COUNT] = {
+    "read", "parse", "decodeRaw", "fixBadPixels", "decodeMetaData", "total"};
+
+struct BenchmarkResult {
+  string filename;
+  string make;
+  string model;
+  string format;
+  size_t size = 0;
+  // of the last run, only counted with WITH_COUNTERS
+  DecodeCounters counters = DecodeCounters();
+  // in ms, one per repetition
+  array<vector<double>, STAGE_COUNT> times;
+};
+
+struct BenchmarkStats {
+  double median;
+  double p95;
+  double p99;
+};
+
+// nearest rank percentiles, so each one is an actually measured time
+static BenchmarkStats benchmarkStats(vector<double> times) {
+  sort(times.begin(), times.end());
+  auto percentile = [&](double p) {
+    auto rank = static_cast<size_t>(ceil(p * times.size()));
+    return times[rank ? rank - 1 : 0];
+  };
+  return {percentile(0.5), percentile(0.95), percentile(0.99)};
+}
+
+static BenchmarkResult benchmark(const string& filename,
+                                 const CameraMetaData* metadata, int warmup,
+                                 int repetitions) {
+  BenchmarkResult result;
+  result.filename = filename;
+  const size_t dot = filename.rfind('.');
+  if (dot != string::npos)
+    result.format = filename.substr(dot + 1);
+  transform(result.format.begin(), result.format.end(), result.format.begin(),
+            ::toupper);
+
+  for (int i = 0; i < warmup + repetitions; ++i) {
+    array<double, STAGE_COUNT> times;
+    auto last = chrono::steady_clock::now();
+    auto lap = [&](BenchmarkStage stage) {
+      auto now = chrono::steady_clock::now();
+      times[stage] = chrono::duration<double, milli>(now - last).count();
+      last = now;
+    };
+
+    FileReader reader(filename.c_str());
+    unique_ptr<Buffer> map = unique_ptr<Buffer>(reader.readFile());
+    lap(STAGE_READ);
+
+    RawParser parser(map.get());
+    unique_ptr<RawDecoder> decoder =
+        unique_ptr<RawDecoder>(parser.getDecoder(metadata));
+    decoder->failOnUnknown = false;
+    decoder->checkSupport(metadata);
+    lap(STAGE_PARSE);
+
+    decoder->interpolateBadPixels = false;
+    decoder->decodeRaw();
+    lap(STAGE_DECODE_RAW);
+
+    decoder->mRaw->fixBadPixels();
+    lap(STAGE_FIX_BAD_PIXELS);
+
+    decoder->decodeMetaData(metadata);
+    lap(STAGE_DECODE_METADATA);
+
+    if (i < warmup)
+      continue;
+
+    times[STAGE_TOTAL] = 0;
+    for (int s = 0; s < STAGE_TOTAL; ++s)
+      times[STAGE_TOTAL] += times[s];
+    for (int s = 0; s < STAGE_COUNT; ++s)
+      result.times[s].push_back(times[s]);
+
+    if (result.make.empty()) {
+      const ImageMetaData& m = decoder->mRaw->metadata;
+      result.make = m.canonical_make.empty() ? m.make : m.canonical_make;
+      result.model = m.canonical_model.empty() ? m.model : m.canonical_model;
+      result.size = map->getSize();
+    }
+    result.counters = decoder->mRaw->counters;
+  }
+
+  return result;
+}
+
+static string jsonString(const string& s) {
+  ostringstream oss;
+  oss << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      oss << '\\' << c;
+    else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      oss << buf;
+    } else
+      oss << c;
+  }
+  oss << '"';
+  return oss.str();
+}
+
+static void writeJSONCounters(ostream& os, const DecodeCounters& counters) {
+#ifdef WITH_COUNTERS
+  os << ", \"counters\": {";
+  for (int i = 0; i < DecodeCounters::count; ++i)
+    os << (i ? ", " : "") << "\"" << DecodeCounters::names[i]
+       << "\": " << counters.*DecodeCounters::fields[i];
+  os << "}";
+#endif
+}
+
+static void writeJSONStages(ostream& os,
+                            const array<vector<double>, STAGE_COUNT>& times) {
+  os << "\"stages\": {";
+  for (int s = 0; s < STAGE_COUNT; ++s) {
+    const BenchmarkStats stats = benchmarkStats(times[s]);
+    os << (s ? ", " : "") << "\"" << stageNames[s] << "\": {\"median\": "
+       << stats.median << ", \"p95\": " << stats.p95 << ", \"p99\": "
+       << stats.p99 << "}";
+  }
+  os << "}";
+}
+
+// Prints the per stage medians of each make/model/format group and writes all
+// the results, per file and per group, as JSON.
+static void benchmarkResults(const vector<BenchmarkResult>& results,
+                             int warmup, int repetitions,
+                             const string& jsonFile) {
+  struct Group {
+    size_t files = 0;
+    DecodeCounters counters = DecodeCounters();
+    array<vector<double>, STAGE_COUNT> times;
+  };
+  map<array<string, 3>, Group> groups;
+  for (const auto& r : results) {
+    Group& g = groups[{{r.make, r.model, r.format}}];
+    g.files++;
+    for (auto field : DecodeCounters::fields)
+      g.counters.*field += r.counters.*field;
+    for (int s = 0; s < STAGE_COUNT; ++s)
+      g.times[s].insert(g.times[s].end(), r.times[s].begin(), r.times[s].end());
+  }
+
+  cout << endl << "median times in ms" << endl;
+  cout << left << setw(40) << "make / model / format";
+  for (const char* name : stageNames)
+    cout << right << setw(15) << name;
+  cout << endl;
+  for (const auto& g : groups) {
+    cout << left << setw(40)
+         << (g.first[0] + " / " + g.first[1] + " / " + g.first[2]);
+    for (const auto& t : g.second.times)
+      cout << right << setw(15) << fixed << setprecision(2)
+           << benchmarkStats(t).median;
+    cout << endl;
+  }
+
+  ofstream os(jsonFile);
+  os << setprecision(4) << fixed;
+  os << "{\n  \"warmup\": " << warmup << ",\n  \"repetitions\": "
+     << repetitions << ",\n  \"threads\": " << getThreadCount()
+     << ",\n  \"files\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchmarkResult& r = results[i];
+    os << (i ? "," : "") << "\n    {\"file\": " << jsonString(r.filename)
+       << ", \"make\": " << jsonString(r.make)
+       << ", \"model\": " << jsonString(r.model)
+       << ", \"format\": " << jsonString(r.format) << ", \"size\": " << r.size
+       << ", ";
+    writeJSONStages(os, r.times);
+    writeJSONCounters(os, r.counters);
+    os << "}";
+  }
+  os << "\n  ],\n  \"groups\": [";
+  bool first = true;
+  for (const auto& g : groups) {
+    os << (first ? "" : ",") << "\n    {\"make\": " << jsonString(g.first[0])
+       << ", \"model\": " << jsonString(g.first[1])
+       << ", \"format\": " << jsonString(g.first[2])
+       << ", \"files\": " << g.second.files << ", ";
+    writeJSONStages(os, g.second.times);
+    writeJSONCounters(os, g.second.counters);
+    os << "}";
+    first = false;
+  }
+  os << "\n  ]\n}\n";
+
+  cout << endl << "Results written to " << jsonFile << endl;
+}
+
 static int results(const map<string, string>& failedTests) {
   if (failedTests.empty()) {
     cout << "All good, no tests failed!" << endl;
@@ -284,12 +489,42 @@ static int results(const map<string, string>& failedTests) {
   return 1;
 }
 
+// The camera database of the build, or cameras.xml if it was not built (or is
+// outdated). The cameras of the overrides xml, if any, replace the known ones.
+static unique_ptr<CameraMetaData> loadCameras(const string& overrides) {
+  unique_ptr<CameraMetaData> metadata;
+  try {
+    FileReader f(CMAKE_BINARY_DIR "/data/cameras.bin");
+    unique_ptr<Buffer> database(f.readFile());
+    metadata = make_unique<CameraMetaData>(database.get());
+  } catch (RawspeedException&) {
+    metadata =
+        make_unique<CameraMetaData>(CMAKE_SOURCE_DIR "/data/cameras.xml");
+  }
+
+  if (!overrides.empty())
+    metadata->loadXML(overrides.c_str());
+
+  return metadata;
+}
+
 static int usage(const char* progname) {
   cout << "usage: " << progname << R"(
   [-h] print this help
   [-c] for each file: decode, compute hash and store it.
        If hash exists, it does not recompute it!
   [-d] store decoded image as PPM
+  [-b] benchmark mode: decode each file repeatedly, without hashes, and
+       report the median/p95/p99 times of each stage (read, parse,
+       decodeRaw, fixBadPixels, decodeMetaData) per file and per camera
+       make/model/format. With WITH_COUNTERS, the JSON also has the
+       slow path counters of the last run.
+  [-w N] warmup runs per file in benchmark mode, default 1
+  [-r N] timed runs per file in benchmark mode, default 10
+  [-j FILE] where benchmark mode writes the JSON results, default
+       rstest.json
+  [-x FILE] a cameras.xml whose cameras replace the ones of the camera
+       database
   <FILE[S]> the file[s] to work on.
 
   With no options given, each raw with an accompanying hash will be decoded
@@ -320,14 +555,57 @@ int main(int argc, char **argv) {
     return found;
   };
 
+  auto getOption = [&](string option, string value) {
+    for (int i = 1; i + 1 < argc; ++i) {
+      if (!argv[i] || argv[i] != option || !argv[i + 1])
+        continue;
+      value = argv[i + 1];
+      argv[i] = argv[i + 1] = nullptr;
+    }
+    return value;
+  };
+
   bool help = hasFlag("-h");
   bool create = hasFlag("-c");
   bool dump = hasFlag("-d");
+  bool bench = hasFlag("-b");
+  const int warmup = stoi(getOption("-w", "1"));
+  const int repetitions = stoi(getOption("-r", "10"));
+  const string jsonFile = getOption("-j", "rstest.json");
+  const string camerasXml = getOption("-x", "");
 
-  if (1 == argc || help)
+  if (1 == argc || help || warmup < 0 || repetitions < 1)
     return usage(argv[0]);
 
-  const CameraMetaData metadata(CMAKE_SOURCE_DIR "/data/cameras.xml");
+  const unique_ptr<const CameraMetaData> metadata = loadCameras(camerasXml);
+
+  if (bench) {
+    // one file at a time, so the files do not compete for the cores
+    vector<BenchmarkResult> results;
+    map<string, string> failedTests;
+    for (int i = 1; i < argc; ++i) {
+      if (!argv[i])
+        continue;
+
+      try {
+        results.push_back(
+            benchmark(argv[i], metadata.get(), warmup, repetitions));
+        const BenchmarkStats total =
+            benchmarkStats(results.back().times[STAGE_TOTAL]);
+        cout << left << setw(55) << argv[i] << ": " << fixed << setprecision(2)
+             << total.median << " ms median, " << total.p95 << " ms p95, "
+             << total.p99 << " ms p99" << endl;
+      } catch (std::runtime_error &e) {
+        string msg = string(argv[i]) + " failed: " + e.what();
+        cerr << msg << endl;
+        failedTests.emplace(argv[i], msg);
+      }
+    }
+
+    benchmarkResults(results, warmup, repetitions, jsonFile);
+
+    return failedTests.empty() ? 0 : 1;
+  }
 
   size_t time = 0;
   map<string, string> failedTests;
@@ -339,7 +617,7 @@ int main(int argc, char **argv) {
       continue;
 
     try {
-      time += process(argv[i], &metadata, create, dump);
+      time += process(argv[i], metadata.get(), create, dump);
     } catch (std::runtime_error &e) {
 #ifdef _OPENMP
 #pragma omp critical(io)